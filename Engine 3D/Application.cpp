@@ -1,6 +1,7 @@
 #include "Application.h"
 #include <time.h>
 #include "pcg/pcg_basic.h"
+#include <algorithm>
 
 using namespace std;
 
@@ -19,6 +20,7 @@ Application::Application()
 	picking = new ModulePicking(this);
 	module_time = new Time(this);
 	particle_manager = new ModuleParticleManager(this);
+	debugDraw = new ModuleDebugDraw(this);
 
 	// The order of calls is very important!
 	// Modules will Init() Start() and Update in this order
@@ -44,6 +46,8 @@ Application::Application()
 
 	AddModule(geometry);
 
+	AddModule(debugDraw);
+
 	// Renderer last!
 	AddModule(renderer3D);
 }
@@ -60,10 +64,58 @@ Application::~Application()
 	}
 }
 
+void Application::ParseArguments(int argc, char** argv)
+{
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string argument = argv[i];
+		bool hasValue = i + 1 < argc;
+
+		if (argument == "-headless")
+			headless = true;
+		else if (argument == "-nullrenderer")
+			renderer3D->nullBackend = true;
+		else if (argument == "-fps" && hasValue)
+		{
+			// 0 leaves the loop unlocked
+			capFrames = atoi(argv[++i]);
+			toCap = capFrames > 0;
+		}
+		else if (argument == "-fixedstep" && hasValue)
+		{
+			float hz = (float)atof(argv[++i]);
+			module_time->fixedDT = hz > 0.0f ? 1.0f / hz : 0.0f;
+		}
+		else if (argument == "-frames" && hasValue)
+			benchmarkFrames = atoi(argv[++i]);
+		else if (argument == "-scene" && hasValue)
+			startScene = argv[++i];
+		else if (argument == "-benchmark" && hasValue)
+			benchmarkOutput = argv[++i];
+		else
+			LOG("Unknown command line argument %s", argv[i]);
+	}
+
+	if (renderer3D->nullBackend)
+	{
+		// Simulation only: no window, no GL, no editor
+		LOG("Running with the null renderer, %u frames", benchmarkFrames);
+		headless = true;
+		imgui->SetEnabled(false);
+	}
+	else if (headless)
+	{
+		LOG("Running headless, %u frames", benchmarkFrames);
+		imgui->SetEnabled(false);
+	}
+}
+
 bool Application::Init()
 {
 	bool ret = true;
 
+	jobs.Init();
+
 	// Call Init() in all modules
 	list<Module*>::const_iterator item = list_modules.begin();
 
@@ -87,6 +139,7 @@ bool Application::Init()
 	pcg32_srandom(time(NULL), (intptr_t)&RNG1);
 
 	ms_timer.Start();
+	benchmarkStart = SDL_GetPerformanceCounter();
 	return ret;
 }
 
@@ -95,6 +148,7 @@ void Application::PrepareUpdate()
 {
 	dt = (float)ms_timer.Read() / 1000.0f;
 	ms_timer.Start();
+	frameStart = SDL_GetPerformanceCounter();
 
 	fps_log.push_back(1/dt);
 	if (fps_log.size() > 75)
@@ -114,14 +168,14 @@ void Application::FinishUpdate()
 {
 	if (!renderer3D->vsync && toCap)
 	{
-		float dt = dt * 1000.0f;
-		float toVsync = dt;
+		float frameMs = (float)ms_timer.Read();
+		float toVsync = frameMs;
 
 		if (capFrames > 0)
 			toVsync = 1000.0f / capFrames;
 
-		if (dt < toVsync)
-			SDL_Delay(toVsync - dt);
+		if (frameMs < toVsync)
+			SDL_Delay(toVsync - frameMs);
 	}
 }
 
@@ -135,7 +189,8 @@ update_status Application::Update()
 	
 	while(item != list_modules.end() && ret == UPDATE_CONTINUE)
 	{
-		ret = (*item)->PreUpdate();
+		if ((*item)->IsEnabled())
+			ret = (*item)->PreUpdate();
 		item++;
 	}
 
@@ -143,7 +198,8 @@ update_status Application::Update()
 
 	while(item != list_modules.end() && ret == UPDATE_CONTINUE)
 	{
-		ret = (*item)->Update();
+		if ((*item)->IsEnabled())
+			ret = (*item)->Update();
 		item++;
 	}
 
@@ -151,11 +207,26 @@ update_status Application::Update()
 
 	while(item != list_modules.end() && ret == UPDATE_CONTINUE)
 	{
-		ret = (*item)->PostUpdate();
+		if ((*item)->IsEnabled())
+			ret = (*item)->PostUpdate();
 		item++;
 	}
 
 	FinishUpdate();
+
+	if (benchmarkFrames > 0 && ret == UPDATE_CONTINUE)
+	{
+		benchmarkFrameMs.push_back((float)((double)(SDL_GetPerformanceCounter() - frameStart) * 1000.0 / (double)SDL_GetPerformanceFrequency()));
+		benchmarkDrawCalls += renderer3D->drawCalls;
+		benchmarkTriangles += renderer3D->trianglesDrawn;
+
+		if (benchmarkFrameMs.size() >= benchmarkFrames)
+		{
+			WriteBenchmark();
+			ret = UPDATE_STOP;
+		}
+	}
+
 	return ret;
 }
 
@@ -169,9 +240,55 @@ bool Application::CleanUp()
 		ret = (*item)->CleanUp();
 		item++;
 	}
+
+	jobs.CleanUp();
+
 	return ret;
 }
 
+void Application::WriteBenchmark()
+{
+	double seconds = (double)(SDL_GetPerformanceCounter() - benchmarkStart) / (double)SDL_GetPerformanceFrequency();
+	uint frames = benchmarkFrameMs.size();
+
+	std::vector<float> sorted = benchmarkFrameMs;
+	std::sort(sorted.begin(), sorted.end());
+
+	float average = 0.0f;
+	for (uint i = 0; i < frames; ++i)
+		average += sorted[i];
+	average /= frames;
+
+	JSON_Value* rootValue = json_value_init_object();
+	JSON_Object* root = json_value_get_object(rootValue);
+
+	json_object_set_string(root, "Scene", startScene.c_str());
+	json_object_set_boolean(root, "Headless", headless);
+	json_object_set_boolean(root, "Null renderer", renderer3D->nullBackend);
+	json_object_set_number(root, "Fixed step", module_time->fixedDT);
+	json_object_set_number(root, "Frames", frames);
+	json_object_set_number(root, "Total seconds", seconds);
+	json_object_set_number(root, "Average FPS", seconds > 0.0 ? frames / seconds : 0.0);
+	json_object_set_number(root, "Average ms", average);
+	json_object_set_number(root, "Min ms", sorted.front());
+	json_object_set_number(root, "Max ms", sorted.back());
+	json_object_set_number(root, "P95 ms", sorted[(uint)(frames * 0.95f) < frames ? (uint)(frames * 0.95f) : frames - 1]);
+	json_object_set_number(root, "P99 ms", sorted[(uint)(frames * 0.99f) < frames ? (uint)(frames * 0.99f) : frames - 1]);
+	json_object_set_number(root, "Average draw calls", (double)benchmarkDrawCalls / frames);
+	json_object_set_number(root, "Average triangles", (double)benchmarkTriangles / frames);
+
+	JSON_Value* framesValue = json_value_init_array();
+	JSON_Array* frameArray = json_value_get_array(framesValue);
+	for (uint i = 0; i < frames; ++i)
+		json_array_append_number(frameArray, benchmarkFrameMs[i]);
+	json_object_set_value(root, "Frame ms", framesValue);
+
+	json_serialize_to_file_pretty(rootValue, benchmarkOutput.c_str());
+	json_value_free(rootValue);
+
+	LOG("Benchmark: %u frames in %.2f s, %.3f ms average, %.3f ms max. Written to %s", frames, seconds, average, sorted.back(), benchmarkOutput.c_str());
+}
+
 void Application::AddModule(Module* mod)
 {
 	list_modules.push_back(mod);
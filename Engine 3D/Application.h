@@ -16,9 +16,12 @@
 #include "ModulePicking.h"
 #include "ModuleTime.h"
 #include "ModuleParticleManager.h"
+#include "ModuleDebugDraw.h"
+#include "JobSystem.h"
 
 #include <list>
 #include <vector>
+#include <string>
 
 
 class Application
@@ -37,6 +40,7 @@ public:
 	ModulePicking* picking;
 	Time* module_time;
 	ModuleParticleManager* particle_manager;
+	ModuleDebugDraw* debugDraw;
 
 private:
 
@@ -53,6 +57,9 @@ public:
 	update_status Update();
 	bool CleanUp();
 
+	// -headless, -nullrenderer, -frames N, -fps N, -fixedstep hz, -scene path, -benchmark output
+	void ParseArguments(int argc, char** argv);
+
 	bool toCap = false;
 
 	int capFrames = 60;
@@ -62,10 +69,32 @@ public:
 
 	LCG random;
 
+	// Worker threads shared by the modules
+	JobSystem jobs;
+
+	// Offscreen rendering without the editor UI, for benchmarks on machines without a display
+	bool headless = false;
+
+	// Frames to run before writing the benchmark and exiting, 0 runs until closed
+	uint benchmarkFrames = 0u;
+	std::string benchmarkOutput = "benchmark.json";
+
+	std::string startScene = "Assets\\Scenes\\HousesWorking.json";
+
 private:
 
 	void AddModule(Module* mod);
 	void PrepareUpdate();
 	void FinishUpdate();
+
+	void WriteBenchmark();
+
+private:
+
+	std::vector<float> benchmarkFrameMs;
+	Uint64 benchmarkStart = 0u;
+	Uint64 frameStart = 0u;
+	Uint64 benchmarkDrawCalls = 0u;
+	Uint64 benchmarkTriangles = 0u;
 };
 extern Application* App;
\ No newline at end of file
@@ -0,0 +1,188 @@
+#include "BlockCompression.h"
+#include <emmintrin.h>
+#include <string.h>
+
+static unsigned short To565(const unsigned char* color)
+{
+	return (unsigned short)(((color[0] >> 3) << 11) | ((color[1] >> 2) << 5) | (color[2] >> 3));
+}
+
+static void From565(unsigned short value, int* color)
+{
+	int r = (value >> 11) & 0x1f, g = (value >> 5) & 0x3f, b = value & 0x1f;
+	color[0] = (r << 3) | (r >> 2);
+	color[1] = (g << 2) | (g >> 4);
+	color[2] = (b << 3) | (b >> 2);
+}
+
+// Per channel minimum and maximum of the 16 texels
+static void BlockBounds(const unsigned char* rgba, unsigned char* minColor, unsigned char* maxColor)
+{
+	__m128i row0 = _mm_loadu_si128((const __m128i*)rgba);
+	__m128i row1 = _mm_loadu_si128((const __m128i*)(rgba + 16));
+	__m128i row2 = _mm_loadu_si128((const __m128i*)(rgba + 32));
+	__m128i row3 = _mm_loadu_si128((const __m128i*)(rgba + 48));
+
+	__m128i low = _mm_min_epu8(_mm_min_epu8(row0, row1), _mm_min_epu8(row2, row3));
+	__m128i high = _mm_max_epu8(_mm_max_epu8(row0, row1), _mm_max_epu8(row2, row3));
+
+	// Four texels left per register, fold them
+	low = _mm_min_epu8(low, _mm_shuffle_epi32(low, _MM_SHUFFLE(1, 0, 3, 2)));
+	low = _mm_min_epu8(low, _mm_shuffle_epi32(low, _MM_SHUFFLE(2, 3, 0, 1)));
+	high = _mm_max_epu8(high, _mm_shuffle_epi32(high, _MM_SHUFFLE(1, 0, 3, 2)));
+	high = _mm_max_epu8(high, _mm_shuffle_epi32(high, _MM_SHUFFLE(2, 3, 0, 1)));
+
+	int minPacked = _mm_cvtsi128_si32(low);
+	int maxPacked = _mm_cvtsi128_si32(high);
+	memcpy(minColor, &minPacked, 4);
+	memcpy(maxColor, &maxPacked, 4);
+}
+
+void EncodeBC1Block(const unsigned char* rgba, unsigned char* out)
+{
+	unsigned char minColor[4], maxColor[4];
+	BlockBounds(rgba, minColor, maxColor);
+
+	// Pull the endpoints in a bit, the extremes are rarely worth their precision
+	for (uint c = 0; c < 3; ++c)
+	{
+		int inset = (maxColor[c] - minColor[c]) >> 4;
+		minColor[c] = (unsigned char)(minColor[c] + inset);
+		maxColor[c] = (unsigned char)(maxColor[c] - inset);
+	}
+
+	// The box diagonal has to follow the colors: red and blue go against green when they're anti-correlated with it
+	int mean[3] = { 0, 0, 0 };
+	for (uint i = 0; i < 16; ++i)
+		for (uint c = 0; c < 3; ++c)
+			mean[c] += rgba[i * 4 + c];
+
+	int covarianceR = 0, covarianceB = 0;
+	for (uint i = 0; i < 16; ++i)
+	{
+		int g = rgba[i * 4 + 1] * 16 - mean[1];
+		covarianceR += (rgba[i * 4] * 16 - mean[0]) * g;
+		covarianceB += (rgba[i * 4 + 2] * 16 - mean[2]) * g;
+	}
+
+	if (covarianceR < 0)
+	{
+		unsigned char temp = minColor[0];
+		minColor[0] = maxColor[0];
+		maxColor[0] = temp;
+	}
+	if (covarianceB < 0)
+	{
+		unsigned char temp = minColor[2];
+		minColor[2] = maxColor[2];
+		maxColor[2] = temp;
+	}
+
+	unsigned short color0 = To565(maxColor);
+	unsigned short color1 = To565(minColor);
+	if (color0 < color1)
+	{
+		unsigned short temp = color0;
+		color0 = color1;
+		color1 = temp;
+	}
+
+	uint indices = 0u;
+	if (color0 != color1)
+	{
+		int palette[4][3];
+		From565(color0, palette[0]);
+		From565(color1, palette[1]);
+		for (uint c = 0; c < 3; ++c)
+		{
+			palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+			palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+		}
+
+		for (uint i = 0; i < 16; ++i)
+		{
+			const unsigned char* texel = rgba + i * 4;
+			uint best = 0u;
+			int bestDistance = 0x7fffffff;
+			for (uint p = 0; p < 4; ++p)
+			{
+				int dr = texel[0] - palette[p][0], dg = texel[1] - palette[p][1], db = texel[2] - palette[p][2];
+				int distance = dr * dr + dg * dg + db * db;
+				if (distance < bestDistance)
+				{
+					bestDistance = distance;
+					best = p;
+				}
+			}
+			indices |= best << (i * 2);
+		}
+	}
+
+	out[0] = (unsigned char)(color0 & 0xff);
+	out[1] = (unsigned char)(color0 >> 8);
+	out[2] = (unsigned char)(color1 & 0xff);
+	out[3] = (unsigned char)(color1 >> 8);
+	memcpy(out + 4, &indices, 4);
+}
+
+void EncodeBC3Block(const unsigned char* rgba, unsigned char* out)
+{
+	unsigned char minColor[4], maxColor[4];
+	BlockBounds(rgba, minColor, maxColor);
+
+	int alpha0 = maxColor[3], alpha1 = minColor[3];
+	unsigned long long indices = 0ull;
+
+	// Eight value mode (alpha0 > alpha1): the endpoints plus six interpolated values
+	if (alpha0 != alpha1)
+	{
+		int palette[8];
+		palette[0] = alpha0;
+		palette[1] = alpha1;
+		for (int k = 2; k < 8; ++k)
+			palette[k] = ((8 - k) * alpha0 + (k - 1) * alpha1) / 7;
+
+		for (uint i = 0; i < 16; ++i)
+		{
+			int alpha = rgba[i * 4 + 3];
+			uint best = 0u;
+			int bestDistance = 256;
+			for (uint p = 0; p < 8; ++p)
+			{
+				int distance = alpha > palette[p] ? alpha - palette[p] : palette[p] - alpha;
+				if (distance < bestDistance)
+				{
+					bestDistance = distance;
+					best = p;
+				}
+			}
+			indices |= (unsigned long long)best << (i * 3);
+		}
+	}
+
+	out[0] = (unsigned char)alpha0;
+	out[1] = (unsigned char)alpha1;
+	for (uint i = 0; i < 6; ++i)
+		out[2 + i] = (unsigned char)(indices >> (8 * i));
+
+	EncodeBC1Block(rgba, out + 8);
+}
+
+void ExtractBlock(const unsigned char* image, uint width, uint height, uint blockX, uint blockY, unsigned char* rgba)
+{
+	for (uint y = 0; y < 4; ++y)
+	{
+		uint sourceY = blockY * 4 + y;
+		if (sourceY >= height)
+			sourceY = height - 1;
+
+		for (uint x = 0; x < 4; ++x)
+		{
+			uint sourceX = blockX * 4 + x;
+			if (sourceX >= width)
+				sourceX = width - 1;
+
+			memcpy(rgba + (y * 4 + x) * 4, image + (sourceY * width + sourceX) * 4, 4);
+		}
+	}
+}
@@ -0,0 +1,13 @@
+#pragma once
+#include "Globals.h"
+
+// Range fit encoders for 4x4 RGBA8 blocks (64 bytes, rows top to bottom). The color bounds are found with SSE2.
+
+// 8 bytes: two RGB565 endpoints and 2 bit indices, alpha ignored
+void EncodeBC1Block(const unsigned char* rgba, unsigned char* out);
+
+// 16 bytes: interpolated alpha block followed by a BC1 color block
+void EncodeBC3Block(const unsigned char* rgba, unsigned char* out);
+
+// Copies the block at (blockX, blockY) of an RGBA8 image, repeating the last row and column past the edges
+void ExtractBlock(const unsigned char* image, uint width, uint height, uint blockX, uint blockY, unsigned char* rgba);
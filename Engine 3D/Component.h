@@ -12,7 +12,8 @@ enum Object_Type
 	CompTexture,
 	CompCamera,
 	CompBillboard,
-	CompEmitter
+	CompEmitter,
+	CompLight
 };
 
 class Component
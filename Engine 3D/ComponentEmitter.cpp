@@ -166,7 +166,7 @@ void ComponentEmitter::Update()
 	if (gameObject->HasComponent(CompTexture))
 	{
 		ComponentTexture* tex = (ComponentTexture*)gameObject->GetComponent(CompTexture);
-		texture = tex->RTexture;
+		texture = tex->GetTexture();
 	}
 
 	if (subEmitter && !subEmitterExists)
@@ -0,0 +1,65 @@
+#include "ComponentLight.h"
+#include "Application.h"
+
+ComponentLight::ComponentLight(GameObject* parent) : Component(parent, CompLight)
+{
+	parent->components.push_back(this);
+	App->renderer3D->light_list.push_back(this);
+}
+
+ComponentLight::~ComponentLight()
+{
+	App->renderer3D->light_list.remove(this);
+}
+
+void ComponentLight::Inspector()
+{
+	if (ImGui::CollapsingHeader("Light", ImGuiTreeNodeFlags_DefaultOpen))
+	{
+		ImGui::ColorEdit3("Color", &color.x);
+		ImGui::DragFloat("Intensity", &intensity, 0.05f, 0.0f, 100.0f, "%.2f");
+		ImGui::DragFloat("Range", &range, 0.1f, 0.1f, 1000.0f, "%.1f");
+	}
+}
+
+float3 ComponentLight::GetPosition() const
+{
+	return gameObject->transform->GetMatrix().TranslatePart();
+}
+
+void ComponentLight::Save(JSON_Object * parent)
+{
+	json_object_set_number(parent, "Type", type);
+	json_object_set_number(parent, "UUID", uuid);
+
+	// Color
+	//------------------------------------------------------------------------
+	JSON_Value* col = json_value_init_object();
+	JSON_Object* colorObj = json_value_get_object(col);
+
+	json_object_set_value(parent, "Color", col);
+
+	json_object_set_number(colorObj, "R", color.x);
+	json_object_set_number(colorObj, "G", color.y);
+	json_object_set_number(colorObj, "B", color.z);
+	//------------------------------------------------------------------------
+
+	json_object_set_number(parent, "Intensity", intensity);
+	json_object_set_number(parent, "Range", range);
+}
+
+void ComponentLight::Load(JSON_Object * parent)
+{
+	uuid = json_object_get_number(parent, "UUID");
+
+	// Color
+	//------------------------------------------------------------------------
+	JSON_Object* col = json_object_get_object(parent, "Color");
+	color.x = json_object_get_number(col, "R");
+	color.y = json_object_get_number(col, "G");
+	color.z = json_object_get_number(col, "B");
+	//------------------------------------------------------------------------
+
+	intensity = json_object_get_number(parent, "Intensity");
+	range = json_object_get_number(parent, "Range");
+}
@@ -0,0 +1,28 @@
+#pragma once
+#include "Component.h"
+#include "MathGeoLib/MathGeoLib.h"
+
+// Point light, drawn by the clustered path and mapped to the fixed function lights when it isn't available
+class ComponentLight :
+	public Component
+{
+public:
+	ComponentLight(GameObject* parent);
+	~ComponentLight();
+
+	void Inspector();
+
+	float3 GetPosition() const;
+
+	void Save(JSON_Object* parent);
+
+	void Load(JSON_Object* parent);
+
+public:
+
+	float3 color = float3::one;
+	float intensity = 1.0f;
+
+	// Distance where the contribution reaches zero
+	float range = 10.0f;
+};
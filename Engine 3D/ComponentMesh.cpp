@@ -17,8 +17,9 @@ ComponentMesh::ComponentMesh(GameObject* parent) : Component(parent, CompMesh)
 
 ComponentMesh::~ComponentMesh()
 {
+	App->game_object->pendingMeshes.remove(this);
 	App->renderer3D->mesh_list.remove(this);
-	App->resources->ResourceUsageDecreased(mesh);
+	App->resources->ResourceUsageDecreased(GetMesh());
 	gameObject->boundingBox.SetNegativeInfinity();
 	gameObject->originalBoundingBox.SetNegativeInfinity();
 }
@@ -28,11 +29,50 @@ void ComponentMesh::Inspector()
 	if (ImGui::CollapsingHeader("Mesh", ImGuiTreeNodeFlags_DefaultOpen))
 	{
 		ImGui::Checkbox("Mesh Active", &print);
-		ImGui::Text("Number of vertices: %u", mesh->vertex.size);
+
+		ResourceMesh* mesh = GetMesh();
+		if (mesh == nullptr)
+		{
+			ImGui::Text("Resource released");
+			if (ImGui::Button("Delete Mesh"))
+				App->game_object->componentsToDelete.push_back(this);
+			return;
+		}
+
+		ImGui::Text("Number of vertices: %u", mesh->GetVertexCount());
 		ImGui::Text("Number of faces: %u", mesh->index.size / 3);
+		if (mesh->packedFormat)
+			ImGui::Text("Vertex format: packed, %s positions, %u bytes", mesh->halfPositions ? "half" : "float", mesh->stride);
+		else
+			ImGui::Text("Vertex format: separate float streams");
+		ImGui::Text("Index format: %u bits", mesh->shortIndices ? 16 : 32);
+		ImGui::Text("GPU memory: %.1f KB", mesh->GetGPUMemory() / 1024.0f);
+		if (mesh->acmrBeforeOptimization > 0.0f)
+			ImGui::Text("ACMR: %.3f (%.3f before optimization)", mesh->acmr, mesh->acmrBeforeOptimization);
+		else
+			ImGui::Text("ACMR: %.3f", mesh->acmr);
+
+		if (mesh->lods.size() > 1)
+		{
+			ImGui::Text("LOD: %u of %u", currentLOD, mesh->lods.size() - 1);
+			for (uint i = 0; i < mesh->lods.size(); ++i)
+				ImGui::Text("  Level %u: %u faces, error %.4f", i, mesh->lods[i].indexCount / 3, mesh->lods[i].error);
+			ImGui::SliderInt("Force LOD", &forcedLOD, -1, mesh->lods.size() - 1);
+		}
 
 		ImGui::Checkbox("Vertex normals", &printVertexNormals);
 
+		ImGui::Text("Library encoding: %s", mesh->encoded ? "compressed" : "raw");
+		if (mesh->uuid != 0 && ImGui::Button(mesh->encoded ? "Store raw in Library" : "Compress in Library"))
+		{
+			// Evicted streams are only requested here, the file gets rewritten once they're back
+			bool resident = App->resources->residency.Touch(mesh, true) && mesh->vertex.data != nullptr;
+			if (!resident || !App->import->ReencodeMesh(mesh, !mesh->encoded))
+			{
+				LOG("Couldn't rewrite the Library file of %s%s", mesh->name.c_str(), resident ? "" : ", its streams are still loading");
+			}
+		}
+
 		ImGui::Text("Resource used %i times", mesh->usage);
 
 		if (ImGui::Button("Delete Mesh"))
@@ -44,71 +84,151 @@ void ComponentMesh::Inspector()
 
 void ComponentMesh::Draw()
 {
-	if (gameObject->active && print)
+	// Evicted meshes skip the draw until they're back
+	ResourceMesh* mesh = GetMesh();
+	if (gameObject->active && print && mesh != nullptr && App->resources->residency.Touch(mesh))
 	{
+		if (App->renderer3D->nullBackend)
+		{
+			// Keep the CPU side of the draw so simulation profiles match
+			const MeshLOD& lod = mesh->lods[SelectLOD(App->renderer3D->current_cam)];
+			App->renderer3D->drawCalls++;
+			App->renderer3D->trianglesDrawn += lod.indexCount / 3;
+			return;
+		}
+
 		ComponentTransform* transform = gameObject->transform;
 		glPushMatrix();
 		float4x4 mat = transform->GetMatrixOGL();
 
 		glMultMatrixf(mat.ptr());
 
-		glEnableClientState(GL_VERTEX_ARRAY);
-		glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+		GLStateCache& state = App->renderer3D->glState;
 
-		glBindBuffer(GL_ARRAY_BUFFER, mesh->vertex.id);
-		glVertexPointer(3, GL_FLOAT, 0, NULL);
-		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		bool texCoords = mesh->uvs.size > 0 && (mesh->packedFormat || mesh->uvs.id != 0);
 
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh->index.id);
+		// Every state the draw depends on is set here, nothing is reset afterwards
+		state.EnableClientState(GL_VERTEX_ARRAY);
+		state.SetClientState(GL_TEXTURE_COORD_ARRAY, texCoords);
 
-		if (gameObject)
+		if (mesh->packedFormat)
 		{
-			ComponentTexture* tex = (ComponentTexture*)gameObject->GetComponent(CompTexture);
-			if (tex)
+			state.BindBuffer(GL_ARRAY_BUFFER, mesh->packed.id);
+			glVertexPointer(3, mesh->halfPositions ? GL_HALF_FLOAT : GL_FLOAT, mesh->stride, NULL);
+
+			if (texCoords)
 			{
-				if (tex->print)
-				{
-					glEnable(GL_TEXTURE_2D);
-					glBindTexture(GL_TEXTURE_2D, tex->GetID());
-				}
+				glTexCoordPointer(2, GL_SHORT, mesh->stride, (void*)mesh->texCoordOffset);
+
+				// Expand the quantized uvs back to the mesh uv bounds
+				glMatrixMode(GL_TEXTURE);
+				glLoadIdentity();
+				glTranslatef(mesh->uvMin[0] + 32768.0f * mesh->uvRange[0] / 65535.0f, mesh->uvMin[1] + 32768.0f * mesh->uvRange[1] / 65535.0f, 0.0f);
+				glScalef(mesh->uvRange[0] / 65535.0f, mesh->uvRange[1] / 65535.0f, 1.0f);
+				glMatrixMode(GL_MODELVIEW);
 			}
+		}
+		else
+		{
+			state.BindBuffer(GL_ARRAY_BUFFER, mesh->vertex.id);
+			glVertexPointer(3, GL_FLOAT, 0, NULL);
 
-			if (printVertexNormals && mesh->hasNormals)
+			if (texCoords)
 			{
-				int size = 2;
-				glColor3f(0.0f, 1.0f, 0.0f);
-
-				for (uint i = 0; i < mesh->vertex.size; i += 3)
-				{
-					glBegin(GL_LINES);
-					glVertex3f(mesh->vertex.data[i], mesh->vertex.data[i + 1], mesh->vertex.data[i + 2]);
-					glVertex3f(mesh->vertex.data[i] + mesh->normals.data[i] * size, mesh->vertex.data[i + 1] + mesh->normals.data[i + 1] * size, mesh->vertex.data[i + 2] + mesh->normals.data[i + 2] * size);
-					glEnd();
-				}
-				glColor3f(1.0f, 1.0f, 1.0f);
+				state.BindBuffer(GL_ARRAY_BUFFER, mesh->uvs.id);
+				glTexCoordPointer(2, GL_FLOAT, 0, NULL);
 			}
 		}
 
-		glBindBuffer(GL_ARRAY_BUFFER, mesh->uvs.id);
-		glTexCoordPointer(2, GL_FLOAT, 0, NULL);
+		state.BindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh->index.id);
+
+		if (gameObject)
+		{
+			ComponentTexture* tex = (ComponentTexture*)gameObject->GetComponent(CompTexture);
+			bool textured = tex != nullptr && tex->print;
+
+			state.SetEnabled(GL_TEXTURE_2D, textured);
+			if (textured)
+				state.BindTexture(tex->GetID());
+		}
+
+		const MeshLOD& lod = mesh->lods[SelectLOD(App->renderer3D->current_cam)];
+		uint indexSize = mesh->shortIndices ? sizeof(unsigned short) : sizeof(uint);
 
-		glDrawElements(GL_TRIANGLES, mesh->index.size, GL_UNSIGNED_INT, NULL);
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+		glDrawElements(GL_TRIANGLES, lod.indexCount, mesh->GetIndexType(), (void*)(lod.indexOffset * indexSize));
+		App->renderer3D->drawCalls++;
+		App->renderer3D->trianglesDrawn += lod.indexCount / 3;
 
-		glDisableClientState(GL_VERTEX_ARRAY);
-		glDisableClientState(GL_TEXTURE_COORD_ARRAY);
-		glBindTexture(GL_TEXTURE_2D, 0);
-		glDisable(GL_TEXTURE_2D);
+		if (mesh->packedFormat && texCoords)
+		{
+			glMatrixMode(GL_TEXTURE);
+			glLoadIdentity();
+			glMatrixMode(GL_MODELVIEW);
+		}
 
 		glPopMatrix();
 	}
 }
 
+void ComponentMesh::DrawNormals()
+{
+	ResourceMesh* mesh = GetMesh();
+	if (!gameObject->active || !print || !printVertexNormals || mesh == nullptr || !mesh->hasNormals)
+		return;
+
+	if (!App->resources->residency.Touch(mesh, true) || mesh->normals.data == nullptr)
+		return;
+
+	// Debug lines are batched in world space
+	float4x4 global = gameObject->transform->GetMatrix();
+	float size = 2.0f;
+
+	for (uint i = 0; i < mesh->vertex.size; i += 3)
+	{
+		float3 position(&mesh->vertex.data[i]);
+		float3 normal(&mesh->normals.data[i]);
+		App->debugDraw->DrawLine(global.TransformPos(position), global.TransformPos(position + normal * size), Green);
+	}
+}
+
+uint ComponentMesh::SelectLOD(const ComponentCamera* camera)
+{
+	ResourceMesh* mesh = GetMesh();
+	if (mesh == nullptr || mesh->lods.size() < 2)
+		return 0u;
+
+	if (forcedLOD >= 0)
+		return (uint)forcedLOD < mesh->lods.size() ? forcedLOD : mesh->lods.size() - 1;
+
+	if (!App->renderer3D->useLODs || camera == nullptr || !gameObject->boundingBox.IsFinite())
+		return 0u;
+
+	float radius = gameObject->boundingBox.HalfDiagonal().Length();
+	float distance = camera->frustum.pos.Distance(gameObject->boundingBox.CenterPoint());
+
+	// Fraction of the half screen height covered by the bounding sphere
+	float screenSize = 1.0f;
+	if (distance > radius)
+		screenSize = radius / (distance * tanf(camera->frustum.verticalFov * 0.5f));
+	screenSize *= App->renderer3D->lodBias;
+
+	if (camera != lodCamera)
+	{
+		lodCamera = camera;
+		currentLOD = mesh->SelectLOD(screenSize, 0u, 0.0f);
+	}
+	else
+		currentLOD = mesh->SelectLOD(screenSize, currentLOD, App->renderer3D->lodHysteresis);
+
+	return currentLOD;
+}
+
 void ComponentMesh::Save(JSON_Object * parent)
 {
 	json_object_set_number(parent, "Type", type);
 	json_object_set_number(parent, "UUID", uuid);
-	json_object_set_string(parent, "Name", mesh->name.c_str());
+	ResourceMesh* mesh = GetMesh();
+	json_object_set_string(parent, "Name", mesh != nullptr ? mesh->name.c_str() : "");
 }
 
 void ComponentMesh::Load(JSON_Object * parent)
@@ -117,13 +237,52 @@ void ComponentMesh::Load(JSON_Object * parent)
 
 	std::string name = json_object_get_string(parent, "Name");
 
-	mesh = new ResourceMesh(name.c_str());
+	// Every component of the same mesh shares one resource, read and uploaded once
+	Resource* shared = App->resources->GetResourceByUUID(uuid);
+	if (shared != nullptr && shared->type == ResourceType::Mesh)
+	{
+		App->resources->ResourceUsageIncreased(shared);
+		SetMesh((ResourceMesh*)shared);
+		App->game_object->loadReport.meshesShared++;
+	}
+	else
+	{
+		ResourceMesh* mesh = new ResourceMesh(name.c_str());
+		mesh->uuid = uuid;
+		App->resources->AddResource(mesh);
+		SetMesh(mesh);
+		mesh->Load(App->game_object->GetLoadPriority(gameObject));
+		App->game_object->loadReport.meshesLoaded++;
+	}
 
-	App->import->LoadMeshImporter(mesh, uuid, App->resources->LoadFile(nullptr, ResourceType::Mesh, uuid));
+	// Even when the mesh is there already, the parents aren't known yet
+	App->game_object->pendingMeshes.push_back(this);
+}
 
-	App->renderer3D->mesh_list.push_back(this);
+ResourceMesh* ComponentMesh::GetMesh() const
+{
+	return App->resources->GetMesh(meshHandle);
+}
 
-	App->resources->AddResource(mesh);
+void ComponentMesh::SetMesh(ResourceMesh* mesh)
+{
+	meshHandle = mesh != nullptr ? mesh->handle : ResourceHandle();
+}
+
+void ComponentMesh::OnMeshReady()
+{
+	ResourceMesh* mesh = GetMesh();
+	if (mesh == nullptr)
+		return;
+
+	gameObject->originalBoundingBox = mesh->bounds;
+
+	// Only this object's box, the whole tree and quadtree get rebuilt when the scene finishes
+	OBB obb = gameObject->originalBoundingBox.ToOBB();
+	obb.Transform(gameObject->transform->GetMatrix());
+	gameObject->boundingBox = obb.MinimalEnclosingAABB();
+
+	App->renderer3D->mesh_list.push_back(this);
 
 	App->sceneIntro->quadtree.QT_Insert(gameObject);
 }
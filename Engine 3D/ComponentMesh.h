@@ -1,6 +1,8 @@
 #pragma once
 #include "Component.h"
 #include "ResourceMesh.h"
+#include "ComponentCamera.h"
+#include "ResourceLoader.h"
 #include <string>
 
 class ComponentMesh :
@@ -14,15 +16,36 @@ public:
 
 	void Draw();
 
+	// Queues the vertex normals in the debug draw when enabled
+	void DrawNormals();
+
+	// Level for the camera being rendered, from the projected size of the bounding box
+	uint SelectLOD(const ComponentCamera* camera);
+
 	void Save(JSON_Object* parent);
 
+	// Takes the mesh from the registry when another component already has it, otherwise queues its Library file.
+	// The object joins the render list from ModuleGameObject once the mesh is uploaded.
 	void Load(JSON_Object* parent);
 
+	void OnMeshReady();
+
+	// Resolved through the registry at every use, nullptr once the mesh is gone
+	ResourceMesh* GetMesh() const;
+	void SetMesh(ResourceMesh* mesh);
+
 public:
-	ResourceMesh* mesh;
+	ResourceHandle meshHandle;
 
 	bool print = true;
 
 	bool printVertexNormals = false;
 	bool printFacesNormals = false;
+
+	// Level picked last time and the camera it was picked for, a different camera starts over without hysteresis
+	uint currentLOD = 0u;
+	const ComponentCamera* lodCamera = nullptr;
+
+	// -1 lets the distance pick the level
+	int forcedLOD = -1;
 };
\ No newline at end of file
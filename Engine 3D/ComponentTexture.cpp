@@ -10,7 +10,7 @@ ComponentTexture::ComponentTexture(GameObject* parent) : Component(parent, CompT
 
 ComponentTexture::~ComponentTexture()
 {
-	App->resources->ResourceUsageDecreased(RTexture);
+	App->resources->ResourceUsageDecreased(GetTexture());
 }
 
 void ComponentTexture::Inspector()
@@ -19,9 +19,13 @@ void ComponentTexture::Inspector()
 	{
 		ImGui::Checkbox("Texture Active", &print);
 		ImGui::Text("%s", path.c_str());
-		ImGui::Image((void*)(intptr_t)RTexture->id, ImVec2(225,225), ImVec2(0.0f, 1.0f), ImVec2(1.0f, 0.0f));
+		ResourceTexture* texture = GetTexture();
+		ImGui::Image((void*)(intptr_t)(texture != nullptr ? texture->id : 0u), ImVec2(225,225), ImVec2(0.0f, 1.0f), ImVec2(1.0f, 0.0f));
 		ImGui::Checkbox("Checkers", &checkers);
-		ImGui::Text("Resource used %i times", RTexture->usage);
+		if (texture != nullptr)
+			ImGui::Text("Resource used %i times", texture->usage);
+		else
+			ImGui::Text("Resource released");
 
 		if (ImGui::Button("Delete Texture"))
 		{
@@ -32,7 +36,24 @@ void ComponentTexture::Inspector()
 
 unsigned int ComponentTexture::GetID()
 {
-	return checkers == false ? RTexture->id : App->import->checkerImageID;
+	// The checker stands in while the texture is still cooking or reloading
+	ResourceTexture* texture = GetTexture();
+	if (checkers || texture == nullptr || !App->resources->residency.Touch(texture) || texture->id == 0)
+		return App->import->checkerImageID;
+
+	App->import->streamer.Touch(texture);
+
+	return texture->id;
+}
+
+ResourceTexture* ComponentTexture::GetTexture() const
+{
+	return App->resources->GetTexture(textureHandle);
+}
+
+void ComponentTexture::SetTexture(ResourceTexture* texture)
+{
+	textureHandle = texture != nullptr ? texture->handle : ResourceHandle();
 }
 
 void ComponentTexture::Save(JSON_Object * parent)
@@ -52,9 +73,20 @@ void ComponentTexture::Load(JSON_Object * parent)
 
 	path = json_object_get_string(parent, "Path");
 
-	RTexture = new ResourceTexture(path.c_str());
+	// Same path, same resource, the checker stands in until its one load completes
+	ResourceTexture* texture = (ResourceTexture*)App->resources->GetResource(ResourceType::Texture, path.c_str());
+	if (texture != nullptr)
+	{
+		App->resources->ResourceUsageIncreased(texture);
+		SetTexture(texture);
+		App->game_object->loadReport.texturesShared++;
+		return;
+	}
 
-	App->import->RealLoadTexture(path.c_str(), RTexture->id);
+	texture = new ResourceTexture(path.c_str());
+	App->resources->AddResource(texture);
+	SetTexture(texture);
 
-	App->resources->AddResource(RTexture);
+	App->import->RealLoadTexture(path.c_str(), texture, App->game_object->GetLoadPriority(gameObject));
+	App->game_object->loadReport.texturesLoaded++;
 }
\ No newline at end of file
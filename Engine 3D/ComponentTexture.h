@@ -19,8 +19,12 @@ public:
 
 	void Load(JSON_Object* parent);
 
+	// Resolved through the registry at every use, nullptr once the texture is gone
+	ResourceTexture* GetTexture() const;
+	void SetTexture(ResourceTexture* texture);
+
 public:
-	ResourceTexture* RTexture;
+	ResourceHandle textureHandle;
 
 	std::string name;
 
@@ -0,0 +1,185 @@
+#include "Compression.h"
+#include <string.h>
+#include <vector>
+
+#define LZ4_MIN_MATCH 4
+// The last match starts at least 12 bytes from the end and the last 5 bytes are always literals
+#define LZ4_MF_LIMIT 12
+#define LZ4_LAST_LITERALS 5
+#define LZ4_MAX_OFFSET 65535
+#define LZ4_HASH_LOG 12
+
+static uint Read32(const char* pointer)
+{
+	uint value;
+	memcpy(&value, pointer, sizeof(uint));
+	return value;
+}
+
+static uint HashSequence(uint sequence)
+{
+	return (sequence * 2654435761u) >> (32 - LZ4_HASH_LOG);
+}
+
+// 15 in the token nibble, then 255 bytes until the remainder
+static bool WriteLength(uint length, char*& out, const char* end)
+{
+	for (; length >= 255; length -= 255)
+	{
+		if (out >= end)
+			return false;
+		*out++ = (char)255;
+	}
+	if (out >= end)
+		return false;
+	*out++ = (char)length;
+	return true;
+}
+
+static bool WriteSequence(const char* literals, uint literalLength, uint offset, uint matchLength, char*& out, const char* end)
+{
+	if (out >= end)
+		return false;
+
+	char* token = out++;
+	uint literalNibble = literalLength < 15 ? literalLength : 15;
+	uint matchNibble = 0u;
+	if (matchLength > 0)
+		matchNibble = matchLength - LZ4_MIN_MATCH < 15 ? matchLength - LZ4_MIN_MATCH : 15;
+	*token = (char)((literalNibble << 4) | matchNibble);
+
+	if (literalLength >= 15 && !WriteLength(literalLength - 15, out, end))
+		return false;
+
+	if (out + literalLength > end)
+		return false;
+	memcpy(out, literals, literalLength);
+	out += literalLength;
+
+	// The last sequence has literals only
+	if (matchLength == 0)
+		return true;
+
+	if (out + 2 > end)
+		return false;
+	*out++ = (char)(offset & 0xff);
+	*out++ = (char)(offset >> 8);
+
+	if (matchLength - LZ4_MIN_MATCH >= 15 && !WriteLength(matchLength - LZ4_MIN_MATCH - 15, out, end))
+		return false;
+
+	return true;
+}
+
+uint LZ4CompressBound(uint size)
+{
+	return size + size / 255 + 16;
+}
+
+uint LZ4Compress(const char* source, uint size, char* destination, uint capacity)
+{
+	char* out = destination;
+	const char* end = destination + capacity;
+
+	uint anchor = 0u;
+
+	if (size >= LZ4_MF_LIMIT)
+	{
+		// Position + 1 of the last occurrence of each hashed 4 byte sequence, 0 is empty
+		std::vector<uint> table(1 << LZ4_HASH_LOG, 0u);
+
+		uint matchLimit = size - LZ4_LAST_LITERALS;
+		uint position = 0u;
+
+		while (position + LZ4_MF_LIMIT <= size)
+		{
+			uint sequence = Read32(source + position);
+			uint& slot = table[HashSequence(sequence)];
+			uint candidate = slot;
+			slot = position + 1;
+
+			if (candidate == 0 || position - (candidate - 1) > LZ4_MAX_OFFSET || Read32(source + candidate - 1) != sequence)
+			{
+				position++;
+				continue;
+			}
+
+			uint match = candidate - 1;
+			uint length = LZ4_MIN_MATCH;
+			while (position + length < matchLimit && source[match + length] == source[position + length])
+				length++;
+
+			if (!WriteSequence(source + anchor, position - anchor, position - match, length, out, end))
+				return 0u;
+
+			position += length;
+			anchor = position;
+		}
+	}
+
+	if (!WriteSequence(source + anchor, size - anchor, 0u, 0u, out, end))
+		return 0u;
+
+	return out - destination;
+}
+
+static bool ReadLength(const unsigned char*& in, const unsigned char* end, uint& length)
+{
+	unsigned char value = 0;
+	do
+	{
+		if (in >= end)
+			return false;
+		value = *in++;
+		length += value;
+	} while (value == 255);
+	return true;
+}
+
+bool LZ4Decompress(const char* source, uint size, char* destination, uint destinationSize)
+{
+	const unsigned char* in = (const unsigned char*)source;
+	const unsigned char* inEnd = in + size;
+	uint written = 0u;
+
+	while (in < inEnd)
+	{
+		unsigned char token = *in++;
+
+		uint literalLength = token >> 4;
+		if (literalLength == 15 && !ReadLength(in, inEnd, literalLength))
+			return false;
+
+		if (literalLength > (uint)(inEnd - in) || literalLength > destinationSize - written)
+			return false;
+		memcpy(destination + written, in, literalLength);
+		in += literalLength;
+		written += literalLength;
+
+		if (in == inEnd)
+			break;
+
+		if (inEnd - in < 2)
+			return false;
+		uint offset = in[0] | (in[1] << 8);
+		in += 2;
+		if (offset == 0 || offset > written)
+			return false;
+
+		uint matchLength = token & 15;
+		if (matchLength == 15 && !ReadLength(in, inEnd, matchLength))
+			return false;
+		matchLength += LZ4_MIN_MATCH;
+
+		if (matchLength > destinationSize - written)
+			return false;
+
+		// Byte by byte, the match may overlap what it's writing
+		const char* match = destination + written - offset;
+		for (uint i = 0; i < matchLength; ++i)
+			destination[written + i] = match[i];
+		written += matchLength;
+	}
+
+	return written == destinationSize;
+}
@@ -0,0 +1,14 @@
+#pragma once
+#include "Globals.h"
+
+// LZ4 block format (no frame header): the output decodes with any LZ4 block decoder and this decoder reads blocks
+// written by the reference compressor. Greedy single-probe matching, favours speed over ratio.
+
+// Worst case compressed size for incompressible input
+uint LZ4CompressBound(uint size);
+
+// Returns the compressed size, 0 when it doesn't fit in capacity
+uint LZ4Compress(const char* source, uint size, char* destination, uint capacity);
+
+// destinationSize is the exact decompressed size, false on malformed input
+bool LZ4Decompress(const char* source, uint size, char* destination, uint destinationSize);
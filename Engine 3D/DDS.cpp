@@ -0,0 +1,204 @@
+#include "DDS.h"
+#include <string.h>
+
+#define DDSD_CAPS 0x1
+#define DDSD_HEIGHT 0x2
+#define DDSD_WIDTH 0x4
+#define DDSD_PIXELFORMAT 0x1000
+#define DDSD_MIPMAPCOUNT 0x20000
+#define DDSD_LINEARSIZE 0x80000
+#define DDPF_FOURCC 0x4
+#define DDSCAPS_COMPLEX 0x8
+#define DDSCAPS_TEXTURE 0x1000
+#define DDSCAPS_MIPMAP 0x400000
+
+static uint ReadUint(const char* data, uint offset)
+{
+	uint value = 0u;
+	memcpy(&value, data + offset, sizeof(uint));
+	return value;
+}
+
+bool ParseDDS(char* data, uint size, DDSImage& image)
+{
+	if (data == nullptr || size < DDS_HEADER_SIZE || ReadUint(data, 0) != DDS_MAGIC)
+		return false;
+
+	uint flags = ReadUint(data, 8);
+	image.height = ReadUint(data, 12);
+	image.width = ReadUint(data, 16);
+	uint mipCount = (flags & DDSD_MIPMAPCOUNT) ? ReadUint(data, 28) : 1u;
+
+	uint formatFlags = ReadUint(data, 80);
+	uint fourCC = ReadUint(data, 84);
+	if ((formatFlags & DDPF_FOURCC) == 0)
+		return false;
+
+	switch (fourCC)
+	{
+	case FOURCC('D', 'X', 'T', '1'): image.format = BlockFormat::DXT1; break;
+	case FOURCC('D', 'X', 'T', '3'): image.format = BlockFormat::DXT3; break;
+	case FOURCC('D', 'X', 'T', '5'): image.format = BlockFormat::DXT5; break;
+	default: return false;
+	}
+
+	if (mipCount == 0)
+		mipCount = 1;
+
+	image.levels.clear();
+
+	uint offset = DDS_HEADER_SIZE;
+	uint width = image.width, height = image.height;
+	for (uint i = 0; i < mipCount; ++i)
+	{
+		DDSLevel level;
+		level.width = width;
+		level.height = height;
+		level.size = GetCompressedSize(image.format, width, height);
+
+		// Truncated files keep the levels that are complete
+		if (offset + level.size > size)
+			break;
+
+		level.data = data + offset;
+		image.levels.push_back(level);
+
+		offset += level.size;
+		width = width > 1 ? width / 2 : 1;
+		height = height > 1 ? height / 2 : 1;
+	}
+
+	return !image.levels.empty();
+}
+
+static void WriteUint(char* data, uint offset, uint value)
+{
+	memcpy(data + offset, &value, sizeof(uint));
+}
+
+void WriteDDSHeader(char* out, BlockFormat format, uint width, uint height, uint mipCount)
+{
+	memset(out, 0, DDS_HEADER_SIZE);
+
+	uint fourCC = FOURCC('D', 'X', 'T', '5');
+	if (format == BlockFormat::DXT1)
+		fourCC = FOURCC('D', 'X', 'T', '1');
+	else if (format == BlockFormat::DXT3)
+		fourCC = FOURCC('D', 'X', 'T', '3');
+
+	WriteUint(out, 0, DDS_MAGIC);
+	WriteUint(out, 4, 124);
+	WriteUint(out, 8, DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT | DDSD_MIPMAPCOUNT | DDSD_LINEARSIZE);
+	WriteUint(out, 12, height);
+	WriteUint(out, 16, width);
+	WriteUint(out, 20, GetCompressedSize(format, width, height));
+	WriteUint(out, 28, mipCount);
+
+	WriteUint(out, 76, 32);
+	WriteUint(out, 80, DDPF_FOURCC);
+	WriteUint(out, 84, fourCC);
+
+	WriteUint(out, 108, DDSCAPS_TEXTURE | (mipCount > 1 ? DDSCAPS_MIPMAP | DDSCAPS_COMPLEX : 0));
+}
+
+uint GetBlockSize(BlockFormat format)
+{
+	return format == BlockFormat::DXT1 ? 8u : 16u;
+}
+
+uint GetCompressedSize(BlockFormat format, uint width, uint height)
+{
+	uint blocksX = (width + 3) / 4;
+	uint blocksY = (height + 3) / 4;
+	return (blocksX > 0 ? blocksX : 1) * (blocksY > 0 ? blocksY : 1) * GetBlockSize(format);
+}
+
+// ------------------------------------------------------------
+// Rows 0..rows-1 of one block reversed, the rest stay
+static void FlipColorBlock(unsigned char* block, uint rows)
+{
+	// 2 endpoints, then one byte of 2 bit indices per row
+	unsigned char* indices = block + 4;
+	for (uint i = 0; i < rows / 2; ++i)
+	{
+		unsigned char temp = indices[i];
+		indices[i] = indices[rows - 1 - i];
+		indices[rows - 1 - i] = temp;
+	}
+}
+
+static void FlipExplicitAlphaBlock(unsigned char* block, uint rows)
+{
+	// 4 bits per texel, two bytes per row
+	for (uint i = 0; i < rows / 2; ++i)
+	{
+		unsigned char* a = block + i * 2;
+		unsigned char* b = block + (rows - 1 - i) * 2;
+		unsigned char temp[2] = { a[0], a[1] };
+		a[0] = b[0]; a[1] = b[1];
+		b[0] = temp[0]; b[1] = temp[1];
+	}
+}
+
+static void FlipInterpolatedAlphaBlock(unsigned char* block, uint rows)
+{
+	// 2 endpoints, then 48 bits of 3 bit indices, 12 bits per row
+	unsigned long long bits = 0ull;
+	for (uint i = 0; i < 6; ++i)
+		bits |= (unsigned long long)block[2 + i] << (8 * i);
+
+	unsigned long long flipped = bits;
+	for (uint row = 0; row < rows; ++row)
+	{
+		unsigned long long source = (bits >> (12 * (rows - 1 - row))) & 0xfffull;
+		flipped &= ~(0xfffull << (12 * row));
+		flipped |= source << (12 * row);
+	}
+
+	for (uint i = 0; i < 6; ++i)
+		block[2 + i] = (unsigned char)(flipped >> (8 * i));
+}
+
+static void FlipBlock(unsigned char* block, BlockFormat format, uint rows)
+{
+	switch (format)
+	{
+	case BlockFormat::DXT1:
+		FlipColorBlock(block, rows);
+		break;
+	case BlockFormat::DXT3:
+		FlipExplicitAlphaBlock(block, rows);
+		FlipColorBlock(block + 8, rows);
+		break;
+	case BlockFormat::DXT5:
+		FlipInterpolatedAlphaBlock(block, rows);
+		FlipColorBlock(block + 8, rows);
+		break;
+	default:
+		break;
+	}
+}
+
+void FlipCompressedLevel(DDSLevel& level, BlockFormat format)
+{
+	uint blockSize = GetBlockSize(format);
+	uint blocksX = (level.width + 3) / 4;
+	uint blocksY = (level.height + 3) / 4;
+	uint rowBytes = blocksX * blockSize;
+	uint rows = level.height < 4 ? level.height : 4;
+
+	std::vector<unsigned char> temp(rowBytes);
+	unsigned char* data = (unsigned char*)level.data;
+
+	for (uint y = 0; y < blocksY / 2; ++y)
+	{
+		unsigned char* top = data + y * rowBytes;
+		unsigned char* bottom = data + (blocksY - 1 - y) * rowBytes;
+		memcpy(temp.data(), top, rowBytes);
+		memcpy(top, bottom, rowBytes);
+		memcpy(bottom, temp.data(), rowBytes);
+	}
+
+	for (uint i = 0; i < blocksX * blocksY; ++i)
+		FlipBlock(data + i * blockSize, format, rows);
+}
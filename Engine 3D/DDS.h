@@ -0,0 +1,48 @@
+#pragma once
+#include "Globals.h"
+#include <vector>
+
+#define DDS_MAGIC 0x20534444 // "DDS "
+#define DDS_HEADER_SIZE 128
+
+#define FOURCC(a, b, c, d) ((uint)(a) | ((uint)(b) << 8) | ((uint)(c) << 16) | ((uint)(d) << 24))
+
+enum class BlockFormat
+{
+	None = -1,
+
+	DXT1,
+	DXT3,
+	DXT5
+};
+
+struct DDSLevel
+{
+	char* data = nullptr;
+	uint size = 0u;
+	uint width = 0u;
+	uint height = 0u;
+};
+
+// Block compressed image inside a DDS file, levels point into the file data
+struct DDSImage
+{
+	uint width = 0u;
+	uint height = 0u;
+	BlockFormat format = BlockFormat::None;
+	std::vector<DDSLevel> levels;
+};
+
+// Reads the header and the mip chain of a DXT1/3/5 file, false for anything else (uncompressed, DX10 headers)
+bool ParseDDS(char* data, uint size, DDSImage& image);
+
+// Bytes per 4x4 block
+uint GetBlockSize(BlockFormat format);
+
+uint GetCompressedSize(BlockFormat format, uint width, uint height);
+
+// Fills the 128 bytes before the first level: magic, header and FourCC pixel format
+void WriteDDSHeader(char* out, BlockFormat format, uint width, uint height, uint mipCount);
+
+// DDS rows go top to bottom and GL expects the bottom row first, flips the blocks and the rows inside them
+void FlipCompressedLevel(DDSLevel& level, BlockFormat format);
@@ -0,0 +1,264 @@
+#include "GLStateCache.h"
+#include "Glew/include/glew.h"
+
+static GLTargetState* Find(std::vector<GLTargetState>& states, uint target)
+{
+	for (uint i = 0; i < states.size(); ++i)
+	{
+		if (states[i].target == target)
+			return &states[i];
+	}
+
+	GLTargetState state;
+	state.target = target;
+	states.push_back(state);
+
+	return &states.back();
+}
+
+GLStateCache::GLStateCache()
+{
+}
+
+void GLStateCache::Invalidate()
+{
+	// Capabilities stay listed, only their value is forgotten
+	for (uint i = 0; i < capabilities.size(); ++i)
+		capabilities[i].value = GL_STATE_UNKNOWN;
+	for (uint i = 0; i < clientStates.size(); ++i)
+		clientStates[i].value = GL_STATE_UNKNOWN;
+	for (uint i = 0; i < buffers.size(); ++i)
+		buffers[i].value = GL_STATE_UNKNOWN;
+
+	InvalidateTexture();
+
+	program = GL_STATE_UNKNOWN;
+	vertexArray = GL_STATE_UNKNOWN;
+	polygonMode = GL_STATE_UNKNOWN;
+	blendSource = blendDestination = GL_STATE_UNKNOWN;
+	alphaFunction = GL_STATE_UNKNOWN;
+	alphaReference = -1.0f;
+	lineWidth = -1.0f;
+}
+
+void GLStateCache::InvalidateTexture()
+{
+	for (uint i = 0; i < textures.size(); ++i)
+		textures[i].value = GL_STATE_UNKNOWN;
+
+	activeTexture = GL_STATE_UNKNOWN;
+}
+
+void GLStateCache::BeginFrame()
+{
+	lastCallsForwarded = callsForwarded;
+	lastCallsAvoided = callsAvoided;
+
+	callsForwarded = 0u;
+	callsAvoided = 0u;
+}
+
+bool GLStateCache::Redundant(bool same)
+{
+	if (nullBackend)
+		return true;
+
+	if (same)
+		callsAvoided++;
+	else
+		callsForwarded++;
+
+	return same;
+}
+
+void GLStateCache::Enable(uint capability)
+{
+	SetEnabled(capability, true);
+}
+
+void GLStateCache::Disable(uint capability)
+{
+	SetEnabled(capability, false);
+}
+
+void GLStateCache::SetEnabled(uint capability, bool enable)
+{
+	GLTargetState* state = Find(capabilities, capability);
+	if (Redundant(state->value == (uint)enable))
+		return;
+
+	state->value = enable;
+	if (enable)
+		glEnable(capability);
+	else
+		glDisable(capability);
+}
+
+bool GLStateCache::IsEnabled(uint capability)
+{
+	// Only asks GL the first time or after an invalidate
+	GLTargetState* state = Find(capabilities, capability);
+	if (state->value == GL_STATE_UNKNOWN)
+		state->value = !nullBackend && glIsEnabled(capability) ? 1u : 0u;
+
+	return state->value == 1u;
+}
+
+void GLStateCache::EnableClientState(uint array)
+{
+	SetClientState(array, true);
+}
+
+void GLStateCache::DisableClientState(uint array)
+{
+	SetClientState(array, false);
+}
+
+void GLStateCache::SetClientState(uint array, bool enable)
+{
+	GLTargetState* state = Find(clientStates, array);
+	if (Redundant(state->value == (uint)enable))
+		return;
+
+	state->value = enable;
+	if (enable)
+		glEnableClientState(array);
+	else
+		glDisableClientState(array);
+}
+
+// ------------------------------------------------------------
+void GLStateCache::BindBuffer(uint target, uint buffer)
+{
+	GLTargetState* state = Find(buffers, target);
+	if (Redundant(state->value == buffer))
+		return;
+
+	state->value = buffer;
+	glBindBuffer(target, buffer);
+}
+
+void GLStateCache::DeleteBuffer(uint& buffer)
+{
+	if (buffer == 0 || nullBackend)
+		return;
+
+	// GL unbinds deleted buffers, and the name can come back from the next glGenBuffers
+	for (uint i = 0; i < buffers.size(); ++i)
+	{
+		if (buffers[i].value == buffer)
+			buffers[i].value = 0u;
+	}
+
+	glDeleteBuffers(1, (GLuint*)&buffer);
+	buffer = 0u;
+}
+
+void GLStateCache::ActiveTexture(uint unit)
+{
+	if (Redundant(activeTexture == unit))
+		return;
+
+	// Bindings are per unit, the cache only tracks the active one. After an invalidate the binds went to
+	// whatever unit GL had active, so they're forgotten on every real switch, known previous unit or not.
+	for (uint i = 0; i < textures.size(); ++i)
+		textures[i].value = GL_STATE_UNKNOWN;
+
+	activeTexture = unit;
+	glActiveTexture(unit);
+}
+
+void GLStateCache::BindTexture(uint texture)
+{
+	BindTexture(GL_TEXTURE_2D, texture);
+}
+
+void GLStateCache::BindTexture(uint target, uint texture)
+{
+	GLTargetState* state = Find(textures, target);
+	if (Redundant(state->value == texture))
+		return;
+
+	state->value = texture;
+	glBindTexture(target, texture);
+}
+
+void GLStateCache::DeleteTexture(uint& texture)
+{
+	if (texture == 0 || nullBackend)
+		return;
+
+	for (uint i = 0; i < textures.size(); ++i)
+	{
+		if (textures[i].value == texture)
+			textures[i].value = 0u;
+	}
+
+	glDeleteTextures(1, (GLuint*)&texture);
+	texture = 0u;
+}
+
+void GLStateCache::UseProgram(uint program)
+{
+	if (Redundant(this->program == program))
+		return;
+
+	this->program = program;
+	glUseProgram(program);
+}
+
+void GLStateCache::BindVertexArray(uint vertexArray)
+{
+	if (Redundant(this->vertexArray == vertexArray))
+		return;
+
+	this->vertexArray = vertexArray;
+	glBindVertexArray(vertexArray);
+
+	Find(buffers, GL_ELEMENT_ARRAY_BUFFER)->value = GL_STATE_UNKNOWN;
+}
+
+// ------------------------------------------------------------
+void GLStateCache::PolygonMode(uint mode)
+{
+	if (Redundant(polygonMode == mode))
+		return;
+
+	polygonMode = mode;
+	glPolygonMode(GL_FRONT_AND_BACK, mode);
+}
+
+uint GLStateCache::GetPolygonMode() const
+{
+	// Nothing sets a different front and back mode, fill until told otherwise
+	return polygonMode == GL_STATE_UNKNOWN ? GL_FILL : polygonMode;
+}
+
+void GLStateCache::BlendFunc(uint source, uint destination)
+{
+	if (Redundant(blendSource == source && blendDestination == destination))
+		return;
+
+	blendSource = source;
+	blendDestination = destination;
+	glBlendFunc(source, destination);
+}
+
+void GLStateCache::AlphaFunc(uint function, float reference)
+{
+	if (Redundant(alphaFunction == function && alphaReference == reference))
+		return;
+
+	alphaFunction = function;
+	alphaReference = reference;
+	glAlphaFunc(function, reference);
+}
+
+void GLStateCache::LineWidth(float width)
+{
+	if (Redundant(lineWidth == width))
+		return;
+
+	lineWidth = width;
+	glLineWidth(width);
+}
@@ -0,0 +1,88 @@
+#pragma once
+#include "Globals.h"
+#include <vector>
+
+#define GL_STATE_UNKNOWN 0xffffffff
+
+// Cached value of a per-target state (capability, client array, buffer or texture binding)
+struct GLTargetState
+{
+	uint target = 0u;
+	uint value = GL_STATE_UNKNOWN;
+};
+
+// Shadows the GL state the engine touches and only forwards calls that change it.
+// Code outside the cache that changes tracked state (DevIL, ImGui without restore) must call the matching Invalidate.
+class GLStateCache
+{
+public:
+	GLStateCache();
+
+	// Forgets every cached value, the next call of each kind is forwarded
+	void Invalidate();
+	void InvalidateTexture();
+
+	// Frame counters, last* hold the previous frame for display
+	void BeginFrame();
+
+	void Enable(uint capability);
+	void Disable(uint capability);
+	void SetEnabled(uint capability, bool enable);
+	bool IsEnabled(uint capability);
+
+	void EnableClientState(uint array);
+	void DisableClientState(uint array);
+	void SetClientState(uint array, bool enable);
+
+	void BindBuffer(uint target, uint buffer);
+	void DeleteBuffer(uint& buffer);
+
+	void ActiveTexture(uint unit);
+	void BindTexture(uint texture);
+	void BindTexture(uint target, uint texture);
+	void DeleteTexture(uint& texture);
+
+	void UseProgram(uint program);
+
+	// Switching vertex arrays also forgets the element buffer binding, it belongs to the array
+	void BindVertexArray(uint vertexArray);
+
+	void PolygonMode(uint mode);
+	uint GetPolygonMode() const;
+
+	void BlendFunc(uint source, uint destination);
+	void AlphaFunc(uint function, float reference);
+	void LineWidth(float width);
+
+private:
+
+	bool Redundant(bool same);
+
+public:
+
+	// Null renderer: calls are tracked but nothing reaches GL
+	bool nullBackend = false;
+
+	uint callsForwarded = 0u;
+	uint callsAvoided = 0u;
+
+	uint lastCallsForwarded = 0u;
+	uint lastCallsAvoided = 0u;
+
+private:
+
+	std::vector<GLTargetState> capabilities;
+	std::vector<GLTargetState> clientStates;
+	std::vector<GLTargetState> buffers;
+	std::vector<GLTargetState> textures;
+
+	uint activeTexture = GL_STATE_UNKNOWN;
+	uint program = GL_STATE_UNKNOWN;
+	uint vertexArray = GL_STATE_UNKNOWN;
+	uint polygonMode = GL_STATE_UNKNOWN;
+	uint blendSource = GL_STATE_UNKNOWN;
+	uint blendDestination = GL_STATE_UNKNOWN;
+	uint alphaFunction = GL_STATE_UNKNOWN;
+	float alphaReference = -1.0f;
+	float lineWidth = -1.0f;
+};
@@ -142,10 +142,9 @@ void GameObject::Load(JSON_Object * info)
 			break;
 		case CompMesh:
 		{
+			// Bounds arrive with the mesh data
 			ComponentMesh* mesh = new ComponentMesh(this);
 			mesh->Load(comp);
-			originalBoundingBox.Enclose((float3*)mesh->mesh->vertex.data, mesh->mesh->vertex.size / 3);
-			boundingBox = originalBoundingBox;
 		}
 			break;
 		case CompTexture:
@@ -166,6 +165,13 @@ void GameObject::Load(JSON_Object * info)
 			ComponentEmitter* emit = new ComponentEmitter(this);
 			emit->Load(comp);
 		}
+			break;
+		case CompLight:
+		{
+			ComponentLight* light = new ComponentLight(this);
+			light->Load(comp);
+		}
+			break;
 		default:
 			break;
 		}
@@ -0,0 +1,53 @@
+#include "Hash.h"
+#include "MappedFile.h"
+
+unsigned long long HashBytes(const void* data, uint size, unsigned long long seed)
+{
+	const unsigned long long m = 0xc6a4a7935bd1e995ull;
+	const int r = 47;
+
+	unsigned long long h = seed ^ (size * m);
+
+	const unsigned char* bytes = (const unsigned char*)data;
+	const unsigned char* end = bytes + (size & ~7u);
+
+	for (; bytes != end; bytes += 8)
+	{
+		unsigned long long k;
+		memcpy(&k, bytes, sizeof(k));
+
+		k *= m;
+		k ^= k >> r;
+		k *= m;
+
+		h ^= k;
+		h *= m;
+	}
+
+	switch (size & 7)
+	{
+	case 7: h ^= (unsigned long long)bytes[6] << 48;
+	case 6: h ^= (unsigned long long)bytes[5] << 40;
+	case 5: h ^= (unsigned long long)bytes[4] << 32;
+	case 4: h ^= (unsigned long long)bytes[3] << 24;
+	case 3: h ^= (unsigned long long)bytes[2] << 16;
+	case 2: h ^= (unsigned long long)bytes[1] << 8;
+	case 1: h ^= (unsigned long long)bytes[0];
+		h *= m;
+	};
+
+	h ^= h >> r;
+	h *= m;
+	h ^= h >> r;
+
+	return h;
+}
+
+unsigned long long HashFile(const char* path)
+{
+	MappedFile file;
+	if (!file.Open(path))
+		return 0ull;
+
+	return HashBytes(file.GetData(), file.GetSize());
+}
@@ -0,0 +1,8 @@
+#pragma once
+#include "Globals.h"
+
+// 64 bit MurmurHash2 (MurmurHash64A), not cryptographic
+unsigned long long HashBytes(const void* data, uint size, unsigned long long seed = 0ull);
+
+// Hash of the whole file through a mapping, 0 when it can't be opened
+unsigned long long HashFile(const char* path);
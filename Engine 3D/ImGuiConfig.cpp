@@ -92,55 +92,197 @@ void ImGuiConfig::Draw()
 			GLenum capability = 0;
 
 			capability = GL_DEPTH_TEST;
-			bool depthTest = glIsEnabled(capability);
+			bool depthTest = App->renderer3D->glState.IsEnabled(capability);
 			if (ImGui::Checkbox("GL_DEPTH_TEST", &depthTest))
 				SetState(capability, depthTest);
 
 
 			capability = GL_CULL_FACE;
-			bool cullFace = glIsEnabled(capability);
+			bool cullFace = App->renderer3D->glState.IsEnabled(capability);
 			if (ImGui::Checkbox("GL_CULL_FACE", &cullFace))
 				SetState(capability, cullFace);
 
 			capability = GL_LIGHTING;
-			bool lighting = glIsEnabled(capability);
+			bool lighting = App->renderer3D->glState.IsEnabled(capability);
 			if (ImGui::Checkbox("GL_LIGHTING", &lighting))
 				SetState(capability, lighting);
 
 			capability = GL_COLOR_MATERIAL;
-			bool colorMaterial = glIsEnabled(capability);
+			bool colorMaterial = App->renderer3D->glState.IsEnabled(capability);
 			if (ImGui::Checkbox("GL_COLOR_MATERIAL", &colorMaterial))
 				SetState(capability, colorMaterial);
 
 			capability = GL_TEXTURE_2D;
-			bool texture2D = glIsEnabled(capability);
+			bool texture2D = App->renderer3D->glState.IsEnabled(capability);
 			if (ImGui::Checkbox("GL_TEXTURE_2D", &texture2D))
 				SetState(capability, texture2D);
 
 			capability = GL_LINE_SMOOTH;
-			bool lineSmooth = glIsEnabled(capability);
+			bool lineSmooth = App->renderer3D->glState.IsEnabled(capability);
 			if (ImGui::Checkbox("GL_LINE_SMOOTH", &lineSmooth))
 				SetState(capability, lineSmooth);
 
 			capability = GL_BLEND;
-			bool blend = glIsEnabled(capability);
+			bool blend = App->renderer3D->glState.IsEnabled(capability);
 			if (ImGui::Checkbox("GL_BLEND", &blend))
 				SetState(capability, blend);
 
-			bool wireframeMode = false;
-			GLint polygonMode[2];
-			glGetIntegerv(GL_POLYGON_MODE, polygonMode);
-
-			if (polygonMode[0] == GL_LINE && polygonMode[1] == GL_LINE)
-				wireframeMode = true;
+			bool wireframeMode = App->renderer3D->glState.GetPolygonMode() == GL_LINE;
 			if (ImGui::Checkbox("Wireframe", &wireframeMode))
+				App->renderer3D->glState.PolygonMode(wireframeMode ? GL_LINE : GL_FILL);
+
+			ImGui::Checkbox("Grid", &App->debugDraw->drawGrid);
+
+			ImGui::Separator();
+			ImGui::Checkbox("Mesh LODs", &App->renderer3D->useLODs);
+			if (App->renderer3D->useLODs)
 			{
-				if (wireframeMode)
+				ImGui::SliderFloat("LOD bias", &App->renderer3D->lodBias, 0.1f, 4.0f);
+				ImGui::SliderFloat("LOD hysteresis", &App->renderer3D->lodHysteresis, 0.0f, 0.5f);
+			}
+			if (App->renderer3D->indirect.IsSupported())
+			{
+				ImGui::Checkbox("Multi-draw indirect", &App->renderer3D->useIndirect);
+				if (App->renderer3D->useIndirect)
+				{
+					ImGui::Text("Indirect: %u commands in %u buckets, megabuffers %u / %u vertices, %u / %u indices live", App->renderer3D->indirect.commands, App->renderer3D->indirect.buckets,
+						App->renderer3D->indirect.vertexRanges.used, App->renderer3D->indirect.vertexRanges.end, App->renderer3D->indirect.indexRanges.used, App->renderer3D->indirect.indexRanges.end);
+					ImGui::Text("Instancing: %u objects, %u commands drew more than one", App->renderer3D->indirect.instances, App->renderer3D->indirect.instancedCommands);
+				}
+				if (App->renderer3D->textureArrays.IsSupported())
 				{
-					glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+					const TextureArrays& arrays = App->renderer3D->textureArrays;
+					const IndirectRenderer& indirect = App->renderer3D->indirect;
+					ImGui::Checkbox("Texture arrays", &App->renderer3D->useTextureArrays);
+					ImGui::Text("Texture binds: %u, %u without arrays (%u saved)", indirect.textureBinds, indirect.textureBindsWithoutArrays, indirect.textureBindsWithoutArrays > indirect.textureBinds ? indirect.textureBindsWithoutArrays - indirect.textureBinds : 0u);
+					ImGui::Text("Arrays: %u with %u layers, %u KB", arrays.GetArrayCount(), arrays.layersUsed, arrays.gpuMemory / 1024);
 				}
-				else
-					glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+				ImGui::Checkbox("Clustered lighting", &App->renderer3D->clusteredLighting);
+				if (App->renderer3D->clusteredLighting)
+				{
+					const LightClusters& clusters = App->renderer3D->clusters;
+					ImGui::Text("Clusters %ux%ux%u: %u lights, %u indices, max %u per cluster", CLUSTERS_X, CLUSTERS_Y, CLUSTERS_Z, clusters.lightCount, clusters.indexCount, clusters.maxLightsPerCluster);
+					ImGui::Text("Light assignment: %.3f ms on %u workers", clusters.assignMs, App->jobs.GetWorkerCount());
+				}
+			}
+			ImGui::Checkbox("Batch particles", &App->particle_manager->batchParticles);
+			if (App->renderer3D->ringBuffer.IsReady())
+			{
+				const RingBuffer& ring = App->renderer3D->ringBuffer;
+				ImGui::Text("Ring buffer (%s): %u / %u KB, peak %u KB, %u allocations", ring.IsPersistent() ? "persistent" : "staged", ring.lastBytesAllocated / 1024, ring.frameSize / 1024, ring.peakBytesAllocated / 1024, ring.lastAllocations);
+				ImGui::Text("Ring buffer: %u failed allocations, %u stalls (%.2f ms)", ring.failedAllocations, ring.stalls, ring.stallMs);
+			}
+			ImGui::Text("Draw calls: %u", App->renderer3D->drawCalls);
+			ImGui::Text("Triangles: %u", App->renderer3D->trianglesDrawn);
+			ImGui::Text("Debug draw vertices: %u", App->debugDraw->lastVertices);
+			ImGui::Text("GL state calls: %u forwarded, %u redundant avoided", App->renderer3D->glState.lastCallsForwarded, App->renderer3D->glState.lastCallsAvoided);
+		}
+		if (ImGui::CollapsingHeader("Import"))
+		{
+			ImGui::Checkbox("Packed vertex format", &App->import->packedVertices);
+			if (App->import->packedVertices)
+				ImGui::Checkbox("Half precision positions", &App->import->halfPositions);
+			ImGui::Checkbox("Optimize vertex cache", &App->import->optimizeMeshes);
+			if (App->import->optimizeMeshes)
+				ImGui::Checkbox("Optimize overdraw", &App->import->optimizeOverdraw);
+			ImGui::Checkbox("Generate LODs", &App->import->generateLODs);
+			if (App->import->generateLODs)
+			{
+				ImGui::SliderInt("LOD levels", &App->import->lodLevels, 1, MAX_MESH_LODS - 1);
+				ImGui::SliderFloat("LOD max error", &App->import->lodMaxError, 0.005f, 0.2f);
+			}
+			ImGui::Checkbox("Compress Library meshes", &App->import->encodeMeshes);
+			ModuleImport* import = App->import;
+			if (import->meshBytesWritten > 0)
+				ImGui::Text("Library meshes: %.1f MB written, %.0f%% of raw", import->meshBytesWritten / (1024.0f * 1024.0f), 100.0f * import->meshBytesWritten / import->meshBytesRaw);
+			if (import->meshDecodeTicks > 0)
+				ImGui::Text("Mesh decode: %u meshes, %.0f MB/s", (uint)import->meshesDecoded, (float)((double)import->meshBytesDecoded / (1024.0 * 1024.0) * SDL_GetPerformanceFrequency() / import->meshDecodeTicks));
+			ImGui::Text("Shared meshes: %u nodes reused a mesh in memory, %u a Library file", App->import->models.meshesShared, (uint)App->import->models.libraryFilesShared);
+			ImGui::Text("Resources: %u registered, %u lookups", App->resources->GetResourceCount(), App->resources->lookups);
+
+			ResidencyManager& residency = App->resources->residency;
+			int cpuBudget = (int)(residency.cpuBudget / (1024 * 1024));
+			if (ImGui::SliderInt("CPU budget MB", &cpuBudget, 64, 8192))
+				residency.cpuBudget = (unsigned long long)cpuBudget * 1024 * 1024;
+			int gpuBudget = (int)(residency.gpuBudget / (1024 * 1024));
+			if (ImGui::SliderInt("GPU budget MB", &gpuBudget, 64, 8192))
+				residency.gpuBudget = (unsigned long long)gpuBudget * 1024 * 1024;
+			ImGui::SliderInt("Evict after idle frames", (int*)&residency.minIdleFrames, 1, 1000);
+
+			const char* typeNames[] = { "Meshes", "Textures" };
+			ResourceType types[] = { ResourceType::Mesh, ResourceType::Texture };
+			for (uint i = 0; i < 2; ++i)
+			{
+				const ResidencyStats& stats = residency.GetStats(types[i]);
+				ImGui::Text("%s: %u (%u resident), CPU %.1f MB, GPU %.1f MB", typeNames[i], stats.count, stats.resident, stats.cpuMemory / (1024.0f * 1024.0f), stats.gpuMemory / (1024.0f * 1024.0f));
+			}
+			ImGui::Text("Total CPU %.1f MB, GPU %.1f MB, %u CPU releases, %u unloads, %u reloads", residency.cpuMemory / (1024.0f * 1024.0f), residency.gpuMemory / (1024.0f * 1024.0f), residency.cpuReleases, residency.unloads, residency.reloads);
+
+			VirtualFileSystem& vfs = App->resources->vfs;
+			ImGui::Checkbox("Pack Library on exit", &App->resources->packOnExit);
+			ImGui::SameLine();
+			ImGui::Checkbox("Compress packed textures", &vfs.compressTextures);
+			ImGui::Text("Library archive: %u entries, %u loose files, %u archive reads, %u loose reads, %.1f MB decompressed", vfs.GetArchiveEntryCount(), vfs.GetLooseFileCount(), vfs.archiveReads.load(), vfs.looseReads.load(), vfs.bytesDecompressed.load() / (1024.0f * 1024.0f));
+
+			ResourceLoader& loader = App->resources->loader;
+			if (App->game_object->sceneLoading)
+				ImGui::ProgressBar(loader.GetBatchProgress(), ImVec2(-1.0f, 0.0f), "Loading scene");
+			const SceneLoadReport& report = App->game_object->loadReport;
+			ImGui::Text("Scene load: %u meshes / %u textures read, %u / %u duplicates avoided", report.meshesLoaded, report.texturesLoaded, report.meshesShared, report.texturesShared);
+			ImGui::Text("Resource loader: %u pending, %u files read (%.1f MB), completions %.2f ms", loader.GetPending(), loader.filesRead.load(), loader.bytesRead.load() / (1024.0f * 1024.0f), loader.lastCompletionMs);
+			ImGui::SliderFloat("Completion budget ms", &loader.completionBudgetMs, 0.5f, 16.0f);
+
+			ModelImporter& models = App->import->models;
+			int meshBudget = models.uploadBudget / 1024;
+			if (ImGui::SliderInt("Mesh upload KB/frame", &meshBudget, 256, 65536))
+				models.uploadBudget = meshBudget * 1024;
+			ImGui::Text("Models importing: %u, imported: %u (%u unchanged, last %.1f ms), last frame %u KB", models.GetPending(), models.modelsImported, models.modelsReused, models.lastImportMs, models.lastUploadedBytes / 1024);
+			ImGui::Text("Textures cooking: %u, cooked: %u (last %.1f ms), reused: %u", App->import->cooker.GetPending(), App->import->cooker.texturesCooked, App->import->cooker.lastCookMs, App->import->cooker.texturesReused);
+
+			ImportDatabase& importDB = App->resources->importDB;
+			ImGui::Text("Import database: %u records, %u hits, %u misses, %.1f MB hashed", importDB.GetRecordCount(), importDB.hits, importDB.misses, importDB.bytesHashed / (1024.0f * 1024.0f));
+			// Reimports leave the old meshes behind, saved scenes may still use them
+			if (importDB.GetOrphanCount() > 0 && ImGui::Button("Delete orphaned Library meshes"))
+			{
+				uint deleted = importDB.DeleteOrphanedMeshes();
+				LOG("Deleted %u orphaned Library meshes", deleted);
+			}
+
+			TextureStreamer& streamer = App->import->streamer;
+			int uploadBudget = streamer.uploadBudget / 1024;
+			if (ImGui::SliderInt("Texture upload KB/frame", &uploadBudget, 256, 16384))
+				streamer.uploadBudget = uploadBudget * 1024;
+			int vramBudget = streamer.vramBudget / (1024 * 1024);
+			if (ImGui::SliderInt("Texture VRAM budget MB", &vramBudget, 16, 2048))
+				streamer.vramBudget = vramBudget * 1024 * 1024;
+			ImGui::Text("Streaming %u textures, resident %.1f MB, last frame %u KB, %u PBO uploads, %u evictions", streamer.GetStreamingCount(), streamer.residentBytes / (1024.0f * 1024.0f), streamer.lastUploadedBytes / 1024, streamer.pboUploads, streamer.evictions);
+		}
+		if (ImGui::CollapsingHeader("World streaming"))
+		{
+			WorldStreamer& world = App->game_object->streamer;
+			ImGui::SliderFloat("Load radius", &world.loadRadius, 10.0f, 1000.0f);
+			ImGui::SliderFloat("Unload hysteresis", &world.hysteresis, 0.0f, 200.0f);
+			ImGui::SliderFloat("Streaming budget ms", &world.budgetMs, 0.25f, 16.0f);
+			int requestBudget = world.maxCellBytesPerFrame / 1024;
+			if (ImGui::SliderInt("Cell file reads KB/frame", &requestBudget, 64, 65536))
+				world.maxCellBytesPerFrame = requestBudget * 1024;
+			int loadedBudget = world.maxLoadedCellBytes / (1024 * 1024);
+			if (ImGui::SliderInt("Loaded cell files MB", &loadedBudget, 1, 1024))
+				world.maxLoadedCellBytes = loadedBudget * 1024 * 1024;
+			ImGui::SliderInt("Cells in flight", (int*)&world.maxInFlight, 1, 16);
+
+			if (world.IsOpen())
+			{
+				ImGui::Text("Cells: %u, %u loading, %u instantiating, %u loaded, %u unloading, %.1f MB of cell files", world.GetCellCount(), world.GetCellCount(WorldCellState::Loading),
+					world.GetCellCount(WorldCellState::Instantiating), world.GetCellCount(WorldCellState::Loaded), world.GetCellCount(WorldCellState::Unloading), world.GetLoadedCellBytes() / (1024.0f * 1024.0f));
+				ImGui::Text("Objects streamed in: %u, out: %u, last update %.2f ms", world.objectsStreamedIn, world.objectsStreamedOut, world.lastUpdateMs);
+			}
+			else
+			{
+				ImGui::SliderInt("Cell depth", &worldDepth, 1, 8);
+				// Written next to the scene as <name>_World, the scene itself stays as it is
+				if (ImGui::Button("Partition scene into cells"))
+					world.Save((App->imgui->lastSceneName + "_World").c_str(), worldDepth);
 			}
 		}
 		if (ImGui::CollapsingHeader("Input"))
@@ -265,14 +407,5 @@ void ImGuiConfig::Draw()
 
 void ImGuiConfig::SetState(GLenum capability, bool enable) const
 {
-	if (glIsEnabled(capability))
-	{
-		if (!enable)
-			glDisable(capability);
-	}
-	else
-	{
-		if (enable)
-			glEnable(capability);
-	}
+	App->renderer3D->glState.SetEnabled(capability, enable);
 }
\ No newline at end of file
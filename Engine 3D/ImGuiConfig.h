@@ -12,4 +12,7 @@ public:
 	void SetState(GLenum capability, bool enable) const;
 
 	void Draw();
+
+public:
+	int worldDepth = 3;
 };
\ No newline at end of file
@@ -0,0 +1,404 @@
+#include "ImportDatabase.h"
+#include "Application.h"
+#include "ModuleResources.h"
+#include "Hash.h"
+#include "Component.h"
+
+static bool GetFileStamp(const char* path, unsigned long long& size, unsigned long long& time)
+{
+	WIN32_FILE_ATTRIBUTE_DATA attributes;
+	if (!GetFileAttributesEx(path, GetFileExInfoStandard, &attributes))
+		return false;
+
+	size = ((unsigned long long)attributes.nFileSizeHigh << 32) | attributes.nFileSizeLow;
+	time = ((unsigned long long)attributes.ftLastWriteTime.dwHighDateTime << 32) | attributes.ftLastWriteTime.dwLowDateTime;
+	return true;
+}
+
+// JSON numbers are doubles, 64 bit values go as hex strings
+static void SetHex(JSON_Object* object, const char* name, unsigned long long value)
+{
+	char text[17];
+	sprintf_s(text, sizeof(text), "%016llx", value);
+	json_object_set_string(object, name, text);
+}
+
+static unsigned long long GetHex(JSON_Object* object, const char* name)
+{
+	const char* text = json_object_get_string(object, name);
+	return text != nullptr ? strtoull(text, nullptr, 16) : 0ull;
+}
+
+// Every mesh component of a scene, world files and their cells included
+static void CollectSceneMeshes(JSON_Value* value, std::set<uint>& meshes)
+{
+	if (json_value_get_type(value) == JSONArray)
+	{
+		JSON_Array* array = json_value_get_array(value);
+		for (uint i = 0; i < json_array_get_count(array); ++i)
+			CollectSceneMeshes(json_array_get_value(array, i), meshes);
+	}
+	else if (json_value_get_type(value) == JSONObject)
+	{
+		JSON_Object* object = json_value_get_object(value);
+		if (json_object_has_value_of_type(object, "Type", JSONNumber) && (int)json_object_get_number(object, "Type") == CompMesh)
+			meshes.insert((uint)json_object_get_number(object, "UUID"));
+
+		for (uint i = 0; i < json_object_get_count(object); ++i)
+			CollectSceneMeshes(json_object_get_value_at(object, i), meshes);
+	}
+}
+
+ImportDatabase::ImportDatabase()
+{
+}
+
+ImportDatabase::~ImportDatabase()
+{
+}
+
+void ImportDatabase::Load()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	records.clear();
+
+	JSON_Value* rootValue = json_parse_file(IMPORT_DATABASE_FILE);
+	if (json_value_get_type(rootValue) != JSONArray)
+	{
+		json_value_free(rootValue);
+		return;
+	}
+
+	JSON_Array* recordArray = json_value_get_array(rootValue);
+	for (uint i = 0; i < json_array_get_count(recordArray); ++i)
+	{
+		JSON_Object* recordObj = json_array_get_object(recordArray, i);
+
+		const char* source = json_object_get_string(recordObj, "Source");
+		if (source == nullptr)
+			continue;
+
+		ImportRecord record;
+		record.source = source;
+		record.type = (ResourceType)(int)json_object_get_number(recordObj, "Type");
+		record.size = GetHex(recordObj, "Size");
+		record.time = GetHex(recordObj, "Time");
+		record.contentHash = GetHex(recordObj, "Hash");
+		record.settingsHash = GetHex(recordObj, "Settings");
+
+		JSON_Array* nodeArray = json_object_get_array(recordObj, "Nodes");
+		for (uint n = 0; n < json_array_get_count(nodeArray); ++n)
+		{
+			JSON_Object* nodeObj = json_array_get_object(nodeArray, n);
+
+			ImportRecordNode node;
+			node.name = json_object_get_string(nodeObj, "Name");
+			node.parent = (int)json_object_get_number(nodeObj, "Parent");
+			node.meshUUID = (uint)json_object_get_number(nodeObj, "Mesh UUID");
+			node.geometryHash = GetHex(nodeObj, "Geometry");
+			const char* texture = json_object_get_string(nodeObj, "Texture");
+			node.texturePath = texture != nullptr ? texture : "";
+
+			JSON_Array* transform = json_object_get_array(nodeObj, "Transform");
+			if (json_array_get_count(transform) == 16)
+			{
+				for (uint c = 0; c < 16; ++c)
+					node.transform.ptr()[c] = (float)json_array_get_number(transform, c);
+			}
+
+			record.nodes.push_back(node);
+		}
+
+		records[record.source] = record;
+	}
+
+	RebuildGeometry();
+
+	json_value_free(rootValue);
+	dirty = false;
+}
+
+void ImportDatabase::Save()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	JSON_Value* rootValue = json_value_init_array();
+	JSON_Array* recordArray = json_value_get_array(rootValue);
+
+	for (std::map<std::string, ImportRecord>::const_iterator it = records.begin(); it != records.end(); ++it)
+	{
+		const ImportRecord& record = it->second;
+
+		JSON_Value* recordValue = json_value_init_object();
+		JSON_Object* recordObj = json_value_get_object(recordValue);
+
+		json_object_set_string(recordObj, "Source", record.source.c_str());
+		json_object_set_number(recordObj, "Type", (int)record.type);
+		SetHex(recordObj, "Size", record.size);
+		SetHex(recordObj, "Time", record.time);
+		SetHex(recordObj, "Hash", record.contentHash);
+		SetHex(recordObj, "Settings", record.settingsHash);
+
+		if (!record.nodes.empty())
+		{
+			JSON_Value* nodesValue = json_value_init_array();
+			JSON_Array* nodeArray = json_value_get_array(nodesValue);
+
+			for (uint n = 0; n < record.nodes.size(); ++n)
+			{
+				const ImportRecordNode& node = record.nodes[n];
+
+				JSON_Value* nodeValue = json_value_init_object();
+				JSON_Object* nodeObj = json_value_get_object(nodeValue);
+
+				json_object_set_string(nodeObj, "Name", node.name.c_str());
+				json_object_set_number(nodeObj, "Parent", node.parent);
+				json_object_set_number(nodeObj, "Mesh UUID", node.meshUUID);
+				if (node.geometryHash != 0)
+					SetHex(nodeObj, "Geometry", node.geometryHash);
+				if (!node.texturePath.empty())
+					json_object_set_string(nodeObj, "Texture", node.texturePath.c_str());
+
+				JSON_Value* transformValue = json_value_init_array();
+				JSON_Array* transform = json_value_get_array(transformValue);
+				for (uint c = 0; c < 16; ++c)
+					json_array_append_number(transform, node.transform.ptr()[c]);
+				json_object_set_value(nodeObj, "Transform", transformValue);
+
+				json_array_append_value(nodeArray, nodeValue);
+			}
+
+			json_object_set_value(recordObj, "Nodes", nodesValue);
+		}
+
+		json_array_append_value(recordArray, recordValue);
+	}
+
+	json_serialize_to_file_pretty(rootValue, IMPORT_DATABASE_FILE);
+	json_value_free(rootValue);
+
+	dirty = false;
+}
+
+bool ImportDatabase::Find(const char* source, unsigned long long settingsHash, ImportRecord& record, unsigned long long* contentHash)
+{
+	unsigned long long size = 0ull, time = 0ull;
+	if (!GetFileStamp(source, size, time))
+		return false;
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		std::map<std::string, ImportRecord>::const_iterator it = records.find(source);
+		if (it == records.end() || it->second.settingsHash != settingsHash)
+		{
+			misses++;
+			return false;
+		}
+		record = it->second;
+	}
+
+	if (record.size != size || record.time != time)
+	{
+		// Touched, only a different content counts. Hashed outside the lock, it reads the whole file.
+		unsigned long long hash = HashFile(source);
+
+		std::lock_guard<std::mutex> lock(mutex);
+		bytesHashed += size;
+		if (contentHash)
+			*contentHash = hash;
+
+		if (hash != record.contentHash)
+		{
+			misses++;
+			return false;
+		}
+
+		// Same content, the new stamp saves hashing it next time
+		std::map<std::string, ImportRecord>::iterator stored = records.find(source);
+		if (stored != records.end())
+		{
+			stored->second.size = record.size = size;
+			stored->second.time = record.time = time;
+			dirty = true;
+		}
+	}
+
+	if (!ArtifactsExist(record))
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		misses++;
+		return false;
+	}
+
+	std::lock_guard<std::mutex> lock(mutex);
+	hits++;
+	return true;
+}
+
+void ImportDatabase::Store(ImportRecord& record)
+{
+	GetFileStamp(record.source.c_str(), record.size, record.time);
+
+	std::lock_guard<std::mutex> lock(mutex);
+
+	// Meshes of the replaced record no other record references, a changed node got a new uuid
+	std::map<std::string, ImportRecord>::const_iterator previous = records.find(record.source);
+	if (previous != records.end())
+	{
+		for (uint i = 0; i < previous->second.nodes.size(); ++i)
+		{
+			uint uuid = previous->second.nodes[i].meshUUID;
+			if (uuid != 0 && !IsReferenced(uuid, &record))
+				orphans.insert(uuid);
+		}
+	}
+
+	records[record.source] = record;
+
+	// The replaced record's geometry may point at the orphans
+	RebuildGeometry();
+	dirty = true;
+}
+
+void ImportDatabase::Remove(const char* source)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	if (records.erase(source) > 0)
+	{
+		// Its meshes may be the ones that went missing
+		RebuildGeometry();
+		dirty = true;
+	}
+}
+
+bool ImportDatabase::FindGeometry(unsigned long long geometryHash, uint& meshUUID) const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	std::unordered_map<unsigned long long, uint>::const_iterator it = geometry.find(geometryHash);
+	if (it == geometry.end())
+		return false;
+
+	meshUUID = it->second;
+	return true;
+}
+
+bool ImportDatabase::IsDirty() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return dirty;
+}
+
+uint ImportDatabase::GetRecordCount() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return records.size();
+}
+
+uint ImportDatabase::GetOrphanCount() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return orphans.size();
+}
+
+uint ImportDatabase::DeleteOrphanedMeshes()
+{
+	std::set<uint> sceneMeshes;
+
+	WIN32_FIND_DATA data;
+	HANDLE find = FindFirstFile("Assets/Scenes/*.json", &data);
+	if (find != INVALID_HANDLE_VALUE)
+	{
+		do
+		{
+			JSON_Value* scene = json_parse_file((std::string("Assets/Scenes/") + data.cFileName).c_str());
+			CollectSceneMeshes(scene, sceneMeshes);
+			json_value_free(scene);
+		} while (FindNextFile(find, &data));
+
+		FindClose(find);
+	}
+
+	std::vector<uint> deleted;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		std::set<uint>::iterator it = orphans.begin();
+		while (it != orphans.end())
+		{
+			// A reimport or another model may have picked it up again since
+			if (IsReferenced(*it))
+				it = orphans.erase(it);
+			else if (App->resources->GetResourceByUUID(*it) != nullptr || sceneMeshes.find(*it) != sceneMeshes.end())
+				++it;
+			else
+			{
+				deleted.push_back(*it);
+				it = orphans.erase(it);
+			}
+		}
+	}
+
+	for (uint i = 0; i < deleted.size(); ++i)
+		App->resources->vfs.RemoveFile(App->resources->GetDirection(ResourceType::Mesh, deleted[i]).c_str());
+
+	return deleted.size();
+}
+
+bool ImportDatabase::ArtifactsExist(const ImportRecord& record) const
+{
+	if (record.type == ResourceType::Texture)
+		return App->resources->GetLastWriteTime(App->resources->GetDirection(ResourceType::Texture, 0u, record.source.c_str()).c_str()) != 0;
+
+	for (uint i = 0; i < record.nodes.size(); ++i)
+	{
+		if (record.nodes[i].meshUUID != 0 && App->resources->GetLastWriteTime(App->resources->GetDirection(ResourceType::Mesh, record.nodes[i].meshUUID).c_str()) == 0)
+			return false;
+	}
+
+	return true;
+}
+
+bool ImportDatabase::IsReferenced(uint meshUUID, const ImportRecord* replacement) const
+{
+	if (replacement != nullptr)
+	{
+		for (uint i = 0; i < replacement->nodes.size(); ++i)
+		{
+			if (replacement->nodes[i].meshUUID == meshUUID)
+				return true;
+		}
+	}
+
+	// Geometry sharing lets other models use the same Library file
+	for (std::map<std::string, ImportRecord>::const_iterator it = records.begin(); it != records.end(); ++it)
+	{
+		if (replacement != nullptr && it->first == replacement->source)
+			continue;
+
+		for (uint i = 0; i < it->second.nodes.size(); ++i)
+		{
+			if (it->second.nodes[i].meshUUID == meshUUID)
+				return true;
+		}
+	}
+
+	return false;
+}
+
+void ImportDatabase::AddGeometry(const ImportRecord& record)
+{
+	for (uint i = 0; i < record.nodes.size(); ++i)
+	{
+		if (record.nodes[i].geometryHash != 0 && record.nodes[i].meshUUID != 0)
+			geometry.insert(std::make_pair(record.nodes[i].geometryHash, record.nodes[i].meshUUID));
+	}
+}
+
+void ImportDatabase::RebuildGeometry()
+{
+	geometry.clear();
+	for (std::map<std::string, ImportRecord>::const_iterator it = records.begin(); it != records.end(); ++it)
+		AddGeometry(it->second);
+}
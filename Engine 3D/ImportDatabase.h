@@ -0,0 +1,103 @@
+#pragma once
+#include "Globals.h"
+#include "MathGeoLib/MathGeoLib.h"
+#include "Resource.h"
+#include <string>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <set>
+#include <mutex>
+
+#define IMPORT_DATABASE_FILE "Library/imports.json"
+
+// Model node as it was imported, enough to rebuild the hierarchy without the source
+struct ImportRecordNode
+{
+	std::string name;
+	int parent = -1;
+	float4x4 transform = float4x4::identity;
+
+	// 0 for nodes without geometry
+	uint meshUUID = 0u;
+	unsigned long long geometryHash = 0ull;
+	std::string texturePath;
+};
+
+// One source asset: what it looked like and what came out of it
+struct ImportRecord
+{
+	std::string source;
+
+	// Mesh for models, their artifacts are the node meshes. Texture for images, the artifact is the Library DDS.
+	ResourceType type = ResourceType::None;
+
+	unsigned long long size = 0ull;
+	unsigned long long time = 0ull;
+	unsigned long long contentHash = 0ull;
+	unsigned long long settingsHash = 0ull;
+
+	std::vector<ImportRecordNode> nodes;
+};
+
+// Source path -> content hash, import settings and Library artifacts, kept in Library/imports.json.
+// Same size and write time trusts the record, otherwise the content is hashed and only a different hash reimports.
+// Workers query it, every call locks.
+class ImportDatabase
+{
+public:
+	ImportDatabase();
+	~ImportDatabase();
+
+	void Load();
+	void Save();
+
+	// True when the record matches the source and its settings and every artifact exists.
+	// Fills contentHash either way when it had to hash the file.
+	bool Find(const char* source, unsigned long long settingsHash, ImportRecord& record, unsigned long long* contentHash = nullptr);
+
+	// Size and time are read from the file now. Library meshes of the record it replaces that no record uses anymore
+	// become orphans, saved scenes and loaded resources may still use them so they're only deleted by DeleteOrphanedMeshes.
+	void Store(ImportRecord& record);
+
+	void Remove(const char* source);
+
+	// Library mesh some model already wrote for this geometry hash
+	bool FindGeometry(unsigned long long geometryHash, uint& meshUUID) const;
+
+	bool IsDirty() const;
+
+	uint GetRecordCount() const;
+	uint GetOrphanCount() const;
+
+	// Deletes the orphans no record, registered resource or scene in Assets/Scenes uses. Main thread, returns how many went.
+	uint DeleteOrphanedMeshes();
+
+private:
+
+	bool ArtifactsExist(const ImportRecord& record) const;
+
+	// By the replacement or any other record, called with the lock held
+	bool IsReferenced(uint meshUUID, const ImportRecord* replacement = nullptr) const;
+
+	void AddGeometry(const ImportRecord& record);
+	void RebuildGeometry();
+
+public:
+
+	uint hits = 0u;
+	uint misses = 0u;
+	unsigned long long bytesHashed = 0ull;
+
+private:
+
+	mutable std::mutex mutex;
+	std::map<std::string, ImportRecord> records;
+	bool dirty = false;
+
+	// Geometry hash -> mesh uuid, built from the record nodes
+	std::unordered_map<unsigned long long, uint> geometry;
+
+	// Mesh uuids replaced by a reimport, this session
+	std::set<uint> orphans;
+};
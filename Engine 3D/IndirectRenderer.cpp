@@ -0,0 +1,640 @@
+#include "IndirectRenderer.h"
+#include "Application.h"
+#include "ResourceMesh.h"
+#include "ComponentMesh.h"
+#include "ComponentTexture.h"
+#include "ComponentTransform.h"
+#include "ComponentCamera.h"
+#include "ResourceTexture.h"
+#include "Glew/include/glew.h"
+#include <algorithm>
+#include <functional>
+
+#define INITIAL_VERTICES 65536
+#define INITIAL_INDICES (65536 * 3)
+#define INITIAL_DRAWS 1024
+
+static const char* vertexSource =
+	"#version 430\n"
+	"layout(location = 0) in vec3 position;\n"
+	"layout(location = 1) in vec3 normal;\n"
+	"layout(location = 2) in vec2 uv;\n"
+	"layout(location = 3) in uint drawId;\n"
+	"struct DrawData { mat4 model; uint layer; };\n"
+	"layout(std430, binding = 0) readonly buffer Draws { DrawData draws[]; };\n"
+	"uniform mat4 projection;\n"
+	"uniform mat4 view;\n"
+	"out vec3 worldPosition;\n"
+	"out vec3 worldNormal;\n"
+	"out vec2 texCoord;\n"
+	"flat out uint layer;\n"
+	"void main()\n"
+	"{\n"
+	"	mat4 model = draws[drawId].model;\n"
+	"	vec4 world = model * vec4(position, 1.0);\n"
+	"	worldPosition = world.xyz;\n"
+	"	worldNormal = mat3(model) * normal;\n"
+	"	texCoord = uv;\n"
+	"	layer = draws[drawId].layer;\n"
+	"	gl_Position = projection * view * world;\n"
+	"}\n";
+
+// Light 0 has the same response as the fixed function one: 0.25 ambient, 0.75 diffuse, white material.
+// Scene lights come from the cluster of the fragment: screen tile from gl_FragCoord, exponential slice from the depth.
+static const char* fragmentSource =
+	"#version 430\n"
+	"in vec3 worldPosition;\n"
+	"in vec3 worldNormal;\n"
+	"in vec2 texCoord;\n"
+	"flat in uint layer;\n"
+	"struct PointLight { vec4 positionRange; vec4 colorIntensity; };\n"
+	"layout(std430, binding = 1) readonly buffer Lights { PointLight lights[]; };\n"
+	"layout(std430, binding = 2) readonly buffer Clusters { uvec2 clusters[]; };\n"
+	"layout(std430, binding = 3) readonly buffer LightIndices { uint lightIndices[]; };\n"
+	"uniform sampler2D diffuse;\n"
+	"uniform bool textured;\n"
+	"uniform sampler2DArray diffuseArray;\n"
+	"uniform bool arrayTextured;\n"
+	"uniform vec3 lightPosition;\n"
+	"uniform bool clustered;\n"
+	"uniform uvec3 clusterGrid;\n"
+	"uniform vec2 clusterTileSize;\n"
+	"uniform vec2 depthSlicing;\n"
+	"uniform vec3 cameraPosition;\n"
+	"uniform vec3 cameraFront;\n"
+	"out vec4 color;\n"
+	"void main()\n"
+	"{\n"
+	"	vec3 n = normalize(worldNormal);\n"
+	"	vec3 l = normalize(lightPosition - worldPosition);\n"
+	"	vec3 light = vec3(0.25 + 0.75 * max(dot(n, l), 0.0));\n"
+	"	if (clustered)\n"
+	"	{\n"
+	"		float depth = dot(worldPosition - cameraPosition, cameraFront);\n"
+	"		int slice = int(floor(log(max(depth, 0.0001)) * depthSlicing.x + depthSlicing.y));\n"
+	"		if (slice >= 0 && slice < int(clusterGrid.z))\n"
+	"		{\n"
+	"			uvec2 tile = min(uvec2(gl_FragCoord.xy / clusterTileSize), clusterGrid.xy - 1u);\n"
+	"			uvec2 range = clusters[tile.x + clusterGrid.x * (tile.y + clusterGrid.y * uint(slice))];\n"
+	"			for (uint i = 0u; i < range.y; ++i)\n"
+	"			{\n"
+	"				PointLight point = lights[lightIndices[range.x + i]];\n"
+	"				vec3 toLight = point.positionRange.xyz - worldPosition;\n"
+	"				float distance = length(toLight);\n"
+	"				float window = clamp(1.0 - pow(distance / point.positionRange.w, 4.0), 0.0, 1.0);\n"
+	"				float attenuation = window * window / (distance * distance + 1.0);\n"
+	"				light += point.colorIntensity.rgb * point.colorIntensity.w * attenuation * max(dot(n, toLight / max(distance, 0.0001)), 0.0);\n"
+	"			}\n"
+	"		}\n"
+	"	}\n"
+	"	vec4 albedo = arrayTextured ? texture(diffuseArray, vec3(texCoord, float(layer))) : (textured ? texture(diffuse, texCoord) : vec4(1.0));\n"
+	"	color = vec4(albedo.rgb * light, albedo.a);\n"
+	"}\n";
+
+static uint CompileShader(uint type, const char* source)
+{
+	uint shader = glCreateShader(type);
+	glShaderSource(shader, 1, &source, nullptr);
+	glCompileShader(shader);
+
+	GLint success = 0;
+	glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+	if (!success)
+	{
+		char info[512];
+		glGetShaderInfoLog(shader, sizeof(info), nullptr, info);
+		LOG("Indirect shader compile error: %s", info);
+		glDeleteShader(shader);
+		return 0u;
+	}
+
+	return shader;
+}
+
+IndirectRenderer::IndirectRenderer()
+{
+}
+
+IndirectRenderer::~IndirectRenderer()
+{
+}
+
+bool IndirectRenderer::Init()
+{
+	if (!GLEW_VERSION_4_3)
+	{
+		LOG("Multi-draw indirect needs OpenGL 4.3, using per-mesh draws");
+		return false;
+	}
+
+	uint vertexShader = CompileShader(GL_VERTEX_SHADER, vertexSource);
+	uint fragmentShader = CompileShader(GL_FRAGMENT_SHADER, fragmentSource);
+	if (vertexShader == 0 || fragmentShader == 0)
+		return false;
+
+	program = glCreateProgram();
+	glAttachShader(program, vertexShader);
+	glAttachShader(program, fragmentShader);
+	glLinkProgram(program);
+	glDeleteShader(vertexShader);
+	glDeleteShader(fragmentShader);
+
+	GLint success = 0;
+	glGetProgramiv(program, GL_LINK_STATUS, &success);
+	if (!success)
+	{
+		char info[512];
+		glGetProgramInfoLog(program, sizeof(info), nullptr, info);
+		LOG("Indirect shader link error: %s", info);
+		glDeleteProgram(program);
+		program = 0u;
+		return false;
+	}
+
+	projectionLocation = glGetUniformLocation(program, "projection");
+	viewLocation = glGetUniformLocation(program, "view");
+	lightLocation = glGetUniformLocation(program, "lightPosition");
+	texturedLocation = glGetUniformLocation(program, "textured");
+	arrayTexturedLocation = glGetUniformLocation(program, "arrayTextured");
+	clusteredLocation = glGetUniformLocation(program, "clustered");
+	clusterGridLocation = glGetUniformLocation(program, "clusterGrid");
+	clusterTileLocation = glGetUniformLocation(program, "clusterTileSize");
+	depthSlicingLocation = glGetUniformLocation(program, "depthSlicing");
+	cameraPositionLocation = glGetUniformLocation(program, "cameraPosition");
+	cameraFrontLocation = glGetUniformLocation(program, "cameraFront");
+
+	// Samplers of different types can't share a unit, arrays go on unit 1
+	App->renderer3D->glState.UseProgram(program);
+	glUniform1i(glGetUniformLocation(program, "diffuse"), 0);
+	glUniform1i(glGetUniformLocation(program, "diffuseArray"), 1);
+	App->renderer3D->glState.UseProgram(0);
+
+	glGenVertexArrays(1, (GLuint*)&vertexArray);
+	glGenBuffers(1, (GLuint*)&commandBuffer);
+	glGenBuffers(1, (GLuint*)&drawDataBuffer);
+
+	ReserveVertices(INITIAL_VERTICES);
+	ReserveIndices(INITIAL_INDICES);
+	ReserveDraws(INITIAL_DRAWS);
+
+	supported = true;
+	LOG("Multi-draw indirect path ready");
+
+	return true;
+}
+
+void IndirectRenderer::CleanUp()
+{
+	GLStateCache& state = App->renderer3D->glState;
+
+	state.DeleteBuffer(vertexBuffer);
+	state.DeleteBuffer(indexBuffer);
+	state.DeleteBuffer(drawIdBuffer);
+	state.DeleteBuffer(commandBuffer);
+	state.DeleteBuffer(drawDataBuffer);
+
+	if (vertexArray != 0)
+		glDeleteVertexArrays(1, (GLuint*)&vertexArray);
+	if (program != 0)
+		glDeleteProgram(program);
+
+	vertexArray = program = 0u;
+	meshes.clear();
+	supported = false;
+}
+
+bool IndirectRenderer::IsSupported() const
+{
+	return supported;
+}
+
+// ------------------------------------------------------------
+void IndirectRenderer::AddMesh(ResourceMesh* mesh)
+{
+	if (!supported || meshes.find(mesh) != meshes.end())
+		return;
+
+	// Needs the CPU streams, meshes that dropped them keep drawing on their own
+	uint vertexCount = mesh->GetVertexCount();
+	uint indexCount = mesh->index.size + mesh->lodIndex.size;
+	if (vertexCount == 0 || mesh->vertex.data == nullptr || mesh->index.data == nullptr)
+		return;
+
+	std::vector<IndirectVertex> vertices(vertexCount);
+	for (uint i = 0; i < vertexCount; ++i)
+	{
+		vertices[i].position = float3(&mesh->vertex.data[i * 3]);
+		vertices[i].normal = mesh->normals.data ? float3(&mesh->normals.data[i * 3]) : float3::zero;
+		vertices[i].uv = mesh->uvs.data ? float2(mesh->uvs.data[i * 2], mesh->uvs.data[i * 2 + 1]) : float2::zero;
+	}
+
+	// Ranges freed by unloaded meshes get reused, the buffers only grow past the live set
+	MegaMesh entry;
+	entry.baseVertex = vertexRanges.Allocate(vertexCount);
+	entry.firstIndex = indexRanges.Allocate(indexCount);
+	entry.vertexCount = vertexCount;
+	entry.indexCount = indexCount;
+
+	ReserveVertices(vertexRanges.end);
+	ReserveIndices(indexRanges.end);
+
+	GLStateCache& state = App->renderer3D->glState;
+
+	state.BindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+	glBufferSubData(GL_ARRAY_BUFFER, sizeof(IndirectVertex) * entry.baseVertex, sizeof(IndirectVertex) * vertexCount, vertices.data());
+
+	// Indices stay mesh local, the command's base vertex offsets them
+	state.BindBuffer(GL_COPY_WRITE_BUFFER, indexBuffer);
+	glBufferSubData(GL_COPY_WRITE_BUFFER, sizeof(uint) * entry.firstIndex, sizeof(uint) * mesh->index.size, mesh->index.data);
+	if (mesh->lodIndex.size > 0)
+		glBufferSubData(GL_COPY_WRITE_BUFFER, sizeof(uint) * (entry.firstIndex + mesh->index.size), sizeof(uint) * mesh->lodIndex.size, mesh->lodIndex.data);
+
+	meshes[mesh] = entry;
+}
+
+void IndirectRenderer::RemoveMesh(const ResourceMesh* mesh)
+{
+	std::map<const ResourceMesh*, MegaMesh>::iterator it = meshes.find(mesh);
+	if (it == meshes.end())
+		return;
+
+	vertexRanges.Free(it->second.baseVertex, it->second.vertexCount);
+	indexRanges.Free(it->second.firstIndex, it->second.indexCount);
+	meshes.erase(it);
+}
+
+// ------------------------------------------------------------
+uint MegaAllocator::Allocate(uint count)
+{
+	used += count;
+
+	for (std::map<uint, uint>::iterator it = holes.begin(); it != holes.end(); ++it)
+	{
+		if (it->second < count)
+			continue;
+
+		uint offset = it->first;
+		uint left = it->second - count;
+		holes.erase(it);
+		if (left > 0)
+			holes[offset + count] = left;
+
+		return offset;
+	}
+
+	uint offset = end;
+	end += count;
+	return offset;
+}
+
+void MegaAllocator::Free(uint offset, uint count)
+{
+	if (count == 0)
+		return;
+
+	used -= count;
+
+	std::map<uint, uint>::iterator next = holes.lower_bound(offset);
+	if (next != holes.end() && offset + count == next->first)
+	{
+		count += next->second;
+		next = holes.erase(next);
+	}
+
+	if (next != holes.begin())
+	{
+		std::map<uint, uint>::iterator previous = next;
+		--previous;
+		if (previous->first + previous->second == offset)
+		{
+			offset = previous->first;
+			count += previous->second;
+			holes.erase(previous);
+		}
+	}
+
+	// Nothing lives past it, the tail is free space again
+	if (offset + count == end)
+		end = offset;
+	else
+		holes[offset] = count;
+}
+
+// ------------------------------------------------------------
+struct IndirectItem
+{
+	// Array id when the texture is packed, its own id otherwise
+	uint texture = 0u;
+	bool array = false;
+	uint layer = 0u;
+	uint sourceTexture = 0u;
+	ComponentMesh* component = nullptr;
+	const ResourceMesh* mesh = nullptr;
+	const MegaMesh* entry = nullptr;
+	uint lod = 0u;
+};
+
+// Contiguous command range drawn with one texture or texture array
+struct IndirectBucket
+{
+	uint firstCommand = 0u;
+	uint texture = 0u;
+	bool array = false;
+};
+
+void IndirectRenderer::Draw(const std::vector<ComponentMesh*>& visible, ComponentCamera* camera, const float3& lightPosition, const LightClusters* clusters)
+{
+	commands = 0u;
+	buckets = 0u;
+	instancedCommands = 0u;
+	textureBinds = 0u;
+	textureBindsWithoutArrays = 0u;
+
+	TextureArrays& arrays = App->renderer3D->textureArrays;
+	bool useArrays = App->renderer3D->useTextureArrays && arrays.IsSupported();
+
+	std::vector<IndirectItem> items;
+	items.reserve(visible.size());
+
+	for (uint i = 0; i < visible.size(); ++i)
+	{
+		ComponentMesh* component = visible[i];
+		ResourceMesh* mesh = component->GetMesh();
+		if (!component->gameObject->active || !component->print || mesh == nullptr)
+			continue;
+
+		// Drawn through the megabuffers it still counts as visible
+		App->resources->residency.Touch(mesh);
+
+		AddMesh(mesh);
+		std::map<const ResourceMesh*, MegaMesh>::const_iterator found = meshes.find(mesh);
+		if (found == meshes.end())
+		{
+			component->Draw();
+			continue;
+		}
+
+		IndirectItem item;
+		ComponentTexture* texture = (ComponentTexture*)component->gameObject->GetComponent(CompTexture);
+		item.texture = item.sourceTexture = texture != nullptr && texture->print ? texture->GetID() : 0u;
+
+		// Packed lazily like the meshes, once the streamer has every level resident
+		ResourceTexture* resource = texture != nullptr ? texture->GetTexture() : nullptr;
+		if (useArrays && item.texture != 0 && resource != nullptr && item.texture == resource->id && arrays.Add(resource))
+		{
+			item.texture = resource->arrayTexture;
+			item.array = true;
+			item.layer = resource->arrayLayer;
+		}
+
+		item.component = component;
+		item.mesh = mesh;
+		item.entry = &found->second;
+		item.lod = component->SelectLOD(camera);
+		items.push_back(item);
+	}
+
+	if (items.empty())
+		return;
+
+	// Without arrays every distinct texture is a bind of its own
+	std::vector<uint> sourceTextures;
+	for (uint i = 0; i < items.size(); ++i)
+	{
+		if (items[i].sourceTexture != 0)
+			sourceTextures.push_back(items[i].sourceTexture);
+	}
+	std::sort(sourceTextures.begin(), sourceTextures.end());
+	textureBindsWithoutArrays = std::unique(sourceTextures.begin(), sourceTextures.end()) - sourceTextures.begin();
+
+	// Material buckets: one contiguous command range per texture or texture array, the same mesh and level next to each other
+	std::stable_sort(items.begin(), items.end(), [](const IndirectItem& a, const IndirectItem& b)
+	{
+		if (a.array != b.array)
+			return b.array;
+		if (a.texture != b.texture)
+			return a.texture < b.texture;
+		if (a.entry != b.entry)
+			return std::less<const MegaMesh*>()(a.entry, b.entry);
+		return a.lod < b.lod;
+	});
+
+	ReserveDraws(items.size());
+	commandList.clear();
+	drawData.resize(items.size());
+	std::vector<IndirectBucket> bucketList;
+
+	for (uint i = 0; i < items.size(); ++i)
+	{
+		const MeshLOD& lod = items[i].mesh->lods[items[i].lod];
+
+		drawData[i].model = items[i].component->gameObject->transform->GetMatrixOGL();
+		drawData[i].layer = items[i].layer;
+
+		App->renderer3D->trianglesDrawn += lod.indexCount / 3;
+
+		// Shared meshes become instances of one command, base instance + instance id still lands on their own draw data
+		bool sameMaterial = i > 0 && items[i].texture == items[i - 1].texture && items[i].array == items[i - 1].array;
+		if (sameMaterial && items[i].entry == items[i - 1].entry && items[i].lod == items[i - 1].lod)
+		{
+			if (commandList.back().instanceCount++ == 1u)
+				instancedCommands++;
+			continue;
+		}
+
+		if (!sameMaterial)
+		{
+			IndirectBucket bucket;
+			bucket.firstCommand = commandList.size();
+			bucket.texture = items[i].texture;
+			bucket.array = items[i].array;
+			bucketList.push_back(bucket);
+		}
+
+		DrawElementsIndirectCommand command;
+		command.count = lod.indexCount;
+		command.instanceCount = 1u;
+		command.firstIndex = items[i].entry->firstIndex + lod.indexOffset;
+		command.baseVertex = items[i].entry->baseVertex;
+		command.baseInstance = i;
+		commandList.push_back(command);
+	}
+
+	GLStateCache& state = App->renderer3D->glState;
+
+	// Per-frame data goes through the ring buffer, the orphaned stream buffers are the fallback
+	RingBuffer& ring = App->renderer3D->ringBuffer;
+	RingAllocation commandRange = ring.Allocate(sizeof(DrawElementsIndirectCommand) * commandList.size(), sizeof(uint));
+	RingAllocation drawDataRange = ring.Allocate(sizeof(IndirectDrawData) * drawData.size(), ring.GetStorageAlignment());
+
+	uint commandOffset = 0u;
+
+	if (commandRange.data != nullptr && drawDataRange.data != nullptr)
+	{
+		memcpy(commandRange.data, commandList.data(), commandRange.size);
+		memcpy(drawDataRange.data, drawData.data(), drawDataRange.size);
+		ring.Commit(commandRange);
+		ring.Commit(drawDataRange);
+
+		state.BindBuffer(GL_DRAW_INDIRECT_BUFFER, ring.GetBuffer());
+		// Indexed binds also set the generic binding, keep the cache in step
+		state.BindBuffer(GL_SHADER_STORAGE_BUFFER, ring.GetBuffer());
+		glBindBufferRange(GL_SHADER_STORAGE_BUFFER, 0, ring.GetBuffer(), drawDataRange.offset, drawDataRange.size);
+		commandOffset = commandRange.offset;
+	}
+	else
+	{
+		state.BindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+		glBufferData(GL_DRAW_INDIRECT_BUFFER, sizeof(DrawElementsIndirectCommand) * drawCapacity, nullptr, GL_STREAM_DRAW);
+		glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, sizeof(DrawElementsIndirectCommand) * commandList.size(), commandList.data());
+
+		state.BindBuffer(GL_SHADER_STORAGE_BUFFER, drawDataBuffer);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(IndirectDrawData) * drawCapacity, nullptr, GL_STREAM_DRAW);
+		glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(IndirectDrawData) * drawData.size(), drawData.data());
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, drawDataBuffer);
+	}
+
+	state.UseProgram(program);
+	glUniformMatrix4fv(projectionLocation, 1, GL_FALSE, camera->GetProjectionMatrix().ptr());
+	glUniformMatrix4fv(viewLocation, 1, GL_FALSE, camera->GetViewMatrix().ptr());
+	glUniform3f(lightLocation, lightPosition.x, lightPosition.y, lightPosition.z);
+
+	bool clustered = clusters != nullptr && clusters->IsUploaded();
+	glUniform1i(clusteredLocation, clustered ? 1 : 0);
+	if (clustered)
+	{
+		clusters->Bind();
+		glUniform3ui(clusterGridLocation, CLUSTERS_X, CLUSTERS_Y, CLUSTERS_Z);
+		glUniform2f(clusterTileLocation, (float)App->window->width / CLUSTERS_X, (float)App->window->height / CLUSTERS_Y);
+		glUniform2f(depthSlicingLocation, clusters->GetSliceScale(), clusters->GetSliceBias());
+		glUniform3f(cameraPositionLocation, camera->frustum.pos.x, camera->frustum.pos.y, camera->frustum.pos.z);
+		glUniform3f(cameraFrontLocation, camera->frustum.front.x, camera->frustum.front.y, camera->frustum.front.z);
+	}
+
+	state.BindVertexArray(vertexArray);
+
+	for (uint i = 0; i < bucketList.size(); ++i)
+	{
+		const IndirectBucket& bucket = bucketList[i];
+		uint end = i + 1 < bucketList.size() ? bucketList[i + 1].firstCommand : commandList.size();
+
+		if (bucket.array)
+		{
+			state.ActiveTexture(GL_TEXTURE1);
+			state.BindTexture(GL_TEXTURE_2D_ARRAY, bucket.texture);
+			state.ActiveTexture(GL_TEXTURE0);
+		}
+		else
+			state.BindTexture(bucket.texture);
+
+		glUniform1i(texturedLocation, !bucket.array && bucket.texture != 0 ? 1 : 0);
+		glUniform1i(arrayTexturedLocation, bucket.array ? 1 : 0);
+		if (bucket.texture != 0)
+			textureBinds++;
+
+		glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (void*)(commandOffset + sizeof(DrawElementsIndirectCommand) * bucket.firstCommand), end - bucket.firstCommand, 0);
+
+		App->renderer3D->drawCalls++;
+		buckets++;
+	}
+
+	commands = commandList.size();
+	instances = items.size();
+
+	state.BindVertexArray(0);
+	state.UseProgram(0);
+}
+
+// ------------------------------------------------------------
+static uint GrowBuffer(uint oldBuffer, uint oldBytes, uint newBytes, uint usage)
+{
+	GLStateCache& state = App->renderer3D->glState;
+
+	uint buffer = 0u;
+	glGenBuffers(1, (GLuint*)&buffer);
+	state.BindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+	glBufferData(GL_COPY_WRITE_BUFFER, newBytes, nullptr, usage);
+
+	if (oldBuffer != 0 && oldBytes > 0)
+	{
+		state.BindBuffer(GL_COPY_READ_BUFFER, oldBuffer);
+		glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, oldBytes);
+	}
+
+	state.DeleteBuffer(oldBuffer);
+
+	return buffer;
+}
+
+void IndirectRenderer::ReserveVertices(uint count)
+{
+	if (count <= vertexCapacity)
+		return;
+
+	uint capacity = vertexCapacity * 2 > count ? vertexCapacity * 2 : count;
+	vertexBuffer = GrowBuffer(vertexBuffer, sizeof(IndirectVertex) * vertexCapacity, sizeof(IndirectVertex) * capacity, GL_STATIC_DRAW);
+	vertexCapacity = capacity;
+
+	SetupVertexArray();
+}
+
+void IndirectRenderer::ReserveIndices(uint count)
+{
+	if (count <= indexCapacity)
+		return;
+
+	uint capacity = indexCapacity * 2 > count ? indexCapacity * 2 : count;
+	indexBuffer = GrowBuffer(indexBuffer, sizeof(uint) * indexCapacity, sizeof(uint) * capacity, GL_STATIC_DRAW);
+	indexCapacity = capacity;
+
+	SetupVertexArray();
+}
+
+void IndirectRenderer::ReserveDraws(uint count)
+{
+	if (count <= drawCapacity)
+		return;
+
+	uint capacity = drawCapacity * 2 > count ? drawCapacity * 2 : count;
+
+	// Instanced attribute holding 0..n, base instance selects the entry for each command
+	std::vector<uint> ids(capacity);
+	for (uint i = 0; i < capacity; ++i)
+		ids[i] = i;
+
+	App->renderer3D->glState.DeleteBuffer(drawIdBuffer);
+	glGenBuffers(1, (GLuint*)&drawIdBuffer);
+	App->renderer3D->glState.BindBuffer(GL_ARRAY_BUFFER, drawIdBuffer);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(uint) * capacity, ids.data(), GL_STATIC_DRAW);
+
+	drawCapacity = capacity;
+
+	SetupVertexArray();
+}
+
+void IndirectRenderer::SetupVertexArray()
+{
+	if (vertexArray == 0 || vertexBuffer == 0 || indexBuffer == 0 || drawIdBuffer == 0)
+		return;
+
+	GLStateCache& state = App->renderer3D->glState;
+	state.BindVertexArray(vertexArray);
+
+	state.BindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(IndirectVertex), (void*)offsetof(IndirectVertex, position));
+	glEnableVertexAttribArray(1);
+	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(IndirectVertex), (void*)offsetof(IndirectVertex, normal));
+	glEnableVertexAttribArray(2);
+	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(IndirectVertex), (void*)offsetof(IndirectVertex, uv));
+
+	state.BindBuffer(GL_ARRAY_BUFFER, drawIdBuffer);
+	glEnableVertexAttribArray(3);
+	glVertexAttribIPointer(3, 1, GL_UNSIGNED_INT, sizeof(uint), nullptr);
+	glVertexAttribDivisor(3, 1);
+
+	// Element binding is vertex array state, set once here and never through the cache
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+
+	state.BindVertexArray(0);
+}
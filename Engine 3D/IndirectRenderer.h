@@ -0,0 +1,136 @@
+#pragma once
+#include "Globals.h"
+#include "MathGeoLib/MathGeoLib.h"
+#include <vector>
+#include <map>
+
+class ResourceMesh;
+class ComponentMesh;
+class ComponentCamera;
+class LightClusters;
+
+// Same layout as the GL struct read by glMultiDrawElementsIndirect
+struct DrawElementsIndirectCommand
+{
+	uint count = 0u;
+	uint instanceCount = 1u;
+	uint firstIndex = 0u;
+	int baseVertex = 0;
+	uint baseInstance = 0u;
+};
+
+// Per-draw data in the shader storage buffer, indexed by the draw id attribute
+struct IndirectDrawData
+{
+	float4x4 model;
+	uint layer = 0u;
+	uint padding[3] = { 0u, 0u, 0u };
+};
+
+// Where a mesh lives inside the megabuffers
+struct MegaMesh
+{
+	uint baseVertex = 0u;
+	uint firstIndex = 0u;
+	uint vertexCount = 0u;
+	uint indexCount = 0u;
+};
+
+// First fit ranges over one megabuffer, freed ranges merge with their neighbours and the tail gives space back
+struct MegaAllocator
+{
+	uint Allocate(uint count);
+	void Free(uint offset, uint count);
+
+	// Elements up to the last live range, and elements live in it
+	uint end = 0u;
+	uint used = 0u;
+
+	// Offset to count
+	std::map<uint, uint> holes;
+};
+
+struct IndirectVertex
+{
+	float3 position;
+	float3 normal;
+	float2 uv;
+};
+
+// Packs every mesh into shared vertex/index buffers and draws the visible set with one
+// glMultiDrawElementsIndirect per texture, objects sharing a mesh and level go as instances of one command.
+// Needs GL 4.3 (or the MDI, SSBO and base instance extensions).
+class IndirectRenderer
+{
+public:
+	IndirectRenderer();
+	~IndirectRenderer();
+
+	bool Init();
+	void CleanUp();
+
+	bool IsSupported() const;
+
+	void AddMesh(ResourceMesh* mesh);
+	void RemoveMesh(const ResourceMesh* mesh);
+
+	// Clusters are optional, without them only light 0 is applied
+	void Draw(const std::vector<ComponentMesh*>& visible, ComponentCamera* camera, const float3& lightPosition, const LightClusters* clusters = nullptr);
+
+private:
+
+	void ReserveVertices(uint count);
+	void ReserveIndices(uint count);
+	void ReserveDraws(uint count);
+	void SetupVertexArray();
+
+public:
+
+	// Last frame
+	uint commands = 0u;
+	uint buckets = 0u;
+
+	// Objects drawn and commands that drew more than one of them
+	uint instances = 0u;
+	uint instancedCommands = 0u;
+
+	// Texture binds with the arrays against one bind per distinct texture
+	uint textureBinds = 0u;
+	uint textureBindsWithoutArrays = 0u;
+
+	MegaAllocator vertexRanges;
+	MegaAllocator indexRanges;
+
+private:
+
+	bool supported = false;
+
+	uint program = 0u;
+	int projectionLocation = -1;
+	int viewLocation = -1;
+	int lightLocation = -1;
+	int texturedLocation = -1;
+	int arrayTexturedLocation = -1;
+	int clusteredLocation = -1;
+	int clusterGridLocation = -1;
+	int clusterTileLocation = -1;
+	int depthSlicingLocation = -1;
+	int cameraPositionLocation = -1;
+	int cameraFrontLocation = -1;
+
+	uint vertexArray = 0u;
+	uint vertexBuffer = 0u;
+	uint indexBuffer = 0u;
+	uint drawIdBuffer = 0u;
+	uint commandBuffer = 0u;
+	uint drawDataBuffer = 0u;
+
+	uint vertexCapacity = 0u;
+	uint indexCapacity = 0u;
+	uint drawCapacity = 0u;
+
+	std::map<const ResourceMesh*, MegaMesh> meshes;
+
+	std::vector<DrawElementsIndirectCommand> commandList;
+	std::vector<IndirectDrawData> drawData;
+};
@@ -57,6 +57,10 @@ void Inspector::Draw()
 				{
 					ComponentEmitter* emitter = new ComponentEmitter(App->sceneIntro->current_object);
 				}
+				if (ImGui::MenuItem("Light"))
+				{
+					ComponentLight* light = new ComponentLight(App->sceneIntro->current_object);
+				}
 				ImGui::MenuItem("Cancel");				
 				ImGui::EndMenu();
 			}
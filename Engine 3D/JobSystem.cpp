@@ -0,0 +1,154 @@
+#include "JobSystem.h"
+
+JobSystem::JobSystem()
+{
+}
+
+JobSystem::~JobSystem()
+{
+	CleanUp();
+}
+
+void JobSystem::Init(uint workers)
+{
+	if (workers == 0u)
+	{
+		uint threads = std::thread::hardware_concurrency();
+		workers = threads > 1 ? threads - 1 : 1;
+	}
+
+	quit = false;
+	for (uint i = 0; i < workers; ++i)
+		this->workers.push_back(std::thread(&JobSystem::WorkerLoop, this));
+
+	LOG("Job system: %u worker threads", workers);
+}
+
+void JobSystem::CleanUp()
+{
+	{
+		std::lock_guard<std::mutex> lock(queueMutex);
+		quit = true;
+	}
+	queueCondition.notify_all();
+
+	for (uint i = 0; i < workers.size(); ++i)
+		workers[i].join();
+	workers.clear();
+
+	// Nothing may be left waiting on jobs that will never run
+	while (RunPending());
+}
+
+void JobSystem::Submit(const std::function<void()>& function, JobCounter* counter)
+{
+	Job job;
+	job.function = function;
+	job.counter = counter;
+
+	if (counter)
+		counter->pending++;
+
+	if (workers.empty())
+	{
+		// No workers (not initialized or already cleaned up), run inline
+		job.function();
+		if (counter)
+			counter->pending--;
+		jobsCompleted++;
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(queueMutex);
+		queue.push_back(job);
+	}
+	queueCondition.notify_one();
+}
+
+void JobSystem::Wait(JobCounter* counter)
+{
+	while (counter->pending > 0)
+	{
+		if (!RunPending(counter))
+			std::this_thread::yield();
+	}
+}
+
+void JobSystem::ParallelFor(uint count, uint chunkSize, const std::function<void(uint begin, uint end)>& function)
+{
+	if (count == 0)
+		return;
+
+	if (chunkSize == 0)
+		chunkSize = 1;
+
+	// Small ranges aren't worth the queue
+	if (count <= chunkSize || workers.empty())
+	{
+		function(0, count);
+		return;
+	}
+
+	JobCounter counter;
+	for (uint begin = 0; begin < count; begin += chunkSize)
+	{
+		uint end = begin + chunkSize < count ? begin + chunkSize : count;
+		Submit([&function, begin, end]() { function(begin, end); }, &counter);
+	}
+
+	Wait(&counter);
+}
+
+uint JobSystem::GetWorkerCount() const
+{
+	return workers.size();
+}
+
+bool JobSystem::RunPending(JobCounter* counter)
+{
+	Job job;
+	{
+		std::lock_guard<std::mutex> lock(queueMutex);
+
+		std::deque<Job>::iterator it = queue.begin();
+		while (it != queue.end() && counter != nullptr && it->counter != counter)
+			++it;
+
+		if (it == queue.end())
+			return false;
+
+		job = *it;
+		queue.erase(it);
+	}
+
+	job.function();
+	if (job.counter)
+		job.counter->pending--;
+	jobsCompleted++;
+
+	return true;
+}
+
+void JobSystem::WorkerLoop()
+{
+	while (true)
+	{
+		Job job;
+		{
+			std::unique_lock<std::mutex> lock(queueMutex);
+			queueCondition.wait(lock, [this]() { return quit || !queue.empty(); });
+
+			if (queue.empty())
+				return;
+
+			job = queue.front();
+			queue.pop_front();
+		}
+
+		job.function();
+		if (job.counter)
+			job.counter->pending--;
+		jobsCompleted++;
+	}
+}
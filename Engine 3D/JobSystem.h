@@ -0,0 +1,62 @@
+#pragma once
+#include "Globals.h"
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+
+// Jobs submitted with the same counter can be waited on together
+struct JobCounter
+{
+	std::atomic<int> pending = { 0 };
+};
+
+struct Job
+{
+	std::function<void()> function;
+	JobCounter* counter = nullptr;
+};
+
+// Fixed pool of worker threads pulling from one queue. Waiting threads run the queued jobs of the counter they
+// wait on instead of sleeping, so jobs may submit and wait on other jobs, and a short wait on the main thread
+// never picks up an unrelated long import.
+class JobSystem
+{
+public:
+	JobSystem();
+	~JobSystem();
+
+	// 0 workers uses one per hardware thread minus the main thread
+	void Init(uint workers = 0u);
+	void CleanUp();
+
+	void Submit(const std::function<void()>& function, JobCounter* counter = nullptr);
+	void Wait(JobCounter* counter);
+
+	// Splits [0, count) in ranges of chunkSize, runs them on the workers and the calling thread and returns when all are done
+	void ParallelFor(uint count, uint chunkSize, const std::function<void(uint begin, uint end)>& function);
+
+	uint GetWorkerCount() const;
+
+private:
+
+	// Any job when counter is nullptr, only that counter's otherwise
+	bool RunPending(JobCounter* counter = nullptr);
+	void WorkerLoop();
+
+public:
+
+	// Jobs finished since start
+	std::atomic<uint> jobsCompleted = { 0u };
+
+private:
+
+	std::vector<std::thread> workers;
+	std::deque<Job> queue;
+	std::mutex queueMutex;
+	std::condition_variable queueCondition;
+	bool quit = false;
+};
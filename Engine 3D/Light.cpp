@@ -3,13 +3,14 @@
 #include <gl/GL.h>
 //#include <gl/GLU.h>
 
-Light::Light() : ref(-1), on(false), position(0.0f, 0.0f, 0.0f)
+Light::Light() : ref(-1), on(false), position(0.0f, 0.0f, 0.0f), quadraticAttenuation(0.0f)
 {}
 
 void Light::Init()
 {
 	glLightfv(ref, GL_AMBIENT, &ambient);
 	glLightfv(ref, GL_DIFFUSE, &diffuse);
+	glLightf(ref, GL_QUADRATIC_ATTENUATION, quadraticAttenuation);
 }
 
 void Light::SetPos(float x, float y, float z)
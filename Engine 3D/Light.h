@@ -15,6 +15,7 @@ struct Light
 	Color ambient;
 	Color diffuse;
 	vec3 position;
+	float quadraticAttenuation;
 
 	int ref;
 	bool on;
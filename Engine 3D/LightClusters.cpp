@@ -0,0 +1,279 @@
+#include "LightClusters.h"
+#include "Application.h"
+#include "ComponentLight.h"
+#include "ComponentCamera.h"
+#include "Glew/include/glew.h"
+#include <xmmintrin.h>
+#include <math.h>
+
+#define CLUSTERS_PER_SLICE (CLUSTERS_X * CLUSTERS_Y)
+
+// Padding lights never touch a cluster
+#define FAR_AWAY 1e15f
+
+LightClusters::LightClusters()
+{
+	bounds.resize(CLUSTERS_PER_SLICE * CLUSTERS_Z);
+	sliceIndices.resize(CLUSTERS_Z);
+	sliceRanges.resize(CLUSTERS_Z);
+}
+
+LightClusters::~LightClusters()
+{
+}
+
+void LightClusters::Update(const std::list<ComponentLight*>& lights, ComponentCamera* camera)
+{
+	uploaded = false;
+	lightCount = indexCount = maxLightsPerCluster = 0u;
+
+	if (camera == nullptr)
+		return;
+
+	Uint64 start = SDL_GetPerformanceCounter();
+
+	BuildBounds(camera);
+
+	// Lights in the camera basis, the shader computes the same depth from the world position
+	const Frustum& frustum = camera->frustum;
+	float3 right = frustum.WorldRight();
+
+	gpuLights.clear();
+	lightX.clear();
+	lightY.clear();
+	lightZ.clear();
+	lightRadius.clear();
+
+	for (std::list<ComponentLight*>::const_iterator it = lights.begin(); it != lights.end(); ++it)
+	{
+		const ComponentLight* light = *it;
+		if (!light->gameObject->active || light->intensity <= 0.0f || light->range <= 0.0f)
+			continue;
+
+		float3 position = light->GetPosition();
+		float3 toLight = position - frustum.pos;
+		float depth = Dot(toLight, frustum.front);
+
+		if (depth + light->range < nearPlane || depth - light->range > farPlane)
+			continue;
+
+		ClusterLight gpuLight;
+		gpuLight.positionRange = float4(position, light->range);
+		gpuLight.colorIntensity = float4(light->color, light->intensity);
+		gpuLights.push_back(gpuLight);
+
+		lightX.push_back(Dot(toLight, right));
+		lightY.push_back(Dot(toLight, frustum.up));
+		lightZ.push_back(depth);
+		lightRadius.push_back(light->range);
+	}
+
+	lightCount = gpuLights.size();
+	if (lightCount == 0)
+		return;
+
+	App->jobs.ParallelFor(CLUSTERS_Z, 1, [this](uint begin, uint end)
+	{
+		for (uint slice = begin; slice < end; ++slice)
+			AssignSlice(slice, sliceIndices[slice], sliceRanges[slice]);
+	});
+
+	// Compact the slices into one index list
+	ranges.resize(CLUSTERS_PER_SLICE * CLUSTERS_Z);
+	indices.clear();
+
+	for (uint slice = 0; slice < CLUSTERS_Z; ++slice)
+	{
+		uint sliceOffset = indices.size();
+		for (uint i = 0; i < CLUSTERS_PER_SLICE; ++i)
+		{
+			ClusterRange& range = ranges[slice * CLUSTERS_PER_SLICE + i];
+			range.offset = sliceOffset + sliceRanges[slice][i].offset;
+			range.count = sliceRanges[slice][i].count;
+
+			if (range.count > maxLightsPerCluster)
+				maxLightsPerCluster = range.count;
+		}
+		indices.insert(indices.end(), sliceIndices[slice].begin(), sliceIndices[slice].end());
+	}
+
+	indexCount = indices.size();
+	assignMs = (float)((double)(SDL_GetPerformanceCounter() - start) * 1000.0 / (double)SDL_GetPerformanceFrequency());
+
+	if (App->renderer3D->nullBackend || indexCount == 0)
+		return;
+
+	RingBuffer& ring = App->renderer3D->ringBuffer;
+	uint alignment = ring.GetStorageAlignment();
+
+	RingAllocation lightsRange = ring.Allocate(sizeof(ClusterLight) * gpuLights.size(), alignment);
+	RingAllocation clustersRange = ring.Allocate(sizeof(ClusterRange) * ranges.size(), alignment);
+	RingAllocation indicesRange = ring.Allocate(sizeof(uint) * indices.size(), alignment);
+
+	if (lightsRange.data == nullptr || clustersRange.data == nullptr || indicesRange.data == nullptr)
+		return;
+
+	memcpy(lightsRange.data, gpuLights.data(), lightsRange.size);
+	memcpy(clustersRange.data, ranges.data(), clustersRange.size);
+	memcpy(indicesRange.data, indices.data(), indicesRange.size);
+	ring.Commit(lightsRange);
+	ring.Commit(clustersRange);
+	ring.Commit(indicesRange);
+
+	lightsOffset = lightsRange.offset;
+	lightsSize = lightsRange.size;
+	rangesOffset = clustersRange.offset;
+	rangesSize = clustersRange.size;
+	indicesOffset = indicesRange.offset;
+	indicesSize = indicesRange.size;
+
+	uploaded = true;
+}
+
+void LightClusters::Bind() const
+{
+	if (!uploaded)
+		return;
+
+	uint buffer = App->renderer3D->ringBuffer.GetBuffer();
+
+	// Indexed binds also set the generic binding, keep the cache in step
+	App->renderer3D->glState.BindBuffer(GL_SHADER_STORAGE_BUFFER, buffer);
+	glBindBufferRange(GL_SHADER_STORAGE_BUFFER, 1, buffer, lightsOffset, lightsSize);
+	glBindBufferRange(GL_SHADER_STORAGE_BUFFER, 2, buffer, rangesOffset, rangesSize);
+	glBindBufferRange(GL_SHADER_STORAGE_BUFFER, 3, buffer, indicesOffset, indicesSize);
+}
+
+bool LightClusters::IsUploaded() const
+{
+	return uploaded;
+}
+
+float LightClusters::GetSliceScale() const
+{
+	return (float)CLUSTERS_Z / logf(farPlane / nearPlane);
+}
+
+float LightClusters::GetSliceBias() const
+{
+	return -(float)CLUSTERS_Z * logf(nearPlane) / logf(farPlane / nearPlane);
+}
+
+// ------------------------------------------------------------
+void LightClusters::BuildBounds(ComponentCamera* camera)
+{
+	const Frustum& frustum = camera->frustum;
+	float newTanX = tanf(frustum.horizontalFov * 0.5f);
+	float newTanY = tanf(frustum.verticalFov * 0.5f);
+
+	// Only changes with the projection
+	if (frustum.nearPlaneDistance == nearPlane && frustum.farPlaneDistance == farPlane && newTanX == tanX && newTanY == tanY)
+		return;
+
+	nearPlane = frustum.nearPlaneDistance;
+	farPlane = frustum.farPlaneDistance;
+	tanX = newTanX;
+	tanY = newTanY;
+
+	for (uint z = 0; z < CLUSTERS_Z; ++z)
+	{
+		float depthNear = nearPlane * powf(farPlane / nearPlane, (float)z / CLUSTERS_Z);
+		float depthFar = nearPlane * powf(farPlane / nearPlane, (float)(z + 1) / CLUSTERS_Z);
+
+		for (uint y = 0; y < CLUSTERS_Y; ++y)
+		{
+			for (uint x = 0; x < CLUSTERS_X; ++x)
+			{
+				float ndcX[2] = { -1.0f + 2.0f * x / CLUSTERS_X, -1.0f + 2.0f * (x + 1) / CLUSTERS_X };
+				float ndcY[2] = { -1.0f + 2.0f * y / CLUSTERS_Y, -1.0f + 2.0f * (y + 1) / CLUSTERS_Y };
+
+				// The tile's side planes go through the eye, the extremes are on the near or far face
+				AABB& box = bounds[z * CLUSTERS_PER_SLICE + y * CLUSTERS_X + x];
+				box.SetNegativeInfinity();
+				for (uint i = 0; i < 2; ++i)
+				{
+					float depth = i == 0 ? depthNear : depthFar;
+					for (uint c = 0; c < 2; ++c)
+					{
+						box.Enclose(float3(ndcX[c] * tanX * depth, ndcY[0] * tanY * depth, depth));
+						box.Enclose(float3(ndcX[c] * tanX * depth, ndcY[1] * tanY * depth, depth));
+					}
+				}
+			}
+		}
+	}
+}
+
+void LightClusters::AssignSlice(uint slice, std::vector<uint>& clusterIndices, std::vector<ClusterRange>& clusterRanges) const
+{
+	clusterIndices.clear();
+	clusterRanges.resize(CLUSTERS_PER_SLICE);
+
+	const AABB* sliceBounds = &bounds[slice * CLUSTERS_PER_SLICE];
+	float depthNear = sliceBounds[0].minPoint.z;
+	float depthFar = sliceBounds[0].maxPoint.z;
+
+	// Lights overlapping the slice depth, as SoA padded to four
+	std::vector<uint> candidates;
+	std::vector<float> x, y, z, radius2;
+	for (uint i = 0; i < lightZ.size(); ++i)
+	{
+		if (lightZ[i] + lightRadius[i] < depthNear || lightZ[i] - lightRadius[i] > depthFar)
+			continue;
+
+		candidates.push_back(i);
+		x.push_back(lightX[i]);
+		y.push_back(lightY[i]);
+		z.push_back(lightZ[i]);
+		radius2.push_back(lightRadius[i] * lightRadius[i]);
+	}
+
+	uint count = candidates.size();
+	while (x.size() % 4 != 0)
+	{
+		x.push_back(FAR_AWAY);
+		y.push_back(FAR_AWAY);
+		z.push_back(FAR_AWAY);
+		radius2.push_back(0.0f);
+	}
+
+	__m128 zero = _mm_setzero_ps();
+
+	for (uint c = 0; c < CLUSTERS_PER_SLICE; ++c)
+	{
+		ClusterRange& range = clusterRanges[c];
+		range.offset = clusterIndices.size();
+		range.count = 0u;
+
+		if (count == 0)
+			continue;
+
+		const AABB& box = sliceBounds[c];
+		__m128 minX = _mm_set1_ps(box.minPoint.x), maxX = _mm_set1_ps(box.maxPoint.x);
+		__m128 minY = _mm_set1_ps(box.minPoint.y), maxY = _mm_set1_ps(box.maxPoint.y);
+		__m128 minZ = _mm_set1_ps(box.minPoint.z), maxZ = _mm_set1_ps(box.maxPoint.z);
+
+		// Sphere against box: squared distance from the center to the box, four lights at a time
+		for (uint i = 0; i < x.size(); i += 4)
+		{
+			__m128 lx = _mm_loadu_ps(&x[i]);
+			__m128 ly = _mm_loadu_ps(&y[i]);
+			__m128 lz = _mm_loadu_ps(&z[i]);
+
+			__m128 dx = _mm_max_ps(_mm_max_ps(_mm_sub_ps(minX, lx), _mm_sub_ps(lx, maxX)), zero);
+			__m128 dy = _mm_max_ps(_mm_max_ps(_mm_sub_ps(minY, ly), _mm_sub_ps(ly, maxY)), zero);
+			__m128 dz = _mm_max_ps(_mm_max_ps(_mm_sub_ps(minZ, lz), _mm_sub_ps(lz, maxZ)), zero);
+
+			__m128 distance2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+			int mask = _mm_movemask_ps(_mm_cmple_ps(distance2, _mm_loadu_ps(&radius2[i])));
+
+			for (uint bit = 0; mask != 0 && bit < 4; ++bit)
+			{
+				if (mask & (1 << bit))
+					clusterIndices.push_back(candidates[i + bit]);
+			}
+		}
+
+		range.count = clusterIndices.size() - range.offset;
+	}
+}
@@ -0,0 +1,87 @@
+#pragma once
+#include "Globals.h"
+#include "MathGeoLib/MathGeoLib.h"
+#include <vector>
+#include <list>
+
+#define CLUSTERS_X 16
+#define CLUSTERS_Y 9
+#define CLUSTERS_Z 24
+
+class ComponentLight;
+class ComponentCamera;
+
+// Shader storage layout of one light
+struct ClusterLight
+{
+	float4 positionRange; // world position, range
+	float4 colorIntensity;
+};
+
+// Offset and count in the light index list
+struct ClusterRange
+{
+	uint offset = 0u;
+	uint count = 0u;
+};
+
+// Splits the camera frustum into screen tiles and exponential depth slices and lists the lights touching each cluster.
+// Assignment runs on the job system, one depth slice per job, testing four lights at a time with SSE.
+class LightClusters
+{
+public:
+	LightClusters();
+	~LightClusters();
+
+	// Rebuilds the light lists for the camera, then uploads them through the ring buffer
+	void Update(const std::list<ComponentLight*>& lights, ComponentCamera* camera);
+
+	// Binds lights, clusters and indices to storage bindings 1, 2 and 3
+	void Bind() const;
+
+	bool IsUploaded() const;
+
+	// log(depth) * scale + bias gives the depth slice
+	float GetSliceScale() const;
+	float GetSliceBias() const;
+
+private:
+
+	void BuildBounds(ComponentCamera* camera);
+
+	void AssignSlice(uint slice, std::vector<uint>& clusterIndices, std::vector<ClusterRange>& clusterRanges) const;
+
+public:
+
+	// Last update
+	uint lightCount = 0u;
+	uint indexCount = 0u;
+	uint maxLightsPerCluster = 0u;
+	float assignMs = 0.0f;
+
+private:
+
+	float nearPlane = 0.0f;
+	float farPlane = 0.0f;
+	float tanX = 0.0f;
+	float tanY = 0.0f;
+
+	// Cluster bounds in camera space (right, up, front)
+	std::vector<AABB> bounds;
+
+	// Lights in camera space as structure of arrays, padded to multiples of four
+	std::vector<float> lightX, lightY, lightZ, lightRadius;
+
+	std::vector<ClusterLight> gpuLights;
+	std::vector<ClusterRange> ranges;
+	std::vector<uint> indices;
+
+	// Per slice results before compaction
+	std::vector<std::vector<uint>> sliceIndices;
+	std::vector<std::vector<ClusterRange>> sliceRanges;
+
+	uint lightsOffset = 0u, lightsSize = 0u;
+	uint rangesOffset = 0u, rangesSize = 0u;
+	uint indicesOffset = 0u, indicesSize = 0u;
+	bool uploaded = false;
+};
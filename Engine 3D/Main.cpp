@@ -34,6 +34,7 @@ int main(int argc, char ** argv)
 
 			LOG("-------------- Application Creation --------------");
 			App = new Application();
+			App->ParseArguments(argc, argv);
 			state = MAIN_START;
 			break;
 
@@ -0,0 +1,105 @@
+#include "MappedFile.h"
+
+#define PAGE_SIZE 4096
+
+MappedFile::MappedFile()
+{
+}
+
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+bool MappedFile::Open(const char* path)
+{
+	Close();
+
+	file = CreateFile(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0 || fileSize.QuadPart > MAXUINT)
+	{
+		Close();
+		return false;
+	}
+	size = (uint)fileSize.QuadPart;
+
+	mapping = CreateFileMapping(file, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+	if (mapping != NULL)
+		data = (char*)MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+
+	if (data == nullptr)
+	{
+		Close();
+		return false;
+	}
+
+	return true;
+}
+
+bool MappedFile::OpenView(char* data, uint size)
+{
+	Close();
+
+	this->data = data;
+	this->size = size;
+	return data != nullptr;
+}
+
+bool MappedFile::OpenBuffer(char* data, uint size)
+{
+	Close();
+
+	this->data = data;
+	this->size = size;
+	ownsBuffer = true;
+	return data != nullptr;
+}
+
+void MappedFile::Close()
+{
+	if (ownsBuffer)
+		delete[] data;
+	else if (data != nullptr && mapping != NULL)
+		UnmapViewOfFile(data);
+	if (mapping != NULL)
+		CloseHandle(mapping);
+	if (file != INVALID_HANDLE_VALUE)
+		CloseHandle(file);
+
+	data = nullptr;
+	mapping = NULL;
+	file = INVALID_HANDLE_VALUE;
+	size = 0u;
+	ownsBuffer = false;
+}
+
+bool MappedFile::IsOpen() const
+{
+	return data != nullptr;
+}
+
+char* MappedFile::GetData() const
+{
+	return data;
+}
+
+uint MappedFile::GetSize() const
+{
+	return size;
+}
+
+bool MappedFile::Contains(const void* pointer) const
+{
+	return data != nullptr && (const char*)pointer >= data && (const char*)pointer < data + size;
+}
+
+void MappedFile::Prefault() const
+{
+	volatile char sink = 0;
+	for (uint offset = 0; offset < size; offset += PAGE_SIZE)
+		sink += data[offset];
+}
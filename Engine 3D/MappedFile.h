@@ -0,0 +1,47 @@
+#pragma once
+#include "Globals.h"
+
+// Read-only file view in the address space. The view is copy-on-write, so a stray write changes
+// private pages and never the file. Archive entries come through the same interface, either as a
+// window into the archive's own view or as a decompressed copy the object owns.
+class MappedFile
+{
+public:
+	MappedFile();
+	~MappedFile();
+
+	bool Open(const char* path);
+
+	// Window into memory someone else keeps alive, Close leaves it alone
+	bool OpenView(char* data, uint size);
+
+	// Takes a new[] buffer, freed on Close
+	bool OpenBuffer(char* data, uint size);
+
+	void Close();
+
+	bool IsOpen() const;
+
+	char* GetData() const;
+	uint GetSize() const;
+
+	// True for pointers into the view, those must not be deleted
+	bool Contains(const void* pointer) const;
+
+	// Touches every page so the disk reads happen on the calling thread
+	void Prefault() const;
+
+private:
+
+	MappedFile(const MappedFile&);
+	MappedFile& operator=(const MappedFile&);
+
+private:
+
+	HANDLE file = INVALID_HANDLE_VALUE;
+	HANDLE mapping = NULL;
+	char* data = nullptr;
+	uint size = 0u;
+
+	bool ownsBuffer = false;
+};
@@ -0,0 +1,302 @@
+#include "MeshEncoding.h"
+#include "MeshFile.h"
+#include "ResourceMesh.h"
+#include "Compression.h"
+#include <math.h>
+
+#if defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#include <emmintrin.h>
+#define MESH_ENCODING_SSE2
+#endif
+
+#define QUANTIZE_MAX 65535.0f
+
+static short ToSnorm16(float value)
+{
+	value = value < -1.0f ? -1.0f : (value > 1.0f ? 1.0f : value);
+	return (short)floorf(value * 32767.0f + (value >= 0.0f ? 0.5f : -0.5f));
+}
+
+void OctahedralEncode(const float* n, short* out)
+{
+	float length = fabsf(n[0]) + fabsf(n[1]) + fabsf(n[2]);
+	float x = 0.0f, y = 0.0f;
+
+	if (length > 0.0f)
+	{
+		x = n[0] / length;
+		y = n[1] / length;
+
+		// Fold the lower hemisphere over the diagonals
+		if (n[2] < 0.0f)
+		{
+			float oldX = x;
+			x = (1.0f - fabsf(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+			y = (1.0f - fabsf(oldX)) * (y >= 0.0f ? 1.0f : -1.0f);
+		}
+	}
+
+	out[0] = ToSnorm16(x);
+	out[1] = ToSnorm16(y);
+}
+
+static void OctahedralDecode(const short* in, float* n)
+{
+	float x = in[0] / 32767.0f;
+	float y = in[1] / 32767.0f;
+	float z = 1.0f - fabsf(x) - fabsf(y);
+
+	if (z < 0.0f)
+	{
+		float oldX = x;
+		x = (1.0f - fabsf(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+		y = (1.0f - fabsf(oldX)) * (y >= 0.0f ? 1.0f : -1.0f);
+	}
+
+	float length = sqrtf(x * x + y * y + z * z);
+	float inverse = length > 0.0f ? 1.0f / length : 0.0f;
+	n[0] = x * inverse;
+	n[1] = y * inverse;
+	n[2] = z * inverse;
+}
+
+static unsigned short Quantize(float value, float minimum, float scale)
+{
+	float q = floorf((value - minimum) * scale + 0.5f);
+	return (unsigned short)(q < 0.0f ? 0.0f : (q > QUANTIZE_MAX ? QUANTIZE_MAX : q));
+}
+
+static void WriteVarint(std::vector<unsigned char>& out, uint value)
+{
+	while (value >= 0x80)
+	{
+		out.push_back((unsigned char)(value | 0x80));
+		value >>= 7;
+	}
+	out.push_back((unsigned char)value);
+}
+
+// value = components interleaved, component c of every element uses scale[c] and offset[c]
+static void Dequantize3(const unsigned short* in, uint count, const float* scale, const float* offset, float* out)
+{
+	uint i = 0u;
+
+#ifdef MESH_ENCODING_SSE2
+	// Four vertices are twelve floats, the component pattern repeats every three registers
+	__m128 scale0 = _mm_setr_ps(scale[0], scale[1], scale[2], scale[0]);
+	__m128 scale1 = _mm_setr_ps(scale[1], scale[2], scale[0], scale[1]);
+	__m128 scale2 = _mm_setr_ps(scale[2], scale[0], scale[1], scale[2]);
+	__m128 offset0 = _mm_setr_ps(offset[0], offset[1], offset[2], offset[0]);
+	__m128 offset1 = _mm_setr_ps(offset[1], offset[2], offset[0], offset[1]);
+	__m128 offset2 = _mm_setr_ps(offset[2], offset[0], offset[1], offset[2]);
+	__m128i zero = _mm_setzero_si128();
+
+	for (; i + 4 <= count; i += 4)
+	{
+		const unsigned short* source = in + i * 3;
+		float* destination = out + i * 3;
+
+		__m128i a = _mm_unpacklo_epi16(_mm_loadl_epi64((const __m128i*)source), zero);
+		__m128i b = _mm_unpacklo_epi16(_mm_loadl_epi64((const __m128i*)(source + 4)), zero);
+		__m128i c = _mm_unpacklo_epi16(_mm_loadl_epi64((const __m128i*)(source + 8)), zero);
+
+		_mm_storeu_ps(destination, _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(a), scale0), offset0));
+		_mm_storeu_ps(destination + 4, _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(b), scale1), offset1));
+		_mm_storeu_ps(destination + 8, _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(c), scale2), offset2));
+	}
+#endif
+
+	for (; i < count; ++i)
+	{
+		for (uint c = 0; c < 3; ++c)
+			out[i * 3 + c] = in[i * 3 + c] * scale[c] + offset[c];
+	}
+}
+
+static void Dequantize2(const unsigned short* in, uint count, const float* scale, const float* offset, float* out)
+{
+	uint i = 0u;
+
+#ifdef MESH_ENCODING_SSE2
+	__m128 scales = _mm_setr_ps(scale[0], scale[1], scale[0], scale[1]);
+	__m128 offsets = _mm_setr_ps(offset[0], offset[1], offset[0], offset[1]);
+	__m128i zero = _mm_setzero_si128();
+
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128i values = _mm_loadu_si128((const __m128i*)(in + i * 2));
+		_mm_storeu_ps(out + i * 2, _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(values, zero)), scales), offsets));
+		_mm_storeu_ps(out + i * 2 + 4, _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(values, zero)), scales), offsets));
+	}
+#endif
+
+	for (; i < count; ++i)
+	{
+		out[i * 2] = in[i * 2] * scale[0] + offset[0];
+		out[i * 2 + 1] = in[i * 2 + 1] * scale[1] + offset[1];
+	}
+}
+
+bool EncodeMesh(const ResourceMesh* m, MeshFileHeader& header, std::vector<char>& out)
+{
+	uint vertexCount = m->GetVertexCount();
+	if (vertexCount == 0 || m->vertex.data == nullptr || m->index.data == nullptr)
+		return false;
+
+	uint fixedBytes = vertexCount * 3 * sizeof(unsigned short);
+	if (m->normals.data)
+		fixedBytes += vertexCount * 2 * sizeof(short);
+	if (m->uvs.data)
+		fixedBytes += vertexCount * 2 * sizeof(unsigned short);
+
+	std::vector<unsigned char> inner(fixedBytes);
+	inner.reserve(fixedBytes + (m->index.size + m->lodIndex.size) * 2);
+	unsigned short* cursor = (unsigned short*)inner.data();
+
+	float scale[3];
+	for (uint c = 0; c < 3; ++c)
+	{
+		float extent = header.boundsMax[c] - header.boundsMin[c];
+		scale[c] = extent > 0.0f ? QUANTIZE_MAX / extent : 0.0f;
+	}
+	for (uint i = 0; i < vertexCount; ++i)
+	{
+		for (uint c = 0; c < 3; ++c)
+			*cursor++ = Quantize(m->vertex.data[i * 3 + c], header.boundsMin[c], scale[c]);
+	}
+
+	if (m->normals.data)
+	{
+		for (uint i = 0; i < vertexCount; ++i, cursor += 2)
+			OctahedralEncode(&m->normals.data[i * 3], (short*)cursor);
+	}
+
+	if (m->uvs.data)
+	{
+		float uvMax[2] = { m->uvs.data[0], m->uvs.data[1] };
+		header.uvMin[0] = m->uvs.data[0];
+		header.uvMin[1] = m->uvs.data[1];
+		for (uint i = 1; i < vertexCount; ++i)
+		{
+			for (uint c = 0; c < 2; ++c)
+			{
+				float value = m->uvs.data[i * 2 + c];
+				if (value < header.uvMin[c]) header.uvMin[c] = value;
+				if (value > uvMax[c]) uvMax[c] = value;
+			}
+		}
+		for (uint c = 0; c < 2; ++c)
+			header.uvRange[c] = uvMax[c] - header.uvMin[c] > 0.0f ? uvMax[c] - header.uvMin[c] : 1.0f;
+
+		for (uint i = 0; i < vertexCount; ++i)
+		{
+			for (uint c = 0; c < 2; ++c)
+				*cursor++ = Quantize(m->uvs.data[i * 2 + c], header.uvMin[c], QUANTIZE_MAX / header.uvRange[c]);
+		}
+	}
+
+	// Optimized index buffers reuse recent vertices, most deltas fit in one byte
+	uint previous = 0u;
+	for (uint i = 0; i < m->index.size + m->lodIndex.size; ++i)
+	{
+		uint index = i < m->index.size ? m->index.data[i] : m->lodIndex.data[i - m->index.size];
+		int delta = (int)(index - previous);
+		WriteVarint(inner, (uint)((delta << 1) ^ (delta >> 31)));
+		previous = index;
+	}
+
+	header.encodedSize = inner.size();
+
+	out.resize(LZ4CompressBound(inner.size()));
+	uint compressedSize = LZ4Compress((const char*)inner.data(), inner.size(), out.data(), out.size());
+	out.resize(compressedSize);
+
+	return compressedSize > 0;
+}
+
+bool DecodeMesh(ResourceMesh* m, const MeshFileHeader& header, const char* data, uint size)
+{
+	uint vertexCount = header.vertexCount;
+	uint totalIndices = header.indexCount + header.lodIndexCount;
+	bool hasNormals = (header.flags & MESH_FILE_NORMALS) != 0;
+	bool hasUVs = (header.flags & MESH_FILE_UVS) != 0;
+
+	uint fixedBytes = vertexCount * (3 + (hasNormals ? 2 : 0) + (hasUVs ? 2 : 0)) * sizeof(unsigned short);
+	if (vertexCount == 0 || header.encodedSize < fixedBytes || header.encodedSize - fixedBytes < totalIndices)
+		return false;
+
+	std::vector<char> inner(header.encodedSize);
+	if (!LZ4Decompress(data, size, inner.data(), inner.size()))
+		return false;
+
+	// Indices first, a corrupt stream must not leave half a mesh behind
+	const unsigned char* varint = (const unsigned char*)inner.data() + fixedBytes;
+	const unsigned char* end = (const unsigned char*)inner.data() + inner.size();
+	uint* indices = new uint[totalIndices];
+	uint previous = 0u;
+	for (uint i = 0; i < totalIndices; ++i)
+	{
+		uint value = 0u, shift = 0u;
+		unsigned char byte = 0x80;
+		while ((byte & 0x80) && shift < 35 && varint < end)
+		{
+			byte = *varint++;
+			value |= (uint)(byte & 0x7f) << shift;
+			shift += 7;
+		}
+
+		previous += (uint)((int)(value >> 1) ^ -(int)(value & 1));
+		if ((byte & 0x80) || previous >= vertexCount)
+		{
+			delete[] indices;
+			return false;
+		}
+		indices[i] = previous;
+	}
+
+	const unsigned short* cursor = (const unsigned short*)inner.data();
+
+	float scale[3], offset[3];
+	for (uint c = 0; c < 3; ++c)
+	{
+		scale[c] = (header.boundsMax[c] - header.boundsMin[c]) / QUANTIZE_MAX;
+		offset[c] = header.boundsMin[c];
+	}
+	m->vertex.size = vertexCount * 3;
+	m->vertex.data = new float[m->vertex.size];
+	Dequantize3(cursor, vertexCount, scale, offset, m->vertex.data);
+	cursor += vertexCount * 3;
+
+	m->hasNormals = hasNormals;
+	if (hasNormals)
+	{
+		m->normals.size = vertexCount * 3;
+		m->normals.data = new float[m->normals.size];
+		for (uint i = 0; i < vertexCount; ++i, cursor += 2)
+			OctahedralDecode((const short*)cursor, &m->normals.data[i * 3]);
+	}
+
+	if (hasUVs)
+	{
+		float uvScale[2] = { header.uvRange[0] / QUANTIZE_MAX, header.uvRange[1] / QUANTIZE_MAX };
+		m->uvs.size = vertexCount * 2;
+		m->uvs.data = new float[m->uvs.size];
+		Dequantize2(cursor, vertexCount, uvScale, header.uvMin, m->uvs.data);
+	}
+
+	// Separate allocations, each stream is freed on its own
+	m->index.size = header.indexCount;
+	m->lodIndex.size = header.lodIndexCount;
+	if (header.lodIndexCount > 0)
+	{
+		m->index.data = new uint[header.indexCount];
+		memcpy(m->index.data, indices, sizeof(uint) * header.indexCount);
+		m->lodIndex.data = new uint[header.lodIndexCount];
+		memcpy(m->lodIndex.data, indices + header.indexCount, sizeof(uint) * header.lodIndexCount);
+		delete[] indices;
+	}
+	else
+		m->index.data = indices;
+
+	return true;
+}
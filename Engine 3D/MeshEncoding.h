@@ -0,0 +1,22 @@
+#pragma once
+#include "Globals.h"
+#include <vector>
+
+class ResourceMesh;
+struct MeshFileHeader;
+
+// Compressed Library mesh payload, LZ4 over:
+//   positions  3 x uint16 per vertex, quantized to the header bounds
+//   normals    2 x snorm16 per vertex, octahedral
+//   uvs        2 x uint16 per vertex, quantized to header uvMin/uvRange
+//   indices    every level back to back, delta from the previous index, zigzag, LEB128 varint
+// Sixteen bits over the bounds is below the precision anything we import was authored at.
+
+// Fills the uv range and encodedSize in the header, out gets the LZ4 block
+bool EncodeMesh(const ResourceMesh* m, MeshFileHeader& header, std::vector<char>& out);
+
+// Allocates the float streams and the index buffers, one streaming pass per stream after the LZ4 block
+bool DecodeMesh(ResourceMesh* m, const MeshFileHeader& header, const char* data, uint size);
+
+// Octahedral normal to 2 x snorm16, shared with the packed vertex format
+void OctahedralEncode(const float* n, short* out);
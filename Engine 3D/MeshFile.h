@@ -0,0 +1,82 @@
+#pragma once
+#include "Globals.h"
+#include "ResourceMesh.h"
+#include <stddef.h>
+
+// Library mesh file (.dmnd), version 3. Version 1 files have no header and start with the index count,
+// version 2 headers end right before the encoded section.
+#define MESH_FILE_MAGIC 0x444e4d44 // "DMND"
+#define MESH_FILE_VERSION 3
+#define MESH_FILE_ALIGNMENT 16
+
+enum MeshFileFlags
+{
+	MESH_FILE_NORMALS = 1 << 0,
+	MESH_FILE_UVS = 1 << 1,
+	MESH_FILE_PACKED = 1 << 2,
+	MESH_FILE_HALF_POSITIONS = 1 << 3,
+	// Every stream is in the encoded section, see MeshEncoding
+	MESH_FILE_ENCODED = 1 << 4
+};
+
+// Byte range from the start of the file, offsets are MESH_FILE_ALIGNMENT aligned
+struct MeshFileSection
+{
+	uint offset = 0u;
+	uint size = 0u;
+};
+
+struct MeshFileLOD
+{
+	uint indexOffset = 0u;
+	uint indexCount = 0u;
+	float error = 0.0f;
+	float screenSize = 0.0f;
+};
+
+struct MeshFileHeader
+{
+	uint magic = MESH_FILE_MAGIC;
+	uint version = MESH_FILE_VERSION;
+	uint headerSize = sizeof(MeshFileHeader);
+	uint flags = 0u;
+
+	uint vertexCount = 0u;
+	uint indexCount = 0u;
+	uint lodIndexCount = 0u;
+	uint lodCount = 0u;
+
+	float boundsMin[3] = { 0.0f, 0.0f, 0.0f };
+	float boundsMax[3] = { 0.0f, 0.0f, 0.0f };
+	float acmr = 0.0f;
+
+	// Bytes per index in the element buffer
+	uint indexSize = 0u;
+
+	// Packed vertex layout, see ResourceMesh
+	uint stride = 0u;
+	// Always 0 now, older files packed normals the stride and texCoordOffset step over
+	uint normalOffset = 0u;
+	uint texCoordOffset = 0u;
+	float uvMin[2] = { 0.0f, 0.0f };
+	float uvRange[2] = { 1.0f, 1.0f };
+
+	// 32 bit indices of every level, level 0 first
+	MeshFileSection indices;
+	MeshFileSection vertices;
+	MeshFileSection normals;
+	MeshFileSection uvs;
+
+	// Element buffer contents when indexSize is 2
+	MeshFileSection shortIndices;
+	MeshFileSection packed;
+
+	MeshFileLOD lods[MAX_MESH_LODS];
+
+	// LZ4 block and the size it decompresses to
+	MeshFileSection encoded;
+	uint encodedSize = 0u;
+	uint padding = 0u;
+};
+
+#define MESH_FILE_HEADER_V2_SIZE offsetof(MeshFileHeader, encoded)
@@ -0,0 +1,560 @@
+#include "MeshOptimizer.h"
+#include "MathGeoLib/MathGeoLib.h"
+#include <algorithm>
+#include <math.h>
+#include <float.h>
+
+#define FORSYTH_CACHE_SIZE 32
+#define ACMR_CACHE_SIZE 16
+#define NO_VERTEX ((uint)-1)
+
+float ComputeACMR(const uint* indices, uint indexCount, uint vertexCount, uint cacheSize)
+{
+	if (indexCount < 3 || vertexCount == 0)
+		return 0.0f;
+
+	std::vector<uint> timestamps(vertexCount, 0u);
+	uint time = cacheSize + 1;
+	uint misses = 0u;
+
+	for (uint i = 0; i < indexCount; ++i)
+	{
+		uint v = indices[i];
+		if (time - timestamps[v] > cacheSize)
+		{
+			timestamps[v] = time++;
+			misses++;
+		}
+	}
+
+	return (float)misses / (float)(indexCount / 3);
+}
+
+// ------------------------------------------------------------
+static float ForsythVertexScore(int cachePosition, uint liveTriangles)
+{
+	if (liveTriangles == 0)
+		return -1.0f;
+
+	float score = 0.0f;
+	if (cachePosition >= 0)
+	{
+		// The last triangle's vertices get a fixed score so it isn't reused straight away
+		if (cachePosition < 3)
+			score = 0.75f;
+		else
+			score = powf(1.0f - (float)(cachePosition - 3) / (FORSYTH_CACHE_SIZE - 3), 1.5f);
+	}
+
+	// Boost vertices with few triangles left so they get finished off
+	score += 2.0f * powf((float)liveTriangles, -0.5f);
+
+	return score;
+}
+
+void OptimizeVertexCache(uint* indices, uint indexCount, uint vertexCount)
+{
+	uint triangleCount = indexCount / 3;
+	if (triangleCount == 0 || vertexCount == 0)
+		return;
+
+	// Vertex -> triangle adjacency, the live triangles of v are the first liveTriangles[v] entries of its range
+	std::vector<uint> liveTriangles(vertexCount, 0u);
+	for (uint i = 0; i < triangleCount * 3; ++i)
+		liveTriangles[indices[i]]++;
+
+	std::vector<uint> offsets(vertexCount + 1, 0u);
+	for (uint v = 0; v < vertexCount; ++v)
+		offsets[v + 1] = offsets[v] + liveTriangles[v];
+
+	std::vector<uint> adjacency(triangleCount * 3);
+	std::vector<uint> fill(offsets.begin(), offsets.end() - 1);
+	for (uint t = 0; t < triangleCount; ++t)
+		for (uint k = 0; k < 3; ++k)
+			adjacency[fill[indices[t * 3 + k]]++] = t;
+
+	std::vector<int> cachePosition(vertexCount, -1);
+	std::vector<float> vertexScore(vertexCount);
+	for (uint v = 0; v < vertexCount; ++v)
+		vertexScore[v] = ForsythVertexScore(-1, liveTriangles[v]);
+
+	std::vector<float> triangleScore(triangleCount);
+	std::vector<bool> emitted(triangleCount, false);
+
+	int best = -1;
+	float bestScore = -1.0f;
+	for (uint t = 0; t < triangleCount; ++t)
+	{
+		triangleScore[t] = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+		if (triangleScore[t] > bestScore)
+		{
+			bestScore = triangleScore[t];
+			best = t;
+		}
+	}
+
+	std::vector<uint> output;
+	output.reserve(triangleCount * 3);
+
+	std::vector<uint> cache, newCache;
+	cache.reserve(FORSYTH_CACHE_SIZE + 3);
+	newCache.reserve(FORSYTH_CACHE_SIZE + 3);
+
+	uint scanCursor = 0u;
+
+	while (best >= 0)
+	{
+		const uint* triangle = &indices[best * 3];
+		emitted[best] = true;
+
+		newCache.clear();
+		for (uint k = 0; k < 3; ++k)
+		{
+			uint v = triangle[k];
+			output.push_back(v);
+			newCache.push_back(v);
+
+			// Drop the triangle from the live part of the vertex adjacency
+			uint* begin = &adjacency[offsets[v]];
+			uint* end = begin + liveTriangles[v];
+			uint* found = std::find(begin, end, (uint)best);
+			if (found != end)
+			{
+				*found = *(end - 1);
+				*(end - 1) = best;
+				liveTriangles[v]--;
+			}
+		}
+
+		for (uint i = 0; i < cache.size(); ++i)
+		{
+			uint v = cache[i];
+			if (v != triangle[0] && v != triangle[1] && v != triangle[2])
+				newCache.push_back(v);
+		}
+
+		for (uint i = 0; i < newCache.size(); ++i)
+		{
+			uint v = newCache[i];
+			cachePosition[v] = i < FORSYTH_CACHE_SIZE ? (int)i : -1;
+			vertexScore[v] = ForsythVertexScore(cachePosition[v], liveTriangles[v]);
+		}
+
+		// Only triangles touching the cache changed score, the best candidate is among them
+		best = -1;
+		bestScore = -1.0f;
+		for (uint i = 0; i < newCache.size(); ++i)
+		{
+			uint v = newCache[i];
+			for (uint a = offsets[v]; a < offsets[v] + liveTriangles[v]; ++a)
+			{
+				uint t = adjacency[a];
+				triangleScore[t] = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+				if (triangleScore[t] > bestScore)
+				{
+					bestScore = triangleScore[t];
+					best = t;
+				}
+			}
+		}
+
+		cache.assign(newCache.begin(), newCache.begin() + (newCache.size() < FORSYTH_CACHE_SIZE ? newCache.size() : FORSYTH_CACHE_SIZE));
+
+		// Nothing left around the cache, restart from the next unused triangle
+		if (best < 0)
+		{
+			while (scanCursor < triangleCount && emitted[scanCursor])
+				scanCursor++;
+
+			if (scanCursor < triangleCount)
+				best = scanCursor;
+		}
+	}
+
+	memcpy(indices, output.data(), sizeof(uint) * output.size());
+}
+
+// ------------------------------------------------------------
+struct OverdrawCluster
+{
+	uint start = 0u;
+	uint end = 0u;
+	float sortKey = 0.0f;
+};
+
+void OptimizeOverdraw(uint* indices, uint indexCount, const float* positions, uint vertexCount, float threshold)
+{
+	uint triangleCount = indexCount / 3;
+	if (triangleCount < 2 || vertexCount == 0)
+		return;
+
+	float acmrBefore = ComputeACMR(indices, indexCount, vertexCount, ACMR_CACHE_SIZE);
+
+	// Hard boundaries where the cache restarts: reordering whole clusters keeps their locality
+	std::vector<OverdrawCluster> clusters;
+	std::vector<uint> timestamps(vertexCount, 0u);
+	uint time = ACMR_CACHE_SIZE + 1;
+
+	for (uint t = 0; t < triangleCount; ++t)
+	{
+		uint misses = 0u;
+		for (uint k = 0; k < 3; ++k)
+		{
+			uint v = indices[t * 3 + k];
+			if (time - timestamps[v] > ACMR_CACHE_SIZE)
+			{
+				timestamps[v] = time++;
+				misses++;
+			}
+		}
+
+		if (t == 0 || misses == 3)
+		{
+			if (!clusters.empty())
+				clusters.back().end = t;
+
+			OverdrawCluster cluster;
+			cluster.start = t;
+			clusters.push_back(cluster);
+		}
+	}
+	clusters.back().end = triangleCount;
+
+	if (clusters.size() < 2)
+		return;
+
+	float3 meshCentroid = float3::zero;
+	for (uint v = 0; v < vertexCount; ++v)
+		meshCentroid += float3(&positions[v * 3]);
+	meshCentroid /= (float)vertexCount;
+
+	// Clusters facing away from the mesh center are likely occluders, draw them first
+	for (uint c = 0; c < clusters.size(); ++c)
+	{
+		float3 centroid = float3::zero;
+		float3 normal = float3::zero;
+		float area = 0.0f;
+
+		for (uint t = clusters[c].start; t < clusters[c].end; ++t)
+		{
+			float3 a(&positions[indices[t * 3] * 3]);
+			float3 b(&positions[indices[t * 3 + 1] * 3]);
+			float3 c3(&positions[indices[t * 3 + 2] * 3]);
+
+			float3 cross = (b - a).Cross(c3 - a);
+			float triangleArea = cross.Length();
+
+			centroid += (a + b + c3) * (triangleArea / 3.0f);
+			normal += cross;
+			area += triangleArea;
+		}
+
+		if (area > 0.0f)
+			centroid /= area;
+
+		float normalLength = normal.Length();
+		clusters[c].sortKey = normalLength > 0.0f ? (centroid - meshCentroid).Dot(normal / normalLength) : 0.0f;
+	}
+
+	std::stable_sort(clusters.begin(), clusters.end(), [](const OverdrawCluster& a, const OverdrawCluster& b) { return a.sortKey > b.sortKey; });
+
+	std::vector<uint> sorted;
+	sorted.reserve(triangleCount * 3);
+	for (uint c = 0; c < clusters.size(); ++c)
+		sorted.insert(sorted.end(), indices + clusters[c].start * 3, indices + clusters[c].end * 3);
+
+	// Keep the old order if the cluster shuffle costs too much vertex cache
+	if (ComputeACMR(sorted.data(), sorted.size(), vertexCount, ACMR_CACHE_SIZE) <= acmrBefore * threshold)
+		memcpy(indices, sorted.data(), sizeof(uint) * sorted.size());
+}
+
+// ------------------------------------------------------------
+uint OptimizeVertexFetch(uint* indices, uint indexCount, uint vertexCount, std::vector<uint>& remap)
+{
+	remap.assign(vertexCount, NO_VERTEX);
+	uint next = 0u;
+
+	for (uint i = 0; i < indexCount; ++i)
+	{
+		uint v = indices[i];
+		if (remap[v] == NO_VERTEX)
+			remap[v] = next++;
+
+		indices[i] = remap[v];
+	}
+
+	return next;
+}
+
+float* RemapVertexStream(const float* data, uint components, uint vertexCount, const std::vector<uint>& remap, uint newVertexCount)
+{
+	float* remapped = new float[newVertexCount * components];
+
+	for (uint v = 0; v < vertexCount; ++v)
+	{
+		if (remap[v] != NO_VERTEX)
+			memcpy(&remapped[remap[v] * components], &data[v * components], sizeof(float) * components);
+	}
+
+	return remapped;
+}
+
+// ------------------------------------------------------------
+// Symmetric 4x4 plane quadric, accumulated in double to keep small errors meaningful.
+// Planes are area weighted, the error is divided back by the total weight so it stays a squared distance.
+struct Quadric
+{
+	double a2 = 0.0, ab = 0.0, ac = 0.0, ad = 0.0;
+	double b2 = 0.0, bc = 0.0, bd = 0.0;
+	double c2 = 0.0, cd = 0.0;
+	double d2 = 0.0;
+	double w = 0.0;
+
+	void AddPlane(double a, double b, double c, double d, double weight)
+	{
+		a2 += a * a * weight; ab += a * b * weight; ac += a * c * weight; ad += a * d * weight;
+		b2 += b * b * weight; bc += b * c * weight; bd += b * d * weight;
+		c2 += c * c * weight; cd += c * d * weight;
+		d2 += d * d * weight;
+		w += weight;
+	}
+
+	void Add(const Quadric& q)
+	{
+		a2 += q.a2; ab += q.ab; ac += q.ac; ad += q.ad;
+		b2 += q.b2; bc += q.bc; bd += q.bd;
+		c2 += q.c2; cd += q.cd;
+		d2 += q.d2;
+		w += q.w;
+	}
+
+	double Evaluate(const float* p) const
+	{
+		double x = p[0], y = p[1], z = p[2];
+		double error = a2 * x * x + 2.0 * ab * x * y + 2.0 * ac * x * z + 2.0 * ad * x
+			+ b2 * y * y + 2.0 * bc * y * z + 2.0 * bd * y
+			+ c2 * z * z + 2.0 * cd * z
+			+ d2;
+
+		if (error <= 0.0 || w <= 0.0)
+			return 0.0;
+
+		return error / w;
+	}
+};
+
+struct EdgeCollapse
+{
+	uint from = 0u;
+	uint to = 0u;
+	double error = 0.0;
+};
+
+static bool CollapseFlipsTriangle(const float* positions, const uint* indices, const std::vector<uint>& offsets, const std::vector<uint>& adjacency, uint from, uint to)
+{
+	float3 target(&positions[to * 3]);
+
+	for (uint a = offsets[from]; a < offsets[from + 1]; ++a)
+	{
+		const uint* triangle = &indices[adjacency[a] * 3];
+
+		// Triangles on the edge itself disappear
+		if (triangle[0] == to || triangle[1] == to || triangle[2] == to)
+			continue;
+
+		float3 p[3], moved[3];
+		for (uint k = 0; k < 3; ++k)
+		{
+			p[k] = float3(&positions[triangle[k] * 3]);
+			moved[k] = triangle[k] == from ? target : p[k];
+		}
+
+		float3 before = (p[1] - p[0]).Cross(p[2] - p[0]);
+		float3 after = (moved[1] - moved[0]).Cross(moved[2] - moved[0]);
+
+		if (before.Dot(after) <= 0.0f)
+			return true;
+	}
+
+	return false;
+}
+
+uint SimplifyMesh(uint* destination, const uint* indices, uint indexCount, const float* positions, uint vertexCount, uint targetIndexCount, float targetError, float* resultError)
+{
+	if (resultError)
+		*resultError = 0.0f;
+
+	std::vector<uint> result(indices, indices + indexCount);
+	if (indexCount <= targetIndexCount || vertexCount == 0)
+	{
+		memcpy(destination, result.data(), sizeof(uint) * indexCount);
+		return indexCount;
+	}
+
+	// Errors are relative to the mesh extents so the same target works at any scale
+	AABB bounds;
+	bounds.SetNegativeInfinity();
+	bounds.Enclose((const float3*)positions, vertexCount);
+	double extent = bounds.Size().MaxElement();
+	if (extent <= 0.0)
+		extent = 1.0;
+
+	double maxError = (double)targetError * extent;
+	maxError *= maxError;
+
+	// Edges used by a single triangle are borders or attribute seams, those vertices never move
+	std::vector<bool> locked(vertexCount, false);
+	{
+		std::vector<std::pair<uint, uint>> edges;
+		edges.reserve(indexCount);
+		for (uint i = 0; i < indexCount; i += 3)
+		{
+			for (uint k = 0; k < 3; ++k)
+			{
+				uint a = indices[i + k], b = indices[i + (k + 1) % 3];
+				edges.push_back(a < b ? std::make_pair(a, b) : std::make_pair(b, a));
+			}
+		}
+		std::sort(edges.begin(), edges.end());
+
+		for (uint i = 0; i < edges.size();)
+		{
+			uint j = i + 1;
+			while (j < edges.size() && edges[j] == edges[i])
+				j++;
+
+			if (j - i == 1)
+				locked[edges[i].first] = locked[edges[i].second] = true;
+
+			i = j;
+		}
+	}
+
+	std::vector<Quadric> quadrics(vertexCount);
+	for (uint i = 0; i < indexCount; i += 3)
+	{
+		float3 a(&positions[indices[i] * 3]);
+		float3 b(&positions[indices[i + 1] * 3]);
+		float3 c(&positions[indices[i + 2] * 3]);
+
+		float3 normal = (b - a).Cross(c - a);
+		float area = normal.Length();
+		if (area <= 0.0f)
+			continue;
+
+		normal /= area;
+		double d = -(double)normal.Dot(a);
+
+		for (uint k = 0; k < 3; ++k)
+			quadrics[indices[i + k]].AddPlane(normal.x, normal.y, normal.z, d, area);
+	}
+
+	double worstError = 0.0;
+	std::vector<uint> remap(vertexCount);
+	std::vector<bool> touched(vertexCount);
+	std::vector<uint> offsets(vertexCount + 1);
+	std::vector<uint> adjacency;
+	std::vector<EdgeCollapse> collapses;
+
+	while (result.size() > targetIndexCount)
+	{
+		uint triangleCount = result.size() / 3;
+
+		offsets.assign(vertexCount + 1, 0u);
+		for (uint i = 0; i < result.size(); ++i)
+			offsets[result[i] + 1]++;
+		for (uint v = 0; v < vertexCount; ++v)
+			offsets[v + 1] += offsets[v];
+
+		adjacency.resize(result.size());
+		std::vector<uint> fill(offsets.begin(), offsets.end() - 1);
+		for (uint t = 0; t < triangleCount; ++t)
+			for (uint k = 0; k < 3; ++k)
+				adjacency[fill[result[t * 3 + k]]++] = t;
+
+		// Cheapest direction of every edge, collapsing onto an endpoint keeps the vertex buffer shared
+		collapses.clear();
+		for (uint i = 0; i < result.size(); i += 3)
+		{
+			for (uint k = 0; k < 3; ++k)
+			{
+				uint a = result[i + k], b = result[i + (k + 1) % 3];
+				if (a > b || (locked[a] && locked[b]))
+					continue;
+
+				Quadric q = quadrics[a];
+				q.Add(quadrics[b]);
+
+				EdgeCollapse collapse;
+				double toB = locked[a] ? DBL_MAX : q.Evaluate(&positions[b * 3]);
+				double toA = locked[b] ? DBL_MAX : q.Evaluate(&positions[a * 3]);
+
+				collapse.from = toB <= toA ? a : b;
+				collapse.to = toB <= toA ? b : a;
+				collapse.error = toB <= toA ? toB : toA;
+
+				if (collapse.error <= maxError)
+					collapses.push_back(collapse);
+			}
+		}
+
+		if (collapses.empty())
+			break;
+
+		std::sort(collapses.begin(), collapses.end(), [](const EdgeCollapse& a, const EdgeCollapse& b) { return a.error < b.error; });
+
+		for (uint v = 0; v < vertexCount; ++v)
+			remap[v] = v;
+		touched.assign(vertexCount, false);
+
+		// Independent collapses only: a vertex moves at most once per pass
+		uint removed = 0u;
+		uint needed = (result.size() - targetIndexCount) / 3;
+		for (uint c = 0; c < collapses.size() && removed < needed; ++c)
+		{
+			const EdgeCollapse& collapse = collapses[c];
+			if (touched[collapse.from] || touched[collapse.to])
+				continue;
+
+			if (CollapseFlipsTriangle(positions, result.data(), offsets, adjacency, collapse.from, collapse.to))
+				continue;
+
+			for (uint a = offsets[collapse.from]; a < offsets[collapse.from + 1]; ++a)
+			{
+				const uint* triangle = &result[adjacency[a] * 3];
+				if (triangle[0] == collapse.to || triangle[1] == collapse.to || triangle[2] == collapse.to)
+					removed++;
+
+				for (uint k = 0; k < 3; ++k)
+					touched[triangle[k]] = true;
+			}
+
+			remap[collapse.from] = collapse.to;
+			quadrics[collapse.to].Add(quadrics[collapse.from]);
+			if (collapse.error > worstError)
+				worstError = collapse.error;
+		}
+
+		if (removed == 0)
+			break;
+
+		uint write = 0u;
+		for (uint i = 0; i < result.size(); i += 3)
+		{
+			uint a = remap[result[i]], b = remap[result[i + 1]], c = remap[result[i + 2]];
+			if (a == b || b == c || a == c)
+				continue;
+
+			result[write++] = a;
+			result[write++] = b;
+			result[write++] = c;
+		}
+		result.resize(write);
+	}
+
+	if (resultError)
+		*resultError = (float)(sqrt(worstError) / extent);
+
+	memcpy(destination, result.data(), sizeof(uint) * result.size());
+	return result.size();
+}
@@ -0,0 +1,22 @@
+#pragma once
+#include "Globals.h"
+#include <vector>
+
+// Average cache miss ratio: vertices transformed per triangle with a FIFO post-transform cache
+float ComputeACMR(const uint* indices, uint indexCount, uint vertexCount, uint cacheSize = 16);
+
+// Reorders triangles for post-transform cache locality (Tom Forsyth's linear-speed algorithm)
+void OptimizeVertexCache(uint* indices, uint indexCount, uint vertexCount);
+
+// Reorders the cache-optimized clusters front to back from the outside, threshold caps the ACMR loss
+void OptimizeOverdraw(uint* indices, uint indexCount, const float* positions, uint vertexCount, float threshold = 1.05f);
+
+// Builds a remap table (old -> new vertex) in first-use order and rewrites the indices, returns the new vertex count
+uint OptimizeVertexFetch(uint* indices, uint indexCount, uint vertexCount, std::vector<uint>& remap);
+
+// Applies a remap table to a vertex attribute stream with the given number of components
+float* RemapVertexStream(const float* data, uint components, uint vertexCount, const std::vector<uint>& remap, uint newVertexCount);
+
+// Quadric error edge collapse onto existing vertices, the result shares the vertex buffer of the source
+// targetError is relative to the mesh extents, returns the new index count written to destination
+uint SimplifyMesh(uint* destination, const uint* indices, uint indexCount, const float* positions, uint vertexCount, uint targetIndexCount, float targetError, float* resultError = nullptr);
@@ -0,0 +1,457 @@
+#include "ModelImporter.h"
+#include "Application.h"
+#include "ModuleImport.h"
+#include "ModuleResources.h"
+#include "ResourceMesh.h"
+#include "ComponentMesh.h"
+#include "ComponentTransform.h"
+#include "Hash.h"
+#include "Assimp/include/cimport.h"
+#include "Assimp/include/scene.h"
+#include "Assimp/include/postprocess.h"
+
+ModelImporter::ModelImporter()
+{
+}
+
+ModelImporter::~ModelImporter()
+{
+}
+
+void ModelImporter::Import(const char* path)
+{
+	ImportRequest* request = new ImportRequest();
+	request->path = path;
+	request->start = SDL_GetPerformanceCounter();
+	request->settingsHash = App->import->GetMeshSettingsHash();
+	pending.push_back(request);
+
+	App->jobs.Submit([this, request]() { ReadJob(request); }, &request->counter);
+}
+
+void ModelImporter::Update()
+{
+	lastUploadedBytes = 0u;
+	uint budget = uploadBudget;
+
+	std::list<ImportRequest*>::iterator it = pending.begin();
+	while (it != pending.end())
+	{
+		ImportRequest* request = *it;
+
+		if (request->stage != ImportRequest::Stage::Uploading && request->counter.pending.load() > 0)
+		{
+			++it;
+			continue;
+		}
+
+		bool done = false;
+
+		switch (request->stage)
+		{
+		case ImportRequest::Stage::Reading:
+			if (!request->cached && (request->scene == nullptr || !request->scene->HasMeshes()))
+			{
+				LOG("Error loading scene %s", request->path.c_str());
+				done = true;
+				break;
+			}
+
+			// Uuids come from the main thread generator, workers only get the numbers
+			request->stage = ImportRequest::Stage::Converting;
+			{
+				// Scene mesh or Library uuid -> first node that reads it, the rest wait for its mesh
+				std::unordered_map<int, int> firstScene;
+				std::unordered_map<uint, int> firstUUID;
+
+				for (uint i = 0; i < request->nodes.size(); ++i)
+				{
+					ImportNode* node = &request->nodes[i];
+
+					if (request->cached)
+					{
+						// Meshes already in memory are picked up by Upload
+						if (node->meshUUID != 0 && firstUUID.insert(std::make_pair(node->meshUUID, i)).second && FindShared(*node) == nullptr)
+							App->jobs.Submit([this, request, node]() { LoadJob(request, node); }, &request->counter);
+					}
+					else if (node->sceneMesh >= 0)
+					{
+						std::pair<std::unordered_map<int, int>::iterator, bool> first = firstScene.insert(std::make_pair(node->sceneMesh, i));
+						if (!first.second)
+						{
+							node->instanceOf = first.first->second;
+							continue;
+						}
+
+						node->meshUUID = pcg32_random();
+						App->jobs.Submit([this, request, node]() { ConvertJob(request, node); }, &request->counter);
+					}
+				}
+			}
+			break;
+
+		case ImportRequest::Stage::Converting:
+			aiReleaseImport(request->scene);
+			request->scene = nullptr;
+			request->stage = ImportRequest::Stage::Uploading;
+			// Fall through, the budget may already cover some meshes this frame
+
+		case ImportRequest::Stage::Uploading:
+			if (Upload(request, budget))
+			{
+				BuildHierarchy(request);
+				done = true;
+			}
+			break;
+		}
+
+		if (done)
+		{
+			aiReleaseImport(request->scene);
+			delete request;
+			it = pending.erase(it);
+		}
+		else
+			++it;
+	}
+}
+
+void ModelImporter::CleanUp()
+{
+	for (std::list<ImportRequest*>::iterator it = pending.begin(); it != pending.end(); ++it)
+	{
+		ImportRequest* request = *it;
+		App->jobs.Wait(&request->counter);
+
+		aiReleaseImport(request->scene);
+
+		// Meshes past nextUpload never reached the resources
+		for (uint i = request->nextUpload; i < request->nodes.size(); ++i)
+			delete request->nodes[i].mesh;
+
+		delete request;
+	}
+	pending.clear();
+}
+
+uint ModelImporter::GetPending() const
+{
+	return pending.size();
+}
+
+// ------------------------------------------------------------
+static void FlattenNode(const aiScene* scene, const aiNode* node, int parent, std::vector<ImportNode>& nodes)
+{
+	ImportNode entry;
+	entry.name = node->mName.C_Str();
+	entry.parent = parent;
+	entry.transform = float4x4(
+		node->mTransformation.a1, node->mTransformation.a2, node->mTransformation.a3, node->mTransformation.a4,
+		node->mTransformation.b1, node->mTransformation.b2, node->mTransformation.b3, node->mTransformation.b4,
+		node->mTransformation.c1, node->mTransformation.c2, node->mTransformation.c3, node->mTransformation.c4,
+		node->mTransformation.d1, node->mTransformation.d2, node->mTransformation.d3, node->mTransformation.d4);
+
+	if (node->mNumMeshes > 0)
+	{
+		entry.sceneMesh = node->mMeshes[0];
+
+		const aiMesh* mesh = scene->mMeshes[entry.sceneMesh];
+		if (scene->HasMaterials() && scene->mMaterials[mesh->mMaterialIndex] != nullptr)
+		{
+			aiString textName;
+			scene->mMaterials[mesh->mMaterialIndex]->GetTexture(aiTextureType_DIFFUSE, 0, &textName);
+
+			std::string textPath(textName.data);
+			textPath = textPath.substr(textPath.find_last_of("\\") + 1);
+			entry.texturePath = "Assets\\Textures\\" + textPath;
+		}
+	}
+
+	int index = nodes.size();
+	nodes.push_back(entry);
+
+	for (uint child = 0; child < node->mNumChildren; ++child)
+		FlattenNode(scene, node->mChildren[child], index, nodes);
+}
+
+void ModelImporter::ReadJob(ImportRequest* request)
+{
+	ImportRecord record;
+	if (App->resources->importDB.Find(request->path.c_str(), request->settingsHash, record, &request->contentHash))
+	{
+		request->cached = true;
+		for (uint i = 0; i < record.nodes.size(); ++i)
+		{
+			ImportNode node;
+			node.name = record.nodes[i].name;
+			node.parent = record.nodes[i].parent;
+			node.transform = record.nodes[i].transform;
+			node.meshUUID = record.nodes[i].meshUUID;
+			node.geometryHash = record.nodes[i].geometryHash;
+			node.texturePath = record.nodes[i].texturePath;
+			request->nodes.push_back(node);
+		}
+		return;
+	}
+
+	if (request->contentHash == 0)
+		request->contentHash = HashFile(request->path.c_str());
+
+	request->scene = aiImportFile(request->path.c_str(), aiProcessPreset_TargetRealtime_MaxQuality);
+
+	if (request->scene != nullptr && request->scene->HasMeshes())
+		FlattenNode(request->scene, request->scene->mRootNode, -1, request->nodes);
+}
+
+static ResourceMesh* ReadLibraryMesh(const std::string& name, uint uuid)
+{
+	ResourceMesh* m = new ResourceMesh(name.c_str());
+
+	MappedFile* mapping = new MappedFile();
+	std::string file = App->resources->GetDirection(ResourceType::Mesh, uuid);
+	bool loaded = App->resources->vfs.Open(file.c_str(), *mapping) && App->import->ReadMeshImporter(m, mapping->GetData(), mapping->GetSize(), &mapping);
+
+	// nullptr when the mesh kept it
+	delete mapping;
+
+	if (!loaded)
+	{
+		delete m;
+		return nullptr;
+	}
+
+	App->import->PrepareMesh(m);
+	return m;
+}
+
+void ModelImporter::ConvertJob(ImportRequest* request, ImportNode* node)
+{
+	const aiMesh* source = request->scene->mMeshes[node->sceneMesh];
+
+	ResourceMesh* m = new ResourceMesh((request->path + node->name).c_str());
+
+	m->vertex.size = source->mNumVertices * 3;
+	m->vertex.data = new float[m->vertex.size];
+	memcpy(m->vertex.data, source->mVertices, sizeof(float) * m->vertex.size);
+
+	if (source->HasFaces())
+	{
+		m->index.size = source->mNumFaces * 3;
+		m->index.data = new uint[m->index.size];
+		memset(m->index.data, 0, sizeof(uint) * m->index.size);
+		for (uint i = 0; i < source->mNumFaces; ++i)
+		{
+			if (source->mFaces[i].mNumIndices != 3)
+				node->skippedFaces++;
+			else
+				memcpy(&m->index.data[i * 3], source->mFaces[i].mIndices, 3 * sizeof(uint));
+		}
+	}
+
+	if (source->HasTextureCoords(0))
+	{
+		m->uvs.size = source->mNumVertices * 2;
+		m->uvs.data = new float[m->uvs.size];
+		for (uint i = 0; i < source->mNumVertices; ++i)
+		{
+			m->uvs.data[i * 2] = source->mTextureCoords[0][i].x;
+			m->uvs.data[i * 2 + 1] = source->mTextureCoords[0][i].y;
+		}
+	}
+
+	if (source->HasNormals())
+	{
+		m->hasNormals = true;
+		m->normals.size = source->mNumVertices * 3;
+		m->normals.data = new float[m->normals.size];
+		memcpy(m->normals.data, source->mNormals, sizeof(float) * m->normals.size);
+	}
+
+	// Hashed as Assimp gave it, the settings make the rest of the conversion deterministic
+	node->geometryHash = HashBytes(m->vertex.data, sizeof(float) * m->vertex.size, request->settingsHash);
+	node->geometryHash = HashBytes(m->index.data, sizeof(uint) * m->index.size, node->geometryHash);
+	node->geometryHash = HashBytes(m->normals.data, sizeof(float) * m->normals.size, node->geometryHash);
+	node->geometryHash = HashBytes(m->uvs.data, sizeof(float) * m->uvs.size, node->geometryHash);
+
+	// Another model already wrote this geometry to Library
+	uint sharedUUID = 0u;
+	if (App->resources->importDB.FindGeometry(node->geometryHash, sharedUUID))
+	{
+		ResourceMesh* shared = ReadLibraryMesh(request->path + node->name, sharedUUID);
+		if (shared != nullptr)
+		{
+			delete m;
+			node->mesh = shared;
+			node->meshUUID = sharedUUID;
+			libraryFilesShared++;
+			return;
+		}
+	}
+
+	ModuleImport* import = App->import;
+	if (import->optimizeMeshes)
+		import->OptimizeMesh(m);
+
+	if (import->generateLODs)
+		import->GenerateLODs(m);
+
+	m->ComputeBounds();
+
+	// Everything but the GL calls, the packed stream goes into the Library file too
+	import->PrepareMesh(m);
+
+	import->SaveMeshImporter(m, node->meshUUID, nullptr, import->encodeMeshes);
+
+	node->mesh = m;
+	node->wroteLibrary = true;
+}
+
+void ModelImporter::LoadJob(ImportRequest* request, ImportNode* node)
+{
+	node->mesh = ReadLibraryMesh(request->path + node->name, node->meshUUID);
+}
+
+ResourceMesh* ModelImporter::FindShared(const ImportNode& node)
+{
+	Resource* resource = node.meshUUID != 0 ? App->resources->GetResourceByUUID(node.meshUUID) : nullptr;
+
+	if (resource == nullptr && node.geometryHash != 0)
+	{
+		std::unordered_map<unsigned long long, uint>::const_iterator it = uploadedGeometry.find(node.geometryHash);
+		if (it != uploadedGeometry.end())
+			resource = App->resources->GetResourceByUUID(it->second);
+	}
+
+	return resource != nullptr && resource->type == ResourceType::Mesh ? (ResourceMesh*)resource : nullptr;
+}
+
+bool ModelImporter::Upload(ImportRequest* request, uint& budget)
+{
+	while (request->nextUpload < request->nodes.size())
+	{
+		ImportNode& node = request->nodes[request->nextUpload];
+
+		// Always an earlier node, its mesh is registered by now
+		if (node.instanceOf >= 0)
+			node.meshUUID = request->nodes[node.instanceOf].meshUUID;
+
+		if (node.meshUUID == 0)
+		{
+			request->nextUpload++;
+			continue;
+		}
+
+		if (node.skippedFaces > 0)
+			LOG("WARNING, %u geometry faces with != 3 indices in %s", node.skippedFaces, node.name.c_str());
+
+		// Same uuid or same geometry: one mesh, one Library file, and the nodes become instances of it
+		ResourceMesh* existing = FindShared(node);
+		if (existing != nullptr)
+		{
+			if (node.mesh != existing)
+				delete node.mesh;
+
+			// Converted alongside an identical mesh, nothing will ever read its file
+			if (node.wroteLibrary && node.meshUUID != existing->uuid)
+				DeleteFile(App->resources->GetDirection(ResourceType::Mesh, node.meshUUID).c_str());
+
+			node.mesh = existing;
+			node.meshUUID = existing->uuid;
+			App->resources->ResourceUsageIncreased(existing);
+			meshesShared++;
+			request->nextUpload++;
+			continue;
+		}
+
+		if (node.mesh == nullptr)
+		{
+			// The record pointed at a Library file that didn't load, the next import redoes it
+			LOG("Couldn't load Library mesh %u for %s", node.meshUUID, node.name.c_str());
+			App->resources->importDB.Remove(request->path.c_str());
+			request->nextUpload++;
+			continue;
+		}
+
+		// Nothing is on the GPU yet, the streams tell what's about to go there
+		uint bytes = node.mesh->GetUploadSize();
+		if (bytes > budget && lastUploadedBytes > 0)
+			return false;
+
+		node.mesh->GenerateBuffers();
+		node.mesh->uuid = node.meshUUID;
+		App->resources->AddResource(node.mesh);
+		if (node.geometryHash != 0)
+			uploadedGeometry[node.geometryHash] = node.meshUUID;
+
+		LOG("New mesh with %u vertices, ACMR %.3f -> %.3f, %u LODs", node.mesh->GetVertexCount(), node.mesh->acmrBeforeOptimization, node.mesh->acmr, node.mesh->lods.size() - 1);
+
+		budget = bytes < budget ? budget - bytes : 0u;
+		lastUploadedBytes += bytes;
+		request->nextUpload++;
+	}
+
+	return true;
+}
+
+void ModelImporter::BuildHierarchy(ImportRequest* request)
+{
+	std::vector<GameObject*> objects(request->nodes.size());
+
+	for (uint i = 0; i < request->nodes.size(); ++i)
+	{
+		const ImportNode& node = request->nodes[i];
+		GameObject* parent = node.parent >= 0 ? objects[node.parent] : App->game_object->root;
+		GameObject* go = objects[i] = new GameObject(parent, node.name.c_str());
+
+		if (node.mesh != nullptr)
+		{
+			go->originalBoundingBox = node.mesh->bounds;
+			go->boundingBox = go->originalBoundingBox;
+
+			if (!node.texturePath.empty())
+				App->import->ImportTexture(node.texturePath.c_str(), go);
+
+			// Same uuid the Library file was written with
+			ComponentMesh* newMesh = new ComponentMesh(go);
+			newMesh->SetMesh(node.mesh);
+			newMesh->uuid = node.meshUUID;
+
+			App->renderer3D->mesh_list.push_back(newMesh);
+
+			App->sceneIntro->quadtree.QT_Insert(go);
+		}
+
+		go->transform->SetTransform(node.transform);
+	}
+
+	App->sceneIntro->current_object = objects[0];
+
+	if (!request->cached)
+	{
+		ImportRecord record;
+		record.source = request->path;
+		record.type = ResourceType::Mesh;
+		record.contentHash = request->contentHash;
+		record.settingsHash = request->settingsHash;
+
+		for (uint i = 0; i < request->nodes.size(); ++i)
+		{
+			ImportRecordNode recordNode;
+			recordNode.name = request->nodes[i].name;
+			recordNode.parent = request->nodes[i].parent;
+			recordNode.transform = request->nodes[i].transform;
+			recordNode.meshUUID = request->nodes[i].meshUUID;
+			recordNode.geometryHash = request->nodes[i].geometryHash;
+			recordNode.texturePath = request->nodes[i].texturePath;
+			record.nodes.push_back(recordNode);
+		}
+
+		App->resources->importDB.Store(record);
+	}
+
+	modelsImported++;
+	if (request->cached)
+		modelsReused++;
+	lastImportMs = (float)(SDL_GetPerformanceCounter() - request->start) * 1000.0f / SDL_GetPerformanceFrequency();
+	LOG("Imported %s: %u nodes in %.1f ms%s", request->path.c_str(), request->nodes.size(), lastImportMs, request->cached ? ", unchanged since the last import" : "");
+}
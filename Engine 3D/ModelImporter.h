@@ -0,0 +1,121 @@
+#pragma once
+#include "Globals.h"
+#include "JobSystem.h"
+#include "SDL\include\SDL.h"
+#include "MathGeoLib/MathGeoLib.h"
+#include <string>
+#include <vector>
+#include <list>
+#include <unordered_map>
+#include <atomic>
+
+class ResourceMesh;
+struct aiScene;
+struct aiNode;
+
+// Node of the imported hierarchy, parents always come before their children
+struct ImportNode
+{
+	std::string name;
+	int parent = -1;
+	float4x4 transform = float4x4::identity;
+
+	// -1 for nodes without geometry
+	int sceneMesh = -1;
+	std::string texturePath;
+
+	// Filled on a worker, the uuid names the Library file and the ComponentMesh
+	ResourceMesh* mesh = nullptr;
+	uint meshUUID = 0u;
+	uint skippedFaces = 0u;
+
+	// Source streams and mesh settings, identical geometry shares one mesh and one Library file
+	unsigned long long geometryHash = 0ull;
+
+	// The worker converted the mesh and wrote a Library file under meshUUID
+	bool wroteLibrary = false;
+
+	// Earlier node using the same scene mesh, it gets that node's mesh without a job of its own
+	int instanceOf = -1;
+};
+
+struct ImportRequest
+{
+	enum class Stage
+	{
+		Reading,
+		Converting,
+		Uploading
+	};
+
+	std::string path;
+	Stage stage = Stage::Reading;
+
+	const aiScene* scene = nullptr;
+	std::vector<ImportNode> nodes;
+	uint nextUpload = 0u;
+
+	// Unchanged since the last import: the nodes come from the import database and the meshes from Library
+	bool cached = false;
+	unsigned long long settingsHash = 0ull;
+	unsigned long long contentHash = 0ull;
+
+	JobCounter counter;
+	Uint64 start = 0u;
+};
+
+// FBX import in three stages: Assimp reads the file on a worker, every mesh is converted, optimized, simplified,
+// packed and written to Library on its own job, then the main thread uploads the buffers under a per-frame budget
+// and builds the hierarchy once the last one is on the GPU. Files the import database knows skip Assimp and the
+// conversion, their Library meshes are mapped instead. Identical geometry, within a file or across files, ends up
+// as one ResourceMesh and one Library file.
+class ModelImporter
+{
+public:
+	ModelImporter();
+	~ModelImporter();
+
+	void Import(const char* path);
+
+	// Main thread: moves requests through the stages
+	void Update();
+
+	// Waits for the workers and drops whatever didn't reach the scene
+	void CleanUp();
+
+	uint GetPending() const;
+
+private:
+
+	void ReadJob(ImportRequest* request);
+	void ConvertJob(ImportRequest* request, ImportNode* node);
+	void LoadJob(ImportRequest* request, ImportNode* node);
+
+	// Mesh already in memory with the node's uuid or geometry
+	ResourceMesh* FindShared(const ImportNode& node);
+
+	// Returns true once every mesh is uploaded
+	bool Upload(ImportRequest* request, uint& budget);
+	void BuildHierarchy(ImportRequest* request);
+
+public:
+
+	// Vertex and index bytes sent to the GPU per frame, at least one mesh always goes
+	uint uploadBudget = 8 * 1024 * 1024;
+
+	uint modelsImported = 0u;
+	uint modelsReused = 0u;
+
+	// Nodes that got a mesh already in memory or an existing Library file instead of their own
+	uint meshesShared = 0u;
+	std::atomic<uint> libraryFilesShared = { 0u };
+	uint lastUploadedBytes = 0u;
+	float lastImportMs = 0.0f;
+
+private:
+
+	std::list<ImportRequest*> pending;
+
+	// Geometry hash -> uuid of the meshes uploaded this session
+	std::unordered_map<unsigned long long, uint> uploadedGeometry;
+};
@@ -12,9 +12,20 @@ private :
 public:
 	Application* App;
 
-	Module(Application* parent, bool start_enabled = true) : App(parent)
+	Module(Application* parent, bool start_enabled = true) : App(parent), enabled(start_enabled)
 	{}
 
+	// Disabled modules are skipped by the update loop, Init/Start/CleanUp still run
+	bool IsEnabled() const
+	{
+		return enabled;
+	}
+
+	void SetEnabled(bool enable)
+	{
+		enabled = enable;
+	}
+
 	virtual ~Module()
 	{}
 
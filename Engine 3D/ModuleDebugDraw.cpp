@@ -0,0 +1,217 @@
+#include "ModuleDebugDraw.h"
+#include "Application.h"
+#include "Glew/include/glew.h"
+
+#define GRID_SIZE 200
+
+// Corner pairs of the 12 edges, same corner order as AABB/Frustum::GetCornerPoints
+static const uint boxEdges[24] =
+{
+	0, 1, 2, 3, 4, 5, 6, 7,
+	0, 2, 1, 3, 4, 6, 5, 7,
+	0, 4, 1, 5, 2, 6, 3, 7
+};
+
+static uint PackColor(const Color& color)
+{
+	uint r = (uint)(color.r * 255.0f + 0.5f);
+	uint g = (uint)(color.g * 255.0f + 0.5f);
+	uint b = (uint)(color.b * 255.0f + 0.5f);
+	uint a = (uint)(color.a * 255.0f + 0.5f);
+
+	return r | (g << 8) | (b << 16) | (a << 24);
+}
+
+static void AddLine(std::vector<DebugVertex>& vertices, const float3& a, const float3& b, uint color)
+{
+	DebugVertex vertex;
+	vertex.color = color;
+
+	vertex.position = a;
+	vertices.push_back(vertex);
+	vertex.position = b;
+	vertices.push_back(vertex);
+}
+
+ModuleDebugDraw::ModuleDebugDraw(Application* app, bool start_enabled) : Module(app, start_enabled)
+{
+}
+
+ModuleDebugDraw::~ModuleDebugDraw()
+{
+}
+
+bool ModuleDebugDraw::Start()
+{
+	lines.lineWidth = 1.0f;
+	boxes.lineWidth = 2.0f;
+
+	if (!App->renderer3D->nullBackend)
+		CreateGrid();
+
+	return true;
+}
+
+bool ModuleDebugDraw::CleanUp()
+{
+	App->renderer3D->glState.DeleteBuffer(lines.buffer);
+	App->renderer3D->glState.DeleteBuffer(boxes.buffer);
+	App->renderer3D->glState.DeleteBuffer(gridBuffer);
+
+	return true;
+}
+
+void ModuleDebugDraw::DrawLine(const float3& a, const float3& b, const Color& color)
+{
+	AddLine(lines.vertices, a, b, PackColor(color));
+}
+
+void ModuleDebugDraw::DrawBox(const float3* corners, const Color& color)
+{
+	uint packed = PackColor(color);
+	for (uint i = 0; i < 24; i += 2)
+		AddLine(boxes.vertices, corners[boxEdges[i]], corners[boxEdges[i + 1]], packed);
+}
+
+void ModuleDebugDraw::DrawAABB(const AABB& box, const Color& color)
+{
+	if (!box.IsFinite())
+		return;
+
+	float3 corners[8];
+	box.GetCornerPoints(corners);
+	DrawBox(corners, color);
+}
+
+void ModuleDebugDraw::DrawFrustum(const Frustum& frustum, const Color& color)
+{
+	float3 corners[8];
+	frustum.GetCornerPoints(corners);
+	DrawBox(corners, color);
+}
+
+void ModuleDebugDraw::Flush()
+{
+	lastVertices = lines.vertices.size() + boxes.vertices.size();
+
+	if (App->renderer3D->nullBackend)
+	{
+		lines.vertices.clear();
+		boxes.vertices.clear();
+		return;
+	}
+
+	GLStateCache& state = App->renderer3D->glState;
+
+	bool lighting = state.IsEnabled(GL_LIGHTING);
+	state.Disable(GL_LIGHTING);
+	state.Disable(GL_TEXTURE_2D);
+
+	state.EnableClientState(GL_VERTEX_ARRAY);
+	state.EnableClientState(GL_COLOR_ARRAY);
+	state.DisableClientState(GL_TEXTURE_COORD_ARRAY);
+
+	if (drawGrid)
+	{
+		DrawVertices(gridBuffer, gridVertices, 1.0f);
+		lastVertices += gridVertices;
+	}
+
+	DrawBatch(lines);
+	DrawBatch(boxes);
+
+	// Meshes don't bind colors, the array must be off again
+	state.DisableClientState(GL_COLOR_ARRAY);
+	state.SetEnabled(GL_LIGHTING, lighting);
+	state.LineWidth(1.0f);
+
+	glColor4f(1.0f, 1.0f, 1.0f, 1.0f);
+}
+
+void ModuleDebugDraw::CreateGrid()
+{
+	std::vector<DebugVertex> vertices;
+	vertices.reserve((GRID_SIZE * 2 + 1) * 4 + 30);
+
+	uint white = PackColor(White);
+	float d = (float)GRID_SIZE;
+	for (float i = -d; i <= d; i += 1.0f)
+	{
+		AddLine(vertices, float3(i, 0.0f, -d), float3(i, 0.0f, d), white);
+		AddLine(vertices, float3(-d, 0.0f, i), float3(d, 0.0f, i), white);
+	}
+
+	// Axis gizmo with its X, Y and Z letters
+	uint red = PackColor(Red), green = PackColor(Green), blue = PackColor(Blue);
+
+	AddLine(vertices, float3(0.0f, 0.0f, 0.0f), float3(1.0f, 0.0f, 0.0f), red);
+	AddLine(vertices, float3(1.0f, 0.1f, 0.0f), float3(1.1f, -0.1f, 0.0f), red);
+	AddLine(vertices, float3(1.1f, 0.1f, 0.0f), float3(1.0f, -0.1f, 0.0f), red);
+
+	AddLine(vertices, float3(0.0f, 0.0f, 0.0f), float3(0.0f, 1.0f, 0.0f), green);
+	AddLine(vertices, float3(-0.05f, 1.25f, 0.0f), float3(0.0f, 1.15f, 0.0f), green);
+	AddLine(vertices, float3(0.05f, 1.25f, 0.0f), float3(0.0f, 1.15f, 0.0f), green);
+	AddLine(vertices, float3(0.0f, 1.15f, 0.0f), float3(0.0f, 1.05f, 0.0f), green);
+
+	AddLine(vertices, float3(0.0f, 0.0f, 0.0f), float3(0.0f, 0.0f, 1.0f), blue);
+	AddLine(vertices, float3(-0.05f, 0.1f, 1.05f), float3(0.05f, 0.1f, 1.05f), blue);
+	AddLine(vertices, float3(0.05f, 0.1f, 1.05f), float3(-0.05f, -0.1f, 1.05f), blue);
+	AddLine(vertices, float3(-0.05f, -0.1f, 1.05f), float3(0.05f, -0.1f, 1.05f), blue);
+
+	gridVertices = vertices.size();
+
+	glGenBuffers(1, (GLuint*)&gridBuffer);
+	App->renderer3D->glState.BindBuffer(GL_ARRAY_BUFFER, gridBuffer);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(DebugVertex) * gridVertices, vertices.data(), GL_STATIC_DRAW);
+}
+
+void ModuleDebugDraw::DrawBatch(DebugBatch& batch)
+{
+	if (batch.vertices.empty())
+		return;
+
+	uint bytes = sizeof(DebugVertex) * batch.vertices.size();
+
+	RingBuffer& ring = App->renderer3D->ringBuffer;
+	RingAllocation range = ring.Allocate(bytes, sizeof(DebugVertex));
+	if (range.data != nullptr)
+	{
+		memcpy(range.data, batch.vertices.data(), bytes);
+		ring.Commit(range);
+
+		DrawVertices(ring.GetBuffer(), batch.vertices.size(), batch.lineWidth, range.offset);
+	}
+	else
+	{
+		// Too big for this frame's ring section, or no ring: stream through the batch's own buffer
+		if (batch.buffer == 0)
+			glGenBuffers(1, (GLuint*)&batch.buffer);
+
+		App->renderer3D->glState.BindBuffer(GL_ARRAY_BUFFER, batch.buffer);
+
+		// Orphan the old storage so the driver doesn't wait for last frame's draw
+		if (bytes > batch.capacity)
+			batch.capacity = bytes * 2;
+		glBufferData(GL_ARRAY_BUFFER, batch.capacity, nullptr, GL_STREAM_DRAW);
+		glBufferSubData(GL_ARRAY_BUFFER, 0, bytes, batch.vertices.data());
+
+		DrawVertices(batch.buffer, batch.vertices.size(), batch.lineWidth);
+	}
+
+	batch.vertices.clear();
+}
+
+void ModuleDebugDraw::DrawVertices(uint buffer, uint count, float lineWidth, uint offset)
+{
+	if (count == 0)
+		return;
+
+	App->renderer3D->glState.BindBuffer(GL_ARRAY_BUFFER, buffer);
+	glVertexPointer(3, GL_FLOAT, sizeof(DebugVertex), (void*)(offset + offsetof(DebugVertex, position)));
+	glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(DebugVertex), (void*)(offset + offsetof(DebugVertex, color)));
+
+	App->renderer3D->glState.LineWidth(lineWidth);
+	glDrawArrays(GL_LINES, 0, count);
+
+	App->renderer3D->drawCalls++;
+}
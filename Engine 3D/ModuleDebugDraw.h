@@ -0,0 +1,65 @@
+#pragma once
+#include "Module.h"
+#include "Globals.h"
+#include "Color.h"
+#include "MathGeoLib/MathGeoLib.h"
+#include <vector>
+
+struct DebugVertex
+{
+	float3 position;
+	uint color = 0u; // RGBA8
+};
+
+// Lines queued during the frame and drawn in one batch per kind, buffer is only used when the ring buffer can't take them
+struct DebugBatch
+{
+	std::vector<DebugVertex> vertices;
+	float lineWidth = 1.0f;
+	uint buffer = 0u;
+	uint capacity = 0u;
+};
+
+class ModuleDebugDraw : public Module
+{
+public:
+	ModuleDebugDraw(Application* app, bool start_enabled = true);
+	~ModuleDebugDraw();
+
+	bool Start();
+	bool CleanUp();
+
+	void DrawLine(const float3& a, const float3& b, const Color& color);
+
+	void DrawBox(const float3* corners, const Color& color);
+
+	void DrawAABB(const AABB& box, const Color& color);
+
+	void DrawFrustum(const Frustum& frustum, const Color& color);
+
+	// Draws everything queued since the last flush, called by the renderer after the geometry
+	void Flush();
+
+private:
+
+	void CreateGrid();
+
+	void DrawBatch(DebugBatch& batch);
+
+	void DrawVertices(uint buffer, uint count, float lineWidth, uint offset = 0u);
+
+public:
+
+	bool drawGrid = true;
+
+	// Vertices sent by the last flush
+	uint lastVertices = 0u;
+
+private:
+
+	DebugBatch lines;
+	DebugBatch boxes;
+
+	uint gridBuffer = 0u;
+	uint gridVertices = 0u;
+};
@@ -1,5 +1,6 @@
 #include "ModuleGameObject.h"
 #include "Application.h"
+#include <map>
 
 
 ModuleGameObject::ModuleGameObject(Application* app, bool start_enabled) : Module(app, start_enabled)
@@ -19,6 +20,13 @@ bool ModuleGameObject::Init()
 
 void ModuleGameObject::SaveScene(const char* name)
 {
+	// Only the cells around the camera are in the scene
+	if (streamer.IsOpen())
+	{
+		LOG("Can't save %s: the open scene is a streamed world, save the scene it was partitioned from", name);
+		return;
+	}
+
 	if (root)
 	{
 		JSON_Value* rootValue = json_value_init_array();
@@ -41,8 +49,22 @@ void ModuleGameObject::SaveScene(const char* name)
 void ModuleGameObject::LoadScene(const char * name)
 {
 	JSON_Value* scene = json_parse_file(name);
+
+	JSON_Array* objArray = nullptr;
+	JSON_Object* world = nullptr;
 	if (json_value_get_type(scene) == JSONArray)
+		objArray = json_value_get_array(scene);
+	else if (json_value_get_type(scene) == JSONObject)
+	{
+		world = json_object_get_object(json_value_get_object(scene), "World");
+		objArray = json_object_get_array(world, "Objects");
+	}
+
+	if (objArray != nullptr)
 	{
+		// Streamed objects first, they leave the lists below along with the cells
+		streamer.Close();
+
 		// Delete previous scene
 
 		for (auto gameObj : gameObjects)
@@ -55,11 +77,14 @@ void ModuleGameObject::LoadScene(const char * name)
 		App->sceneIntro->current_object = nullptr;
 		App->renderer3D->mesh_list.clear();
 
+		App->resources->loader.BeginBatch();
+		sceneLoading = true;
+		sceneLoadStart = SDL_GetPerformanceCounter();
+		loadReport = SceneLoadReport();
+
 		// Prepare new Quadtree
 
 		// Load new scene
-		JSON_Array* objArray = json_value_get_array(scene);
-
 		int objectsInScene = json_array_get_count(objArray);
 
 		std::list<GameObject*> goInNewScene;
@@ -88,8 +113,53 @@ void ModuleGameObject::LoadScene(const char * name)
 				}				
 			}
 		}
+
+		// Requests were queued before the parents were known, now the world positions are right.
+		// Shared resources load for their closest user.
+		std::map<uint, float> priorities;
+		for (auto obj : goInNewScene)
+		{
+			float priority = GetLoadPriority(obj);
+
+			ComponentMesh* mesh = (ComponentMesh*)obj->GetComponent(CompMesh);
+			ResourceMesh* meshResource = mesh != nullptr ? mesh->GetMesh() : nullptr;
+			if (meshResource != nullptr && meshResource->loadHandle != 0)
+			{
+				std::pair<std::map<uint, float>::iterator, bool> entry = priorities.insert(std::make_pair(meshResource->loadHandle, priority));
+				if (priority < entry.first->second)
+					entry.first->second = priority;
+			}
+
+			ComponentTexture* texture = (ComponentTexture*)obj->GetComponent(CompTexture);
+			ResourceTexture* textureResource = texture != nullptr ? texture->GetTexture() : nullptr;
+			if (textureResource != nullptr && textureResource->loadHandle != 0)
+			{
+				std::pair<std::map<uint, float>::iterator, bool> entry = priorities.insert(std::make_pair(textureResource->loadHandle, priority));
+				if (priority < entry.first->second)
+					entry.first->second = priority;
+			}
+		}
+
+		ResourceLoader& loader = App->resources->loader;
+		for (std::map<uint, float>::const_iterator it = priorities.begin(); it != priorities.end(); ++it)
+			loader.SetPriority(it->first, it->second);
+
+		if (world != nullptr)
+			streamer.Open(world);
+
 		root->transform->UpdateBoundingBox();
 	}
+
+	json_value_free(scene);
+}
+
+float ModuleGameObject::GetLoadPriority(const GameObject* go) const
+{
+	const ComponentCamera* camera = App->renderer3D->current_cam;
+	if (camera == nullptr)
+		return 0.0f;
+
+	return go->transform->GetGlobalPos().Distance(camera->frustum.pos);
 }
 
 void ModuleGameObject::SaveGameObjects(JSON_Array* &parent, GameObject* current)
@@ -109,6 +179,36 @@ void ModuleGameObject::SaveGameObjects(JSON_Array* &parent, GameObject* current)
 
 update_status ModuleGameObject::Update()
 {
+	for (std::list<ComponentMesh*>::iterator it = pendingMeshes.begin(); it != pendingMeshes.end();)
+	{
+		ComponentMesh* component = *it;
+		ResourceMesh* mesh = component->GetMesh();
+		if (mesh != nullptr && mesh->loadHandle != 0)
+		{
+			++it;
+			continue;
+		}
+
+		// Failed loads were logged once by the mesh
+		if (mesh != nullptr && !mesh->loadFailed)
+			component->OnMeshReady();
+		it = pendingMeshes.erase(it);
+	}
+
+	if (App->renderer3D->current_cam != nullptr)
+		streamer.Update(App->renderer3D->current_cam->frustum.pos);
+
+	// Boxes and quadtree from the full hierarchy once the last mesh is in
+	if (sceneLoading && App->resources->loader.GetBatchProgress() >= 1.0f)
+	{
+		sceneLoading = false;
+		root->transform->UpdateBoundingBox();
+
+		float ms = (float)(SDL_GetPerformanceCounter() - sceneLoadStart) * 1000.0f / SDL_GetPerformanceFrequency();
+		LOG("Scene loaded in %.1f ms: %u meshes and %u textures read, %u mesh and %u texture duplicates avoided", ms,
+			loadReport.meshesLoaded, loadReport.texturesLoaded, loadReport.meshesShared, loadReport.texturesShared);
+	}
+
 	for (auto comp : componentsToDelete)
 	{
 		comp->gameObject->components.remove(comp);
@@ -122,6 +222,7 @@ update_status ModuleGameObject::Update()
 			App->sceneIntro->current_object = nullptr;
 
 		gameObjects.remove(obj);
+		streamer.Forget(obj);
 		obj->RealDelete();
 		delete obj;
 	}
@@ -1,7 +1,20 @@
 #pragma once
 #include "Module.h"
 #include "GameObject.h"
+#include "WorldStreamer.h"
 #include <list>
+
+class ComponentMesh;
+
+// Resource references resolved by the last LoadScene: distinct assets read against references that found them loaded
+struct SceneLoadReport
+{
+	uint meshesLoaded = 0u;
+	uint meshesShared = 0u;
+	uint texturesLoaded = 0u;
+	uint texturesShared = 0u;
+};
+
 class ModuleGameObject :
 	public Module
 {
@@ -13,8 +26,13 @@ public:
 
 	void SaveScene(const char* name);
 
+	// Returns once the hierarchy exists, meshes and textures keep arriving from the resource loader.
+	// A world file brings its persistent objects, its cells stream in around the camera.
 	void LoadScene(const char* name);
 
+	// Loader priority for the object's resources: distance to the current camera
+	float GetLoadPriority(const GameObject* go) const;
+
 	void SaveGameObjects(JSON_Array* &parent, GameObject* current);
 
 	update_status Update();
@@ -31,4 +49,15 @@ public:
 	std::list<Component*> componentsToDelete;
 
 	unsigned int fireworkID = 0u;
+
+	// Set while the loader still has requests from the last LoadScene
+	bool sceneLoading = false;
+	unsigned long long sceneLoadStart = 0ull;
+
+	SceneLoadReport loadReport;
+
+	// Loaded components waiting for their mesh, shared ones included, they join the render list once it's uploaded
+	std::list<ComponentMesh*> pendingMeshes;
+
+	WorldStreamer streamer;
 };
\ No newline at end of file
@@ -10,10 +10,16 @@
 #include "Assimp/include/postprocess.h"
 #include "Assimp/include/cfileio.h"
 #include "DevIL/include/il.h"
+#include "DevIL/include/ilu.h"
 #include "DevIL/include/ilut.h"
+#include "DDS.h"
 #include "ComponentTexture.h"
 #include "ComponentMesh.h"
 #include "ModuleResources.h"
+#include "MeshOptimizer.h"
+#include "MeshFile.h"
+#include "MeshEncoding.h"
+#include "Hash.h"
 
 #pragma comment (lib, "Assimp/libx86/assimp.lib")
 #pragma comment (lib, "DevIL/libx86/DevIL.lib")
@@ -41,6 +47,17 @@ bool ModuleImport::Start()
 	stream = aiGetPredefinedLogStream(aiDefaultLogStream_DEBUGGER, nullptr);
 	aiAttachLogStream(&stream);
 
+	// DevIL keeps global state, once is enough
+	ilInit();
+	iluInit();
+	ilutInit();
+
+	if (App->renderer3D->nullBackend)
+	{
+		App->game_object->LoadScene(App->startScene.c_str());
+		return ret;
+	}
+
 	GLubyte checkImage[500][500][4];
 	for (int i = 0; i < 500; i++) {
 		for (int j = 0; j < 500; j++) {
@@ -54,7 +71,7 @@ bool ModuleImport::Start()
 
 	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
 	glGenTextures(1, &checkerImageID);
-	glBindTexture(GL_TEXTURE_2D, checkerImageID);
+	App->renderer3D->glState.BindTexture(checkerImageID);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
@@ -62,7 +79,7 @@ bool ModuleImport::Start()
 	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 500, 500, 0, GL_RGBA, GL_UNSIGNED_BYTE, checkImage);
 
 	//ImportFBX("Assets\\Models\\Street environment_V01.FBX");
-	App->game_object->LoadScene("Assets\\Scenes\\HousesWorking.json");
+	App->game_object->LoadScene(App->startScene.c_str());
 	/*ImportTexture("Assets\\Textures\\Baker_house.png");*/
 
 
@@ -71,191 +88,303 @@ bool ModuleImport::Start()
 
 void ModuleImport::ImportFBX(const char* path)
 {
-	const aiScene* scene = aiImportFile(path, aiProcessPreset_TargetRealtime_MaxQuality);
-	if (scene != nullptr && scene->HasMeshes())
-	{
-		GameObject* newGameObject = App->sceneIntro->current_object = LoadMeshNode(scene, scene->mRootNode, App->game_object->root, path);
+	// Read and converted on the workers, the scene gets the hierarchy from Update once it's uploaded
+	models.Import(path);
+}
 
-		aiReleaseImport(scene);
-	}
-	else
-		LOG("Error loading scene %s", path);
+static uint AlignSection(uint offset)
+{
+	return (offset + MESH_FILE_ALIGNMENT - 1) & ~(MESH_FILE_ALIGNMENT - 1);
 }
 
-GameObject* ModuleImport::LoadMeshNode(const aiScene * scene, aiNode * node, GameObject * parent, const char* path)
+static void AddSection(MeshFileSection& section, uint bytes, uint& fileSize)
 {
-	GameObject* go = new GameObject(parent, node->mName.C_Str());
-	
-	if (node->mNumMeshes > 0)
-	{
-		aiMesh* new_mesh = scene->mMeshes[node->mMeshes[0]];
+	if (bytes == 0)
+		return;
 
-		std::string _path = path;
-		std::string _name = node->mName.C_Str();
+	section.offset = AlignSection(fileSize);
+	section.size = bytes;
+	fileSize = section.offset + bytes;
+}
 
-		ResourceMesh* m = (ResourceMesh*)App->resources->GetResource(ResourceType::Mesh, (_path + _name).c_str());
-		if (m == nullptr)
-		{
-			m = new ResourceMesh((_path + _name).c_str());
-			m->vertex.size = new_mesh->mNumVertices * 3;
-			m->vertex.data = new float[m->vertex.size];
-			memset(m->vertex.data, 0, sizeof(float) * m->vertex.size);
-			memcpy(m->vertex.data, new_mesh->mVertices, sizeof(float) * m->vertex.size);
-			LOG("New mesh with %d vertices", m->vertex.size);
-
-			//Load bounding box
-			go->originalBoundingBox.Enclose((float3*)m->vertex.data, m->vertex.size/3);
-			go->boundingBox = go->originalBoundingBox;
-
-			if (new_mesh->HasFaces())
-			{
-				m->index.size = new_mesh->mNumFaces * 3;
-				m->index.data = new uint[m->index.size];
-				memset(m->index.data, 0, sizeof(float) * m->index.size);
-				for (uint i = 0; i < new_mesh->mNumFaces; ++i)
-				{
-					if (new_mesh->mFaces[i].mNumIndices != 3)
-					{
-						LOG("WARNING, geometry face with != 3 indices!");
-					}
-
-					else
-					{
-						memcpy(&m->index.data[i * 3], new_mesh->mFaces[i].mIndices, 3 * sizeof(uint));
-					}
-				}
-			}
-			if (new_mesh->HasTextureCoords(m->uvs.id))
-			{
-				m->uvs.size = new_mesh->mNumVertices * 2;
-				m->uvs.data = new float[m->uvs.size];
-
-				for (int i = 0; i < new_mesh->mNumVertices; ++i)
-				{
-					memcpy(&m->uvs.data[i * 2], &new_mesh->mTextureCoords[0][i].x, sizeof(float));
-					memcpy(&m->uvs.data[(i * 2) + 1], &new_mesh->mTextureCoords[0][i].y, sizeof(float));
-				}
-
-				glGenBuffers(1, (GLuint*)&(m->uvs.id));
-				glBindBuffer(GL_ARRAY_BUFFER, m->uvs.id);
-				glBufferData(GL_ARRAY_BUFFER, sizeof(float) * m->uvs.size, m->uvs.data, GL_STATIC_DRAW);
-			}
-
-			if (new_mesh->HasNormals()) {
-				m->hasNormals = true;
-				m->normals.size = new_mesh->mNumVertices * 3;
-				m->normals.data = new float[m->normals.size];
-				memcpy(m->normals.data, new_mesh->mNormals, sizeof(float) * m->normals.size);
-			}
-			glGenBuffers(1, (GLuint*) & (m->vertex.id));
-			glBindBuffer(GL_ARRAY_BUFFER, m->vertex.id);
-			glBufferData(GL_ARRAY_BUFFER, sizeof(float) * m->vertex.size, m->vertex.data, GL_STATIC_DRAW);
-
-			glGenBuffers(1, (GLuint*) & (m->index.id));
-			glBindBuffer(GL_ARRAY_BUFFER, m->index.id);
-			glBufferData(GL_ARRAY_BUFFER, sizeof(float) * m->index.size, m->index.data, GL_STATIC_DRAW);
-
-			App->resources->AddResource(m);
-		}
-		else
-		{
-			App->resources->ResourceUsageIncreased(m);
-		}
+void ModuleImport::SaveMeshImporter(ResourceMesh* m, const uint &uuid, char* path, bool encoded)
+{
+	uint vertexCount = m->GetVertexCount();
+	uint totalIndices = m->index.size + m->lodIndex.size;
+	bool shortIndices = vertexCount < 65536;
+	bool packed = m->packedFormat && m->packed.data != nullptr;
 
-		if (scene->HasMaterials())
-		{
-			aiMaterial* material = scene->mMaterials[new_mesh->mMaterialIndex];
+	// The packed stream is rebuilt after decoding, it would only undo the compression
+	if (encoded)
+	{
+		shortIndices = false;
+		packed = false;
+	}
 
-			if (material)
-			{
-				aiString textName;
-				material->GetTexture(aiTextureType_DIFFUSE, 0, &textName);
+	if (!m->bounds.IsFinite())
+		m->ComputeBounds();
+
+	MeshFileHeader header;
+	header.flags = (m->normals.data ? MESH_FILE_NORMALS : 0) | (m->uvs.data ? MESH_FILE_UVS : 0) | (packed ? MESH_FILE_PACKED : 0) | (packed && m->halfPositions ? MESH_FILE_HALF_POSITIONS : 0);
+	header.vertexCount = vertexCount;
+	header.indexCount = m->index.size;
+	header.lodIndexCount = m->lodIndex.size;
+	header.lodCount = m->lods.size() < MAX_MESH_LODS ? m->lods.size() : MAX_MESH_LODS;
+	memcpy(header.boundsMin, m->bounds.minPoint.ptr(), sizeof(header.boundsMin));
+	memcpy(header.boundsMax, m->bounds.maxPoint.ptr(), sizeof(header.boundsMax));
+	header.acmr = m->acmr;
+	header.indexSize = shortIndices ? sizeof(unsigned short) : sizeof(uint);
+
+	if (packed)
+	{
+		header.stride = m->stride;
+		header.texCoordOffset = m->texCoordOffset;
+		memcpy(header.uvMin, m->uvMin, sizeof(header.uvMin));
+		memcpy(header.uvRange, m->uvRange, sizeof(header.uvRange));
+	}
 
-				std::string textPath(textName.data);
+	for (uint i = 0; i < header.lodCount; ++i)
+	{
+		header.lods[i].indexOffset = i == 0 ? 0u : m->lods[i].indexOffset;
+		header.lods[i].indexCount = i == 0 ? m->index.size : m->lods[i].indexCount;
+		header.lods[i].error = m->lods[i].error;
+		header.lods[i].screenSize = m->lods[i].screenSize;
+	}
 
-				textPath = textPath.substr(textPath.find_last_of("\\") + 1);
+	uint size = sizeof(MeshFileHeader);
 
-				textPath = "Assets\\Textures\\" + textPath;
+	std::vector<char> encoding;
+	if (encoded && EncodeMesh(m, header, encoding))
+	{
+		header.flags |= MESH_FILE_ENCODED;
+		AddSection(header.encoded, encoding.size(), size);
+		size = AlignSection(size);
+
+		char* meshBuffer = new char[size];
+		memset(meshBuffer, 0, size);
+		memcpy(meshBuffer, &header, sizeof(header));
+		memcpy(meshBuffer + header.encoded.offset, encoding.data(), encoding.size());
+
+		App->resources->SaveFile(size, meshBuffer, ResourceType::Mesh, uuid, path);
+		delete[] meshBuffer;
+
+		meshBytesRaw += sizeof(MeshFileHeader) + sizeof(uint) * totalIndices + sizeof(float) * (m->vertex.size + m->normals.size + m->uvs.size);
+		meshBytesWritten += size;
+		m->encoded = true;
+		return;
+	}
 
-				ImportTexture(textPath.c_str(), go);
-			}
-		}
-		
-		ComponentMesh* newMesh = new ComponentMesh(go);
-		newMesh->mesh = m;
-		
-		SaveMeshImporter(m, newMesh->uuid);
+	AddSection(header.indices, sizeof(uint) * totalIndices, size);
+	AddSection(header.vertices, sizeof(float) * m->vertex.size, size);
+	AddSection(header.normals, sizeof(float) * m->normals.size, size);
+	AddSection(header.uvs, sizeof(float) * m->uvs.size, size);
+	AddSection(header.shortIndices, shortIndices ? sizeof(unsigned short) * totalIndices : 0u, size);
+	AddSection(header.packed, packed ? m->packed.size : 0u, size);
+	size = AlignSection(size);
 
-		App->renderer3D->mesh_list.push_back(newMesh);
+	char* meshBuffer = new char[size];
+	memset(meshBuffer, 0, size);
+	memcpy(meshBuffer, &header, sizeof(header));
 
-		App->sceneIntro->quadtree.QT_Insert(go);
+	memcpy(meshBuffer + header.indices.offset, m->index.data, sizeof(uint) * m->index.size);
+	if (m->lodIndex.size > 0)
+		memcpy(meshBuffer + header.indices.offset + sizeof(uint) * m->index.size, m->lodIndex.data, sizeof(uint) * m->lodIndex.size);
+	memcpy(meshBuffer + header.vertices.offset, m->vertex.data, header.vertices.size);
+	if (m->normals.data)
+		memcpy(meshBuffer + header.normals.offset, m->normals.data, header.normals.size);
+	if (m->uvs.data)
+		memcpy(meshBuffer + header.uvs.offset, m->uvs.data, header.uvs.size);
 
-		LOG("Mesh loaded");
+	// What the element buffer gets, so loads upload straight from the file
+	if (shortIndices)
+	{
+		const uint* indices = (const uint*)(meshBuffer + header.indices.offset);
+		unsigned short* shortIndex = (unsigned short*)(meshBuffer + header.shortIndices.offset);
+		for (uint i = 0; i < totalIndices; ++i)
+			shortIndex[i] = (unsigned short)indices[i];
 	}
 
-	float4x4 transformMat(
-		node->mTransformation.a1, node->mTransformation.a2, node->mTransformation.a3, node->mTransformation.a4,
-		node->mTransformation.b1, node->mTransformation.b2, node->mTransformation.b3, node->mTransformation.b4,
-		node->mTransformation.c1, node->mTransformation.c2, node->mTransformation.c3, node->mTransformation.c4,
-		node->mTransformation.d1, node->mTransformation.d2, node->mTransformation.d3, node->mTransformation.d4);
+	if (packed)
+		memcpy(meshBuffer + header.packed.offset, m->packed.data, header.packed.size);
+
+	App->resources->SaveFile(size, meshBuffer, ResourceType::Mesh, uuid, path);
 
-	go->transform->SetTransform(transformMat);
+	delete[] meshBuffer;
+
+	meshBytesRaw += size;
+	meshBytesWritten += size;
+	m->encoded = false;
+}
+
+bool ModuleImport::ReencodeMesh(ResourceMesh* m, bool encoded)
+{
+	if (m->uuid == 0 || m->vertex.data == nullptr || m->index.data == nullptr)
+		return false;
+
+	// Windows won't replace a file that's still mapped
+	m->DetachMapping();
+	SaveMeshImporter(m, m->uuid, nullptr, encoded);
+
+	return m->encoded == encoded;
+}
+
+// Streams alias the file when it's mapped, otherwise they get their own copy
+template <typename T>
+static T* ReadSection(const char* file, const MeshFileSection& section, bool alias)
+{
+	if (section.size == 0)
+		return nullptr;
+
+	if (alias)
+		return (T*)(file + section.offset);
+
+	T* data = new T[section.size / sizeof(T)];
+	memcpy(data, file + section.offset, section.size);
+	return data;
+}
+
+static bool ValidSection(const MeshFileSection& section, uint size)
+{
+	return section.size == 0 || (section.offset % MESH_FILE_ALIGNMENT == 0 && section.offset <= size && section.size <= size - section.offset);
+}
 
-	for (int child = 0; child < node->mNumChildren; ++child)
+// Everything but the streams
+static void ReadMeshDescription(ResourceMesh* m, const MeshFileHeader& header)
+{
+	m->lods.clear();
+	for (uint i = 0; i < header.lodCount; ++i)
 	{
-		LoadMeshNode(scene, node->mChildren[child], go, path);
+		MeshLOD lod;
+		lod.indexOffset = header.lods[i].indexOffset;
+		lod.indexCount = header.lods[i].indexCount;
+		lod.error = header.lods[i].error;
+		lod.screenSize = header.lods[i].screenSize;
+		m->lods.push_back(lod);
 	}
-	return go;
+
+	m->bounds.minPoint = float3(header.boundsMin);
+	m->bounds.maxPoint = float3(header.boundsMax);
+	m->acmr = header.acmr;
 }
 
-void ModuleImport::SaveMeshImporter(ResourceMesh* m, const uint &uuid, char* path)
+// Always decoded into owned streams, the mapping stays with the caller
+static bool ReadEncodedMeshFile(ResourceMesh* m, const MeshFileHeader& header, const char* buff, uint size)
 {
-	uint ranges[4] = { m->index.size, m->vertex.size, m->normals.size, m->uvs.size };
-	float size = 
-		sizeof(ranges) +
-		sizeof(uint) * m->index.size +
-		sizeof(float) * m->vertex.size +
-		sizeof(float) * m->normals.size +
-		sizeof(float) * m->uvs.size;
+	if (header.encoded.size == 0 || !ValidSection(header.encoded, size))
+		return false;
 
-	char* meshBuffer = new char[size];
-	char* cursor = meshBuffer;
+	Uint64 start = SDL_GetPerformanceCounter();
+	if (!DecodeMesh(m, header, buff + header.encoded.offset, header.encoded.size))
+		return false;
 
-	uint bytes = sizeof(ranges);
-	memcpy(cursor, ranges, bytes);
+	App->import->meshDecodeTicks += SDL_GetPerformanceCounter() - start;
+	App->import->meshBytesDecoded += sizeof(uint) * (header.indexCount + header.lodIndexCount) + sizeof(float) * (m->vertex.size + m->normals.size + m->uvs.size);
+	App->import->meshesDecoded++;
 
-	cursor += bytes;
-	bytes = sizeof(uint) * m->index.size;
-	memcpy(cursor, m->index.data, bytes);
+	ReadMeshDescription(m, header);
+	m->encoded = true;
+	return true;
+}
 
-	cursor += bytes;
-	bytes = sizeof(float) * m->vertex.size;
-	memcpy(cursor, m->vertex.data, bytes);
+static bool ReadMeshFile(ResourceMesh* m, const char* buff, uint size, MappedFile** mapping)
+{
+	// Version 2 headers are a prefix of version 3 ones, the rest keeps its defaults
+	MeshFileHeader header;
+	memcpy(&header, buff, MESH_FILE_HEADER_V2_SIZE);
+	if (header.version == MESH_FILE_VERSION && header.headerSize == sizeof(MeshFileHeader) && size >= sizeof(MeshFileHeader))
+		memcpy(&header, buff, sizeof(MeshFileHeader));
+	else if (header.version != 2 || header.headerSize != MESH_FILE_HEADER_V2_SIZE)
+		return false;
+
+	uint totalIndices = header.indexCount + header.lodIndexCount;
+	if (header.lodCount == 0 || header.lodCount > MAX_MESH_LODS)
+		return false;
+	for (uint i = 0; i < header.lodCount; ++i)
+	{
+		if (header.lods[i].indexOffset > totalIndices || header.lods[i].indexCount > totalIndices - header.lods[i].indexOffset)
+			return false;
+	}
 
-	if (m->normals.data)
+	if (header.flags & MESH_FILE_ENCODED)
+		return ReadEncodedMeshFile(m, header, buff, size);
+
+	if (header.indices.size != sizeof(uint) * totalIndices || header.vertices.size != sizeof(float) * 3 * header.vertexCount)
+		return false;
+
+	// Uploaded straight from the mapping as sizeof(ushort) * totalIndices, absent when the mesh needs 32 bits
+	if (header.shortIndices.size != 0 && header.shortIndices.size != sizeof(unsigned short) * totalIndices)
+		return false;
+	if (!ValidSection(header.indices, size) || !ValidSection(header.vertices, size) || !ValidSection(header.normals, size) ||
+		!ValidSection(header.uvs, size) || !ValidSection(header.shortIndices, size) || !ValidSection(header.packed, size))
+		return false;
+
+	bool alias = mapping != nullptr && *mapping != nullptr && (*mapping)->Contains(buff);
+
+	m->index.size = header.indexCount;
+	m->vertex.size = header.vertexCount * 3;
+	m->normals.size = header.normals.size / sizeof(float);
+	m->uvs.size = header.uvs.size / sizeof(float);
+	m->hasNormals = (header.flags & MESH_FILE_NORMALS) != 0;
+
+	m->index.data = ReadSection<uint>(buff, header.indices, alias);
+	m->vertex.data = ReadSection<float>(buff, header.vertices, alias);
+	m->normals.data = ReadSection<float>(buff, header.normals, alias);
+	m->uvs.data = ReadSection<float>(buff, header.uvs, alias);
+
+	// Levels share the index section, the simplified ones right after level 0
+	m->lodIndex.size = header.lodIndexCount;
+	if (header.lodIndexCount > 0)
 	{
-		cursor += bytes;
-		bytes = sizeof(float) * m->normals.size;
-		memcpy(cursor, m->normals.data, bytes);
+		if (alias)
+			m->lodIndex.data = m->index.data + header.indexCount;
+		else
+		{
+			m->lodIndex.data = new uint[header.lodIndexCount];
+			memcpy(m->lodIndex.data, m->index.data + header.indexCount, sizeof(uint) * header.lodIndexCount);
+		}
 	}
 
-	if (m->uvs.data)
+	ReadMeshDescription(m, header);
+	m->encoded = false;
+
+	if (header.flags & MESH_FILE_PACKED)
 	{
-		cursor += bytes;
-		bytes = sizeof(float) * m->uvs.size;
-		memcpy(cursor, m->uvs.data, bytes);
+		m->packed.size = header.packed.size;
+		m->packed.data = ReadSection<char>(buff, header.packed, alias);
+		m->packedFormat = true;
+		m->halfPositions = (header.flags & MESH_FILE_HALF_POSITIONS) != 0;
+		m->stride = header.stride;
+		m->texCoordOffset = header.texCoordOffset;
+		memcpy(m->uvMin, header.uvMin, sizeof(m->uvMin));
+		memcpy(m->uvRange, header.uvRange, sizeof(m->uvRange));
 	}
 
-	App->resources->SaveFile(size, meshBuffer, ResourceType::Mesh, uuid, path);
+	if (alias)
+	{
+		m->mappedShortIndices = (const unsigned short*)ReadSection<unsigned short>(buff, header.shortIndices, true);
+		m->mapping = *mapping;
+		*mapping = nullptr;
+	}
 
-	delete[] meshBuffer;
+	return true;
 }
 
-void ModuleImport::LoadMeshImporter(ResourceMesh* m, const uint &uuid, char* buff)
+bool ModuleImport::ReadMeshImporter(ResourceMesh* m, const char* buff, uint size, MappedFile** mapping, bool* truncatedLODs)
 {
+	if (buff == nullptr)
+		return false;
+
+	uint magic = 0u;
+	if (size >= MESH_FILE_HEADER_V2_SIZE)
+		memcpy(&magic, buff, sizeof(uint));
+	if (magic == MESH_FILE_MAGIC)
+		return ReadMeshFile(m, buff, size, mapping);
+
+	// Version 1: four counts, the streams back to back and the optional LOD trailer
+
 	uint ranges[4];
 
-	char* cursor = buff;
+	const char* cursor = buff;
 
 	uint bytes = sizeof(ranges);
 	memcpy(ranges, cursor, bytes);
@@ -270,34 +399,216 @@ void ModuleImport::LoadMeshImporter(ResourceMesh* m, const uint &uuid, char* buf
 	m->index.data = new uint[m->index.size];
 	memcpy(m->index.data, cursor, bytes);
 
-	glGenBuffers(1, (GLuint*) & (m->index.id));
-	glBindBuffer(GL_ARRAY_BUFFER, m->index.id);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(float) * m->index.size, m->index.data, GL_STATIC_DRAW);
-
 	cursor += bytes;
 	bytes = sizeof(float) * m->vertex.size;
 	m->vertex.data = new float[m->vertex.size];
 	memcpy(m->vertex.data, cursor, bytes);
 
-	glGenBuffers(1, (GLuint*) & (m->vertex.id));
-	glBindBuffer(GL_ARRAY_BUFFER, m->vertex.id);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(float) * m->vertex.size, m->vertex.data, GL_STATIC_DRAW);
-
 	cursor += bytes;
 	bytes = sizeof(float) * m->normals.size;
-	m->normals.data = new float[m->normals.size];
-	memcpy(m->normals.data, cursor, bytes);
+	if (m->normals.size > 0)
+	{
+		m->hasNormals = true;
+		m->normals.data = new float[m->normals.size];
+		memcpy(m->normals.data, cursor, bytes);
+	}
 
 	cursor += bytes;
 	bytes = sizeof(float) * m->uvs.size;
-	m->uvs.data = new float[m->uvs.size];
-	memcpy(m->uvs.data, cursor, bytes);
+	if (m->uvs.size > 0)
+	{
+		m->uvs.data = new float[m->uvs.size];
+		memcpy(m->uvs.data, cursor, bytes);
+	}
+
+	// Files written before LODs end right after the streams
+	cursor += bytes;
+	m->lods.clear();
+	m->lods.push_back(MeshLOD());
+
+	uint lodCount = 0u;
+	uint lodEntry = sizeof(uint) + 2 * sizeof(float);
+	if (cursor + sizeof(uint) <= buff + size)
+	{
+		memcpy(&lodCount, cursor, sizeof(uint));
+		cursor += sizeof(uint);
+
+		if (lodCount >= MAX_MESH_LODS || cursor + lodEntry * lodCount > buff + size)
+			lodCount = 0u;
+	}
+
+	uint lodOffset = m->index.size;
+	for (uint i = 0; i < lodCount; ++i)
+	{
+		MeshLOD lod;
+		memcpy(&lod.indexCount, cursor, sizeof(uint));
+		memcpy(&lod.error, cursor + sizeof(uint), sizeof(float));
+		memcpy(&lod.screenSize, cursor + sizeof(uint) + sizeof(float), sizeof(float));
+		cursor += lodEntry;
+
+		lod.indexOffset = lodOffset;
+		lodOffset += lod.indexCount;
+		m->lods.push_back(lod);
+	}
+
+	m->lodIndex.size = lodOffset - m->index.size;
+	if (m->lodIndex.size > 0)
+	{
+		if (cursor + sizeof(uint) * m->lodIndex.size <= buff + size)
+		{
+			m->lodIndex.data = new uint[m->lodIndex.size];
+			memcpy(m->lodIndex.data, cursor, sizeof(uint) * m->lodIndex.size);
+		}
+		else
+		{
+			if (truncatedLODs)
+				*truncatedLODs = true;
+			m->lodIndex.size = 0u;
+			m->lods.resize(1);
+		}
+	}
+
+	m->ComputeBounds();
+
+	return true;
+}
+
+void ModuleImport::LoadMeshImporter(ResourceMesh* m, const uint &uuid, char* buff, uint size)
+{
+	bool truncatedLODs = false;
+	if (!ReadMeshImporter(m, buff, size, nullptr, &truncatedLODs))
+	{
+		LOG("Couldn't load mesh %u", uuid);
+		delete[] buff;
+		return;
+	}
+
+	if (truncatedLODs)
+		LOG("Mesh %u has a truncated LOD table", uuid);
+
+	UploadMesh(m);
+
+	delete[] buff;
+}
+
+void ModuleImport::OptimizeMesh(ResourceMesh* m)
+{
+	uint vertexCount = m->GetVertexCount();
+	if (m->index.size < 3 || vertexCount == 0)
+		return;
+
+	m->acmrBeforeOptimization = ComputeACMR(m->index.data, m->index.size, vertexCount);
+
+	OptimizeVertexCache(m->index.data, m->index.size, vertexCount);
+
+	if (optimizeOverdraw)
+		OptimizeOverdraw(m->index.data, m->index.size, m->vertex.data, vertexCount);
+
+	// Lay the vertices out in the order the triangles fetch them
+	std::vector<uint> remap;
+	uint newVertexCount = OptimizeVertexFetch(m->index.data, m->index.size, vertexCount, remap);
+
+	float* vertices = RemapVertexStream(m->vertex.data, 3, vertexCount, remap, newVertexCount);
+	delete[] m->vertex.data;
+	m->vertex.data = vertices;
+	m->vertex.size = newVertexCount * 3;
+
+	if (m->normals.data)
+	{
+		float* normals = RemapVertexStream(m->normals.data, 3, vertexCount, remap, newVertexCount);
+		delete[] m->normals.data;
+		m->normals.data = normals;
+		m->normals.size = newVertexCount * 3;
+	}
+
+	if (m->uvs.data)
+	{
+		float* uvs = RemapVertexStream(m->uvs.data, 2, vertexCount, remap, newVertexCount);
+		delete[] m->uvs.data;
+		m->uvs.data = uvs;
+		m->uvs.size = newVertexCount * 2;
+	}
+
+	m->acmr = ComputeACMR(m->index.data, m->index.size, newVertexCount);
+}
+
+void ModuleImport::GenerateLODs(ResourceMesh* m)
+{
+	uint vertexCount = m->GetVertexCount();
+
+	m->lods.clear();
+	m->lods.push_back(MeshLOD());
+	delete[] m->lodIndex.data;
+	m->lodIndex.data = nullptr;
+	m->lodIndex.size = 0u;
+
+	// Small meshes are cheaper to draw than to switch
+	if (m->index.size < 3 * 64 || vertexCount == 0)
+		return;
+
+	std::vector<uint> lodIndices;
+	std::vector<uint> previous(m->index.data, m->index.data + m->index.size);
+	std::vector<uint> simplified(m->index.size);
+
+	uint levels = lodLevels < 1 ? 1 : (lodLevels >= MAX_MESH_LODS ? MAX_MESH_LODS - 1 : lodLevels);
+	for (uint level = 1; level <= levels; ++level)
+	{
+		// Each level starts from the previous one, errors only grow down the chain
+		float error = 0.0f;
+		uint target = previous.size() / 2;
+		target -= target % 3;
+
+		uint count = SimplifyMesh(simplified.data(), previous.data(), previous.size(), m->vertex.data, vertexCount, target, lodMaxError * level, &error);
+
+		// Not worth a level if it barely removed anything
+		if (count == 0 || count > previous.size() * 0.9f)
+			break;
+
+		OptimizeVertexCache(simplified.data(), count, vertexCount);
+
+		MeshLOD lod;
+		lod.indexOffset = m->index.size + lodIndices.size();
+		lod.indexCount = count;
+		lod.error = error > m->lods.back().error ? error : m->lods.back().error;
+		lod.screenSize = 0.8f / (float)(1 << level);
+		m->lods.push_back(lod);
+
+		lodIndices.insert(lodIndices.end(), simplified.begin(), simplified.begin() + count);
+		previous.assign(simplified.begin(), simplified.begin() + count);
+	}
+
+	if (!lodIndices.empty())
+	{
+		m->lodIndex.size = lodIndices.size();
+		m->lodIndex.data = new uint[m->lodIndex.size];
+		memcpy(m->lodIndex.data, lodIndices.data(), sizeof(uint) * m->lodIndex.size);
+	}
+}
+
+void ModuleImport::PrepareMesh(ResourceMesh* m)
+{
+	// Version 2 files carry both, only redone when missing or packed with other settings
+	if (m->acmr == 0.0f)
+		m->acmr = ComputeACMR(m->index.data, m->index.size, m->GetVertexCount());
+
+	bool half = halfPositions && GLEW_ARB_half_float_vertex;
+	if (packedVertices && !App->renderer3D->nullBackend && !(m->packedFormat && m->packed.data != nullptr && m->halfPositions == half))
+		m->PackVertices(half);
+}
+
+void ModuleImport::UploadMesh(ResourceMesh* m)
+{
+	PrepareMesh(m);
 
-	glGenBuffers(1, (GLuint*)&(m->uvs.id));
-	glBindBuffer(GL_ARRAY_BUFFER, m->uvs.id);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(float) * m->uvs.size, m->uvs.data, GL_STATIC_DRAW);
+	m->GenerateBuffers();
+}
+
+unsigned long long ModuleImport::GetMeshSettingsHash() const
+{
+	uint settings[9] = { MESH_FILE_VERSION, packedVertices, halfPositions, optimizeMeshes, optimizeOverdraw, generateLODs, (uint)lodLevels, 0u, encodeMeshes };
+	memcpy(&settings[7], &lodMaxError, sizeof(float));
 
-	delete buff;
+	return HashBytes(settings, sizeof(settings));
 }
 
 void ModuleImport::ImportTexture(const char* path)
@@ -306,12 +617,11 @@ void ModuleImport::ImportTexture(const char* path)
 	if (m == nullptr)
 	{
 		m = new ResourceTexture(path);
-		uint texture_id = 0;
-
-		RealLoadTexture(path, texture_id);
-		m->id = texture_id;
 
+		// Registered first, the load completions find it by handle
 		App->resources->AddResource(m);
+
+		RealLoadTexture(path, m);
 	}
 	else
 	{
@@ -321,13 +631,13 @@ void ModuleImport::ImportTexture(const char* path)
 	if (App->sceneIntro->current_object->HasComponent(CompTexture))
 	{
 		ComponentTexture* texture = (ComponentTexture*)App->sceneIntro->current_object->GetComponent(CompTexture);
-		App->resources->ResourceUsageDecreased(texture->RTexture);
+		App->resources->ResourceUsageDecreased(texture->GetTexture());
 		std::string tex_path(path);
 		
 		texture->path = tex_path.substr(tex_path.find_last_of("\\") + 1);
 		texture->path = texture->path.substr(0, texture->path.find_last_of("."));
 		texture->path = "Library\\Textures\\" + texture->path + ".dds";
-		texture->RTexture = m;
+		texture->SetTexture(m);
 		LOG("Texture loaded");
 	}
 	else
@@ -337,98 +647,114 @@ void ModuleImport::ImportTexture(const char* path)
 		texture->path = tex_path.substr(tex_path.find_last_of("\\") + 1);
 		texture->path = texture->path.substr(0, texture->path.find_last_of("."));
 		texture->path = "Library\\Textures\\" + texture->path + ".dds";
-		texture->RTexture = m;
+		texture->SetTexture(m);
 		LOG("Texture loaded");
 	}
 }
 
-void ModuleImport::RealLoadTexture(const char* path, uint &texture_id)
+bool ModuleImport::RealLoadTexture(const char* path, ResourceTexture* texture, float priority)
 {
-	ilInit();
-	iluInit();
-	ilutInit();
-	if (ilLoadImage(path))
-	{
-		ilEnable(IL_FILE_OVERWRITE);
+	// The path can be the source image or the Library file itself, then both times match
+	std::string libraryPath = App->resources->GetDirection(ResourceType::Texture, 0u, path);
+	unsigned long long sourceTime = App->resources->GetLastWriteTime(path);
+	unsigned long long libraryTime = App->resources->GetLastWriteTime(libraryPath.c_str());
 
-		ILuint size;
-		ILubyte *data;
-
-		ilSetInteger(IL_DXTC_FORMAT, IL_DXT5);
-		size = ilSaveL(IL_DDS, NULL, 0);
-		if (size > 0) {
-			data = new ILubyte[size];
-			if (ilSaveL(IL_DDS, data, size) > 0)
-				App->resources->SaveFile(size, (char*)data, ResourceType::Texture, 0u, path);
-			delete[] data;
+	if (libraryTime == 0 || libraryTime < sourceTime)
+	{
+		if (sourceTime == 0)
+		{
+			LOG("Couldn't load texture: %s", path);
+			return false;
 		}
 
-		uint id = 0;
-
-		ilGenImages(1, &id);
-		ilBindImage(id);
-		ilLoadImage(path);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-		texture_id = ilutGLBindTexImage();
-		glBindTexture(GL_TEXTURE_2D, 0);
-		ilDeleteImages(1, &id);
+		// Cooked on the workers, uploaded from Update when ready
+		cooker.Cook(path, texture);
+		return true;
 	}
-	else
+
+	if (App->renderer3D->nullBackend)
+		return true;
+
+	// Read on the I/O thread, uploaded when ModuleResources delivers it
+	ResourceLoader& loader = App->resources->loader;
+	loader.Cancel(texture->loadHandle);
+	ResourceHandle handle = texture->handle;
+	texture->loadHandle = loader.Request(libraryPath.c_str(), priority, nullptr, [this, handle](LoadRequest& request)
 	{
-		LOG("Couldn't load texture");
-	}
+		ResourceTexture* texture = App->resources->GetTexture(handle);
+		if (texture == nullptr)
+			return;
+
+		texture->loadHandle = 0u;
+
+		if (request.data == nullptr)
+		{
+			LOG("Couldn't read %s", request.path.c_str());
+		}
+		else
+			UploadTexture(request.data, request.size, texture);
+	});
+
+	return true;
 }
 
-void ModuleImport::ImportTexture(const char * path, GameObject * go)
+bool ModuleImport::UploadTexture(char* data, uint size, ResourceTexture* texture)
 {
-	ResourceTexture* m = (ResourceTexture*)App->resources->GetResource(ResourceType::Texture, path);
-	if (m == nullptr)
+	// Mip tail now, the rest over the next frames
+	if (streamer.Stream(texture, data, size))
+		return true;
+
+	// Uncompressed files, or drivers without S3TC: let DevIL decode it
+	std::lock_guard<std::mutex> lock(cooker.devilMutex);
+
+	uint id = 0;
+	ilGenImages(1, &id);
+	ilBindImage(id);
+	if (!ilLoadL(IL_DDS, data, size))
 	{
-		m = new ResourceTexture(path);
+		ilDeleteImages(1, &id);
+		return false;
+	}
 
-		ilInit();
-		iluInit();
-		ilutInit();
-		if (ilLoadImage(path))
-		{
-			ilEnable(IL_FILE_OVERWRITE);
+	GLStateCache& state = App->renderer3D->glState;
+	App->renderer3D->textureArrays.Remove(texture);
+	state.DeleteTexture(texture->id);
+	state.BindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
 
-			ILuint size;
-			ILubyte *data;
+	texture->id = ilutGLBindTexImage();
+	state.InvalidateTexture();
+	state.BindTexture(texture->id);
 
-			ilSetInteger(IL_DXTC_FORMAT, IL_DXT5);
-			size = ilSaveL(IL_DDS, NULL, 0);
-			if (size > 0) {
-				data = new ILubyte[size];
-				if (ilSaveL(IL_DDS, data, size) > 0)
-					App->resources->SaveFile(size, (char*)data, ResourceType::Texture, 0u, path);
-			}
+	texture->width = ilGetInteger(IL_IMAGE_WIDTH);
+	texture->height = ilGetInteger(IL_IMAGE_HEIGHT);
+	texture->mipLevels = 1u;
+	texture->residentLevel = 0u;
+	texture->gpuMemory = texture->width * texture->height * 4;
+	texture->compressed = false;
+	// DevIL picks the internal format, unknown to the texture arrays
+	texture->format = 0u;
 
-			uint texture_id = 0;
+	ilDeleteImages(1, &id);
 
-			uint id = 0;
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
 
-			ilGenImages(1, &id);
-			ilBindImage(id);
-			ilLoadImage(path);
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-			texture_id = ilutGLBindTexImage();
-			glBindTexture(GL_TEXTURE_2D, 0);
-			ilDeleteImages(1, &id);	
+	return true;
+}
 
-			m->id = texture_id;
+void ModuleImport::ImportTexture(const char * path, GameObject * go)
+{
+	ResourceTexture* m = (ResourceTexture*)App->resources->GetResource(ResourceType::Texture, path);
+	if (m == nullptr)
+	{
+		m = new ResourceTexture(path);
+		App->resources->AddResource(m);
 
-			App->resources->AddResource(m);
-		}
-		else
+		if (!RealLoadTexture(path, m))
 		{
-			LOG("Couldn't load texture: %s", path);
+			App->resources->ResourceUsageDecreased(m);
 			return;
 		}
 	}
@@ -440,10 +766,10 @@ void ModuleImport::ImportTexture(const char * path, GameObject * go)
 	if (go->HasComponent(CompTexture))
 	{
 		ComponentTexture* texture = (ComponentTexture*)go->GetComponent(CompTexture);
-		App->resources->ResourceUsageDecreased(texture->RTexture);
+		App->resources->ResourceUsageDecreased(texture->GetTexture());
 		std::string tex_path(path);
 		texture->path = tex_path;
-		texture->RTexture = m;
+		texture->SetTexture(m);
 		LOG("Texture loaded");
 	}
 	else
@@ -451,13 +777,17 @@ void ModuleImport::ImportTexture(const char * path, GameObject * go)
 		ComponentTexture* texture = new ComponentTexture(go);
 		std::string tex_path(path);
 		texture->path = tex_path;
-		texture->RTexture = m;
+		texture->SetTexture(m);
 		LOG("Texture loaded");
 	}
 }
 
 update_status ModuleImport::Update()
 {
+	models.Update();
+	cooker.Update();
+	streamer.Update();
+
 	return UPDATE_CONTINUE;
 }
 
@@ -466,6 +796,10 @@ bool ModuleImport::CleanUp()
 	// detach log stream
 	aiDetachAllLogStreams();
 
+	models.CleanUp();
+	cooker.CleanUp();
+	streamer.CleanUp();
+
 	return true;
 }
 
@@ -479,9 +813,9 @@ ResourceMesh* ModuleImport::MeshParShape(par_shapes_mesh* mesh, const char* name
 	{
 		m = new ResourceMesh(name);
 
-		m->vertex.size = mesh->npoints;
-		m->vertex.data = new float[m->vertex.size * 3];
-		memcpy(m->vertex.data, mesh->points, sizeof(float) * mesh->npoints * 3);
+		m->vertex.size = mesh->npoints * 3;
+		m->vertex.data = new float[m->vertex.size];
+		memcpy(m->vertex.data, mesh->points, sizeof(float) * m->vertex.size);
 
 		m->index.size = mesh->ntriangles * 3;
 		m->index.data = new uint[m->index.size];
@@ -491,13 +825,7 @@ ResourceMesh* ModuleImport::MeshParShape(par_shapes_mesh* mesh, const char* name
 			m->index.data[i] = (uint)mesh->triangles[i];
 		}
 
-		glGenBuffers(1, (GLuint*) &(m->vertex.id));
-		glBindBuffer(GL_ARRAY_BUFFER, m->vertex.id);
-		glBufferData(GL_ARRAY_BUFFER, sizeof(float) * 3 * m->vertex.size, m->vertex.data, GL_STATIC_DRAW);
-
-		glGenBuffers(1, (GLuint*) &(m->index.id));
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m->index.id);
-		glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(float) * m->index.size, m->index.data, GL_STATIC_DRAW);
+		UploadMesh(m);
 
 		App->resources->AddResource(m);
 	}
@@ -507,7 +835,7 @@ ResourceMesh* ModuleImport::MeshParShape(par_shapes_mesh* mesh, const char* name
 	}
 
 	ComponentMesh* newMesh = new ComponentMesh(go);
-	newMesh->mesh = m;
+	newMesh->SetMesh(m);
 
 	App->renderer3D->mesh_list.push_back(newMesh);
 
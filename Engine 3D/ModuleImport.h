@@ -2,14 +2,16 @@
 #include "Module.h"
 #include "Globals.h"
 #include <vector>
+#include <atomic>
 #include "GameObject.h"
 #include "ParShapes/par_shapes.h"
+#include "TextureCooker.h"
+#include "TextureStreamer.h"
+#include "ModelImporter.h"
 
 class ResourceMesh;
 class ResourceTexture;
-
-struct aiScene;
-struct aiNode;
+class MappedFile;
 
 class ModuleImport : public Module
 {
@@ -20,17 +22,41 @@ public:
 	bool Start();
 	update_status Update();
 
+	// Asynchronous, the model shows up a few frames later
 	void ImportFBX(const char* path);
 
-	GameObject* LoadMeshNode(const aiScene* scene, aiNode* node, GameObject* parent, const char* path);
+	// Encoded files are smaller but get decoded on every load instead of mapped, see MeshEncoding
+	void SaveMeshImporter(ResourceMesh* m, const uint &uuid, char* path = nullptr, bool encoded = false);
+
+	// Rewrites the Library file of a mesh in the other encoding, the streams have to be on the CPU
+	bool ReencodeMesh(ResourceMesh* m, bool encoded);
+
+	// Fills the CPU streams from a Library file, no GL calls and no logging so workers can use it.
+	// Raw version 2 and 3 files inside the given mapping are used in place and the mesh takes the mapping.
+	bool ReadMeshImporter(ResourceMesh* m, const char* buff, uint size, MappedFile** mapping = nullptr, bool* truncatedLODs = nullptr);
+
+	void LoadMeshImporter(ResourceMesh* m, const uint &uuid, char* buff, uint size);
+
+	void OptimizeMesh(ResourceMesh* m);
+
+	void GenerateLODs(ResourceMesh* m);
+
+	// CPU side of the upload (ACMR, vertex packing), safe on a worker
+	void PrepareMesh(ResourceMesh* m);
 
-	void SaveMeshImporter(ResourceMesh* m, const uint &uuid, char* path = nullptr);
+	void UploadMesh(ResourceMesh* m);
 
-	void LoadMeshImporter(ResourceMesh* m, const uint &uuid, char* buff);
+	// Everything that changes what a model import writes, part of the import database key
+	unsigned long long GetMeshSettingsHash() const;
 
 	void ImportTexture(const char* path);
 
-	void RealLoadTexture(const char* path, uint &texture_id);
+	// Queues the Library DDS on the resource loader when it's up to date, otherwise the source on the cooker.
+	// The texture gets its id once either is done, lower priorities load first
+	bool RealLoadTexture(const char* path, ResourceTexture* texture, float priority = 0.0f);
+
+	// Block compressed files go to the streamer, DevIL decodes the rest
+	bool UploadTexture(char* data, uint size, ResourceTexture* texture);
 
 	void ImportTexture(const char* path, GameObject* go);
 
@@ -41,5 +67,32 @@ public:
 public:
 
 	uint checkerImageID = 0u;
+
+	ModelImporter models;
+	TextureCooker cooker;
+	TextureStreamer streamer;
+
+	// Vertex layout for new GPU buffers
+	bool packedVertices = true;
+	bool halfPositions = false;
+
+	// Triangle and vertex reordering at import, baked into the Library file
+	bool optimizeMeshes = true;
+	bool optimizeOverdraw = true;
+
+	// Simplified levels generated at import, each one targets half the triangles of the previous
+	bool generateLODs = true;
+	int lodLevels = 3;
+	float lodMaxError = 0.05f;
+
+	// Library meshes written by imports get the compressed encoding
+	bool encodeMeshes = false;
+
+	// Library mesh sizes as the raw layout would be and as written, and decode timings
+	std::atomic<unsigned long long> meshBytesRaw = { 0ull };
+	std::atomic<unsigned long long> meshBytesWritten = { 0ull };
+	std::atomic<uint> meshesDecoded = { 0u };
+	std::atomic<unsigned long long> meshBytesDecoded = { 0ull };
+	std::atomic<unsigned long long> meshDecodeTicks = { 0ull };
 };
 
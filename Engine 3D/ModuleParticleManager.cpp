@@ -1,6 +1,27 @@
 #include "ModuleParticleManager.h"
 #include "Application.h"
 #include "ModuleTime.h"
+#include "Glew/include/glew.h"
+#include <algorithm>
+
+static uint PackColor(const float4& color)
+{
+	uint packed = 0u;
+	for (uint i = 0; i < 4; ++i)
+	{
+		float c = color[i] < 0.0f ? 0.0f : (color[i] > 1.0f ? 1.0f : color[i]);
+		packed |= (uint)(c * 255.0f + 0.5f) << (i * 8);
+	}
+
+	return packed;
+}
+
+// Unit quad as two triangles, same corners and uvs as ParticlePlane
+static const float quadCorners[6][2] =
+{
+	{ -0.5f, -0.5f }, { 0.5f, -0.5f }, { -0.5f, 0.5f },
+	{ 0.5f, -0.5f }, { 0.5f, 0.5f }, { -0.5f, 0.5f }
+};
 
 
 
@@ -15,7 +36,9 @@ ModuleParticleManager::~ModuleParticleManager()
 
 bool ModuleParticleManager::Start()
 {
-	plane = new ParticlePlane();
+	// Particles without a plane still simulate, they just don't draw
+	if (!App->renderer3D->nullBackend)
+		plane = new ParticlePlane();
 
 	return true;
 }
@@ -71,6 +94,14 @@ update_status ModuleParticleManager::Update()
 
 void ModuleParticleManager::Draw()
 {
+	batchDraws = 0u;
+
+	if (plane == nullptr)
+		return;
+
+	if (batchParticles && DrawBatched())
+		return;
+
 	for (int i = 0; i < MAX_PARTICLES; ++i)
 	{
 		if (particles[i].active)
@@ -80,6 +111,92 @@ void ModuleParticleManager::Draw()
 	}
 }
 
+bool ModuleParticleManager::DrawBatched()
+{
+	RingBuffer& ring = App->renderer3D->ringBuffer;
+	if (!ring.IsReady())
+		return false;
+
+	drawOrder.clear();
+	for (int i = 0; i < MAX_PARTICLES; ++i)
+	{
+		if (particles[i].active)
+			drawOrder.push_back(i);
+	}
+
+	if (drawOrder.empty())
+		return true;
+
+	// Group by texture, stable so each group keeps the emission order
+	std::stable_sort(drawOrder.begin(), drawOrder.end(), [this](int a, int b) { return *particles[a].texture < *particles[b].texture; });
+
+	RingAllocation range = ring.Allocate(sizeof(ParticleVertex) * 6 * drawOrder.size(), sizeof(ParticleVertex));
+	if (range.data == nullptr)
+		return false;
+
+	ParticleVertex* vertices = (ParticleVertex*)range.data;
+	for (uint i = 0; i < drawOrder.size(); ++i)
+	{
+		const Particle& particle = particles[drawOrder[i]];
+		float4x4 transform = particle.GetTransform();
+		uint color = PackColor(particle.color);
+
+		for (uint v = 0; v < 6; ++v)
+		{
+			ParticleVertex& vertex = vertices[i * 6 + v];
+			vertex.position = transform.TransformPos(float3(quadCorners[v][0], quadCorners[v][1], 0.0f));
+			vertex.uv = float2(quadCorners[v][0] + 0.5f, quadCorners[v][1] + 0.5f);
+			vertex.color = color;
+		}
+	}
+
+	ring.Commit(range);
+
+	GLStateCache& state = App->renderer3D->glState;
+
+	state.EnableClientState(GL_VERTEX_ARRAY);
+	state.EnableClientState(GL_COLOR_ARRAY);
+	state.BindBuffer(GL_ARRAY_BUFFER, ring.GetBuffer());
+	glVertexPointer(3, GL_FLOAT, sizeof(ParticleVertex), (void*)(range.offset + offsetof(ParticleVertex, position)));
+	glTexCoordPointer(2, GL_FLOAT, sizeof(ParticleVertex), (void*)(range.offset + offsetof(ParticleVertex, uv)));
+	glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(ParticleVertex), (void*)(range.offset + offsetof(ParticleVertex, color)));
+
+	uint start = 0u;
+	while (start < drawOrder.size())
+	{
+		ResourceTexture* texture = *particles[drawOrder[start]].texture;
+
+		uint end = start + 1;
+		while (end < drawOrder.size() && *particles[drawOrder[end]].texture == texture)
+			end++;
+
+		bool textured = texture != nullptr && App->resources->residency.Touch(texture) && texture->id != 0;
+		state.SetClientState(GL_TEXTURE_COORD_ARRAY, textured);
+		state.SetEnabled(GL_TEXTURE_2D, textured);
+		if (textured)
+		{
+			// Blending and alpha test stay on afterwards, same as the per-particle path
+			state.Enable(GL_BLEND);
+			state.BlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+			state.Enable(GL_ALPHA_TEST);
+			state.AlphaFunc(GL_GREATER, 0);
+			state.BindTexture(texture->id);
+		}
+
+		glDrawArrays(GL_TRIANGLES, start * 6, (end - start) * 6);
+		App->renderer3D->drawCalls++;
+		batchDraws++;
+
+		start = end;
+	}
+
+	// Meshes don't bind colors, the array must be off again
+	state.DisableClientState(GL_COLOR_ARRAY);
+	glColor4f(1.0f, 1.0f, 1.0f, 1.0f);
+
+	return true;
+}
+
 void ModuleParticleManager::StartEmitters()
 {
 	for (std::list<ComponentEmitter*>::iterator iterator = emitters.begin(); iterator != emitters.end(); ++iterator)
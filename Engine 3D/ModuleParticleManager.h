@@ -3,10 +3,18 @@
 #include "ComponentEmitter.h"
 #include "Particle.h"
 #include <list>
+#include <vector>
 #include "ParticlePlane.h"
 
 #define MAX_PARTICLES 10000
 
+struct ParticleVertex
+{
+	float3 position;
+	float2 uv;
+	uint color = 0u; // RGBA8
+};
+
 class ModuleParticleManager : public Module
 {
 public:
@@ -21,6 +29,9 @@ public:
 
 	void Draw();
 
+	// Every active particle as quads in the ring buffer, one draw per texture. False when the ring can't take them
+	bool DrawBatched();
+
 	void StartEmitters();
 
 	void ClearEmitters();
@@ -34,5 +45,14 @@ public:
 	
 	ParticlePlane* plane = nullptr;
 
+	bool batchParticles = true;
+
+	// Last frame: draws used for the batched particles
+	uint batchDraws = 0u;
+
 	ComponentEmitter* firework = nullptr;
+
+private:
+
+	std::vector<int> drawOrder;
 };
\ No newline at end of file
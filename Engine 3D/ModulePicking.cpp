@@ -50,23 +50,25 @@ update_status ModulePicking::Update()
 					LineSegment ray(picking);
 					ray.Transform((*it)->transform->GetMatrix().Inverted());
 
+					// Meshes that dropped their CPU copy miss this pick, they're back for the next one
 					ComponentMesh* mesh = (ComponentMesh*)(*it)->GetComponent(Object_Type::CompMesh);
-					if (mesh)
+					ResourceMesh* resource = mesh != nullptr ? mesh->GetMesh() : nullptr;
+					if (resource != nullptr && App->resources->residency.Touch(resource, true) && resource->index.data != nullptr)
 					{
 						Triangle triangle;
-						for (int i = 0; i < mesh->mesh->index.size / 3; ++i)
+						for (int i = 0; i < resource->index.size / 3; ++i)
 						{
-							triangle.a.x = mesh->mesh->vertex.data[mesh->mesh->index.data[i * 3] * 3];
-							triangle.a.y = mesh->mesh->vertex.data[mesh->mesh->index.data[i * 3] * 3 + 1];
-							triangle.a.z = mesh->mesh->vertex.data[mesh->mesh->index.data[i * 3] * 3 + 2];
+							triangle.a.x = resource->vertex.data[resource->index.data[i * 3] * 3];
+							triangle.a.y = resource->vertex.data[resource->index.data[i * 3] * 3 + 1];
+							triangle.a.z = resource->vertex.data[resource->index.data[i * 3] * 3 + 2];
 
-							triangle.b.x = mesh->mesh->vertex.data[mesh->mesh->index.data[i * 3 + 1] * 3];
-							triangle.b.y = mesh->mesh->vertex.data[mesh->mesh->index.data[i * 3 + 1] * 3 + 1];
-							triangle.b.z = mesh->mesh->vertex.data[mesh->mesh->index.data[i * 3 + 1] * 3 + 2];
+							triangle.b.x = resource->vertex.data[resource->index.data[i * 3 + 1] * 3];
+							triangle.b.y = resource->vertex.data[resource->index.data[i * 3 + 1] * 3 + 1];
+							triangle.b.z = resource->vertex.data[resource->index.data[i * 3 + 1] * 3 + 2];
 
-							triangle.c.x = mesh->mesh->vertex.data[mesh->mesh->index.data[i * 3 + 2] * 3];
-							triangle.c.y = mesh->mesh->vertex.data[mesh->mesh->index.data[i * 3 + 2] * 3 + 1];
-							triangle.c.z = mesh->mesh->vertex.data[mesh->mesh->index.data[i * 3 + 2] * 3 + 2];
+							triangle.c.x = resource->vertex.data[resource->index.data[i * 3 + 2] * 3];
+							triangle.c.y = resource->vertex.data[resource->index.data[i * 3 + 2] * 3 + 1];
+							triangle.c.z = resource->vertex.data[resource->index.data[i * 3 + 2] * 3 + 2];
 
 							float distance;
 							float3 position;
@@ -8,6 +8,7 @@
 #include "Primitive.h"
 #include "ModuleCamera3D.h"
 #include "ModuleSceneIntro.h"
+#include <algorithm>
 
 #include <gl/GL.h>
 
@@ -29,12 +30,28 @@ bool ModuleRenderer3D::Init()
 	LOG("Creating 3D Renderer context");
 	bool ret = true;
 
+	if (nullBackend)
+	{
+		// Camera and module code still query ImGui's io, a context without backends is enough
+		LOG("Null renderer: no GL context, draws only run culling and LOD selection");
+		vsync = false;
+		glState.nullBackend = true;
+		IMGUI_CHECKVERSION();
+		ImGui::CreateContext();
+		OnResize(SCREEN_WIDTH, SCREEN_HEIGHT);
+		return true;
+	}
+
 	//Create context
 	context = SDL_GL_CreateContext(App->window->window);
 	if(context == NULL)
 	{
 		LOG("OpenGL context could not be created! SDL_Error: %s\n", SDL_GetError());
-		ret = false;
+		if (App->headless)
+		{
+			LOG(HEADLESS_DISPLAY_ERROR);
+		}
+		return false;
 	}
 
 	GLenum err = glewInit();
@@ -55,7 +72,13 @@ bool ModuleRenderer3D::Init()
 	if(ret == true)
 	{
 		//Use Vsync
-		if(VSYNC && SDL_GL_SetSwapInterval(1) < 0)
+		if (App->headless)
+		{
+			vsync = false;
+			SDL_GL_SetSwapInterval(0);
+			CreateOffscreenTarget(SCREEN_WIDTH * SCREEN_SIZE, SCREEN_HEIGHT * SCREEN_SIZE);
+		}
+		else if(VSYNC && SDL_GL_SetSwapInterval(1) < 0)
 			LOG("Warning: Unable to set VSync! SDL Error: %s\n", SDL_GetError());
 
 		//Initialize Projection Matrix
@@ -99,6 +122,9 @@ bool ModuleRenderer3D::Init()
 		GLfloat LightModelAmbient[] = {0.0f, 0.0f, 0.0f, 1.0f};
 		glLightModelfv(GL_LIGHT_MODEL_AMBIENT, LightModelAmbient);
 		
+		for (uint i = 1; i < MAX_LIGHTS; ++i)
+			lights[i].ref = GL_LIGHT0 + i;
+
 		lights[0].ref = GL_LIGHT0;
 		lights[0].ambient.Set(0.25f, 0.25f, 0.25f, 1.0f);
 		lights[0].diffuse.Set(0.75f, 0.75f, 0.75f, 1.0f);
@@ -122,6 +148,13 @@ bool ModuleRenderer3D::Init()
 	// Projection matrix for
 	OnResize(SCREEN_WIDTH, SCREEN_HEIGHT);
 
+	if (ret)
+	{
+		ringBuffer.Init(RING_FRAME_SIZE);
+		if (indirect.Init())
+			textureArrays.Init();
+	}
+
 	IMGUI_CHECKVERSION();
 	ImGui::CreateContext();
 	ImGuiIO& io = ImGui::GetIO();
@@ -136,10 +169,18 @@ bool ModuleRenderer3D::Init()
 // PreUpdate: clear buffer
 update_status ModuleRenderer3D::PreUpdate()
 {
+	glState.BeginFrame();
+
 	if (Time::gameState != GameState::EDITOR)
 	{
 		current_cam->UpdateFrustum();	
 	}
+
+	if (nullBackend)
+		return UPDATE_CONTINUE;
+
+	ringBuffer.BeginFrame();
+
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
 	glMatrixMode(GL_PROJECTION);
@@ -153,8 +194,13 @@ update_status ModuleRenderer3D::PreUpdate()
 	// light 0 on cam pos
 	lights[0].SetPos(current_cam->frustum.pos.x, current_cam->frustum.pos.y, current_cam->frustum.pos.z);
 
+	AssignFixedLights();
+
 	for(uint i = 0; i < MAX_LIGHTS; ++i)
-		lights[i].Render();
+	{
+		if (lights[i].on)
+			lights[i].Render();
+	}
 
 	return UPDATE_CONTINUE;
 }
@@ -162,33 +208,47 @@ update_status ModuleRenderer3D::PreUpdate()
 // PostUpdate present buffer to screen
 update_status ModuleRenderer3D::PostUpdate()
 {
+	drawCalls = 0u;
+	trianglesDrawn = 0u;
+
+	std::vector<ComponentMesh*> visible;
+
 	if (culling && play_cam)
 	{
 		std::vector<GameObject*> toDraw;
 
 		App->sceneIntro->quadtree.QT_Intersect(toDraw, play_cam->frustum);
 
-
+		visible.reserve(toDraw.size());
 		for (std::vector<GameObject*>::iterator it = toDraw.begin(); it != toDraw.end(); ++it)
 		{
-			(*it)->GetComponent(CompMesh);
 			ComponentMesh* mesh = (ComponentMesh*) (*it)->GetComponent(CompMesh);
 
 			if (mesh != nullptr)
-				mesh->Draw();
+				visible.push_back(mesh);
 		}
-		toDraw.clear();
 	}
 	else
+		visible.assign(mesh_list.begin(), mesh_list.end());
+
+	//Geometry
+	if (useIndirect && indirect.IsSupported())
 	{
-		//Geometry
-		for (std::list<ComponentMesh*>::iterator it = mesh_list.begin(); it != mesh_list.end(); ++it)
-		{
-			(*it)->Draw();
-		}
+		if (clusteredLighting)
+			clusters.Update(light_list, current_cam);
 
+		float3 lightPosition(lights[0].position.x, lights[0].position.y, lights[0].position.z);
+		indirect.Draw(visible, current_cam, lightPosition, clusteredLighting ? &clusters : nullptr);
+	}
+	else
+	{
+		for (uint i = 0; i < visible.size(); ++i)
+			visible[i]->Draw();
 	}
 
+	for (uint i = 0; i < visible.size(); ++i)
+		visible[i]->DrawNormals();
+
 	//Debug Draw
 	if (App->input->GetKey(SDL_SCANCODE_F1) == KEY_DOWN)
 	{
@@ -205,167 +265,20 @@ update_status ModuleRenderer3D::PostUpdate()
 		culling = !culling;
 	}
 
-	bool wireframeMode = false;
-	GLint polygonMode[2];
-	glGetIntegerv(GL_POLYGON_MODE, polygonMode);
-
-	if (polygonMode[0] == GL_LINE && polygonMode[1] == GL_LINE)
-		wireframeMode = true;
-
-	bool cullFace = glIsEnabled(GL_CULL_FACE);
-
-	glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
-	glDisable(GL_CULL_FACE);
-
 	if (drawBoxes)
 	{
 		for (auto gameobject : App->game_object->gameObjects)
-		{
-			float3 corners[8];
-			gameobject->boundingBox.GetCornerPoints(corners);
-
-			glLineWidth(2.0f);
-
-			if (gameobject == App->sceneIntro->current_object)
-				glColor3f(0.0f, 1.0f, 0.0f);
-
-			else
-				glColor3f(0.0f, 0.0f, 1.0f);
-
-			glBegin(GL_QUADS);
-
-			glVertex3fv((GLfloat*)&corners[1]);
-			glVertex3fv((GLfloat*)&corners[5]);
-			glVertex3fv((GLfloat*)&corners[7]);
-			glVertex3fv((GLfloat*)&corners[3]);
-								
-			glVertex3fv((GLfloat*)&corners[4]);
-			glVertex3fv((GLfloat*)&corners[0]);
-			glVertex3fv((GLfloat*)&corners[2]);
-			glVertex3fv((GLfloat*)&corners[6]);
-								
-			glVertex3fv((GLfloat*)&corners[5]);
-			glVertex3fv((GLfloat*)&corners[4]);
-			glVertex3fv((GLfloat*)&corners[6]);
-			glVertex3fv((GLfloat*)&corners[7]);
-								
-			glVertex3fv((GLfloat*)&corners[0]);
-			glVertex3fv((GLfloat*)&corners[1]);
-			glVertex3fv((GLfloat*)&corners[3]);
-			glVertex3fv((GLfloat*)&corners[2]);
-
-			glVertex3fv((GLfloat*)&corners[3]);
-			glVertex3fv((GLfloat*)&corners[7]);
-			glVertex3fv((GLfloat*)&corners[6]);
-			glVertex3fv((GLfloat*)&corners[2]);
-
-			glVertex3fv((GLfloat*)&corners[0]);
-			glVertex3fv((GLfloat*)&corners[4]);
-			glVertex3fv((GLfloat*)&corners[5]);
-			glVertex3fv((GLfloat*)&corners[1]);
-
-			glEnd();
-		}
+			App->debugDraw->DrawAABB(gameobject->boundingBox, gameobject == App->sceneIntro->current_object ? Green : Blue);
 
 		std::vector<math::AABB> vecquad;
 		App->sceneIntro->quadtree.QT_GetBoxes(vecquad);
-		glLineWidth(2.0f);
-
-		glColor3f(0.0f, 1.0f, 0.0f);
-
-		glBegin(GL_QUADS);
 
 		for (int i = 0; i < vecquad.size(); ++i)
-		{
-		
-			float3 corners_quadtree[8];
-			vecquad[i].GetCornerPoints(corners_quadtree);
-
-			glVertex3fv((GLfloat*)&corners_quadtree[1]);
-			glVertex3fv((GLfloat*)&corners_quadtree[5]);
-			glVertex3fv((GLfloat*)&corners_quadtree[7]);
-			glVertex3fv((GLfloat*)&corners_quadtree[3]);
-
-			glVertex3fv((GLfloat*)&corners_quadtree[4]);
-			glVertex3fv((GLfloat*)&corners_quadtree[0]);
-			glVertex3fv((GLfloat*)&corners_quadtree[2]);
-			glVertex3fv((GLfloat*)&corners_quadtree[6]);
-
-			glVertex3fv((GLfloat*)&corners_quadtree[5]);
-			glVertex3fv((GLfloat*)&corners_quadtree[4]);
-			glVertex3fv((GLfloat*)&corners_quadtree[6]);
-			glVertex3fv((GLfloat*)&corners_quadtree[7]);
-
-			glVertex3fv((GLfloat*)&corners_quadtree[0]);
-			glVertex3fv((GLfloat*)&corners_quadtree[1]);
-			glVertex3fv((GLfloat*)&corners_quadtree[3]);
-			glVertex3fv((GLfloat*)&corners_quadtree[2]);
-
-			glVertex3fv((GLfloat*)&corners_quadtree[3]);
-			glVertex3fv((GLfloat*)&corners_quadtree[7]);
-			glVertex3fv((GLfloat*)&corners_quadtree[6]);
-			glVertex3fv((GLfloat*)&corners_quadtree[2]);
-
-			glVertex3fv((GLfloat*)&corners_quadtree[0]);
-			glVertex3fv((GLfloat*)&corners_quadtree[4]);
-			glVertex3fv((GLfloat*)&corners_quadtree[5]);
-			glVertex3fv((GLfloat*)&corners_quadtree[1]);
-
-			
-		}
-		glEnd();
+			App->debugDraw->DrawAABB(vecquad[i], Green);
 	}
-
-	else
-	{
-		if (App->sceneIntro->current_object)
-		{
-			if (App->sceneIntro->current_object->active)
-			{
-				float3 corners[8];
-				App->sceneIntro->current_object->boundingBox.GetCornerPoints(corners);
-
-				glLineWidth(2.0f);
-				glColor3f(0.0f, 1.0f, 0.0f);
-				glBegin(GL_QUADS);
-
-				glVertex3fv((GLfloat*)&corners[1]);
-				glVertex3fv((GLfloat*)&corners[5]);
-				glVertex3fv((GLfloat*)&corners[7]);
-				glVertex3fv((GLfloat*)&corners[3]);
-
-				glVertex3fv((GLfloat*)&corners[4]);
-				glVertex3fv((GLfloat*)&corners[0]);
-				glVertex3fv((GLfloat*)&corners[2]);
-				glVertex3fv((GLfloat*)&corners[6]);
-
-				glVertex3fv((GLfloat*)&corners[5]);
-				glVertex3fv((GLfloat*)&corners[4]);
-				glVertex3fv((GLfloat*)&corners[6]);
-				glVertex3fv((GLfloat*)&corners[7]);
-
-				glVertex3fv((GLfloat*)&corners[0]);
-				glVertex3fv((GLfloat*)&corners[1]);
-				glVertex3fv((GLfloat*)&corners[3]);
-				glVertex3fv((GLfloat*)&corners[2]);
-
-				glVertex3fv((GLfloat*)&corners[3]);
-				glVertex3fv((GLfloat*)&corners[7]);
-				glVertex3fv((GLfloat*)&corners[6]);
-				glVertex3fv((GLfloat*)&corners[2]);
-
-				glVertex3fv((GLfloat*)&corners[0]);
-				glVertex3fv((GLfloat*)&corners[4]);
-				glVertex3fv((GLfloat*)&corners[5]);
-				glVertex3fv((GLfloat*)&corners[1]);
-
-				glEnd();
-			}
-		}
-	}
-
-	if (drawTree)
+	else if (App->sceneIntro->current_object && App->sceneIntro->current_object->active)
 	{
+		App->debugDraw->DrawAABB(App->sceneIntro->current_object->boundingBox, Green);
 	}
 
 	if (App->sceneIntro->current_object)
@@ -376,64 +289,28 @@ update_status ModuleRenderer3D::PostUpdate()
 			if (cam)
 			{
 				cam->UpdateFrustum();
-				float3 corners[8];
-				cam->frustum.GetCornerPoints(corners);
-
-				glLineWidth(2.0f);
-				glColor3f(0.0f, 1.0f, 0.0f);
-				glBegin(GL_QUADS);
-
-				glVertex3fv((GLfloat*)&corners[1]);
-				glVertex3fv((GLfloat*)&corners[5]);
-				glVertex3fv((GLfloat*)&corners[7]);
-				glVertex3fv((GLfloat*)&corners[3]);
-
-				glVertex3fv((GLfloat*)&corners[4]);
-				glVertex3fv((GLfloat*)&corners[0]);
-				glVertex3fv((GLfloat*)&corners[2]);
-				glVertex3fv((GLfloat*)&corners[6]);
-
-				glVertex3fv((GLfloat*)&corners[5]);
-				glVertex3fv((GLfloat*)&corners[4]);
-				glVertex3fv((GLfloat*)&corners[6]);
-				glVertex3fv((GLfloat*)&corners[7]);
-
-				glVertex3fv((GLfloat*)&corners[0]);
-				glVertex3fv((GLfloat*)&corners[1]);
-				glVertex3fv((GLfloat*)&corners[3]);
-				glVertex3fv((GLfloat*)&corners[2]);
-
-				glVertex3fv((GLfloat*)&corners[3]);
-				glVertex3fv((GLfloat*)&corners[7]);
-				glVertex3fv((GLfloat*)&corners[6]);
-				glVertex3fv((GLfloat*)&corners[2]);
-
-				glVertex3fv((GLfloat*)&corners[0]);
-				glVertex3fv((GLfloat*)&corners[4]);
-				glVertex3fv((GLfloat*)&corners[5]);
-				glVertex3fv((GLfloat*)&corners[1]);
-
-				glEnd();
+				App->debugDraw->DrawFrustum(cam->frustum, Green);
 			}
 		}
 	}
 
-	if (wireframeMode)
-	{
-		glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
-	}
-	else
-		glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+	App->debugDraw->Flush();
 
-	if (cullFace)
-		glEnable(GL_CULL_FACE);
+	if (nullBackend)
+		return UPDATE_CONTINUE;
 
 	//UI
-	App->imgui->Draw();
+	if (App->imgui->IsEnabled())
+		App->imgui->Draw();
 
+	ringBuffer.EndFrame();
 
+	// Nothing to present offscreen, wait for the GPU so frame timings include it
+	if (offscreenFramebuffer != 0)
+		glFinish();
+	else
+		SDL_GL_SwapWindow(App->window->window);
 
-	SDL_GL_SwapWindow(App->window->window);
 	return UPDATE_CONTINUE;
 }
 
@@ -462,19 +339,109 @@ bool ModuleRenderer3D::CleanUp()
 {
 	LOG("Destroying 3D Renderer");
 
+	if (nullBackend)
+	{
+		ImGui::DestroyContext();
+		return true;
+	}
+
+	textureArrays.CleanUp();
+	indirect.CleanUp();
+	ringBuffer.CleanUp();
+
+	if (offscreenFramebuffer != 0)
+	{
+		glDeleteFramebuffers(1, (GLuint*)&offscreenFramebuffer);
+		glDeleteRenderbuffers(1, (GLuint*)&offscreenColor);
+		glDeleteRenderbuffers(1, (GLuint*)&offscreenDepth);
+	}
+
 	SDL_GL_DeleteContext(context);
 
 	return true;
 }
 
 
-void ModuleRenderer3D::OnResize(int width, int height)
+bool ModuleRenderer3D::CreateOffscreenTarget(int width, int height)
 {
-	glViewport(0, 0, width, height);
+	glGenRenderbuffers(1, (GLuint*)&offscreenColor);
+	glBindRenderbuffer(GL_RENDERBUFFER, offscreenColor);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+
+	glGenRenderbuffers(1, (GLuint*)&offscreenDepth);
+	glBindRenderbuffer(GL_RENDERBUFFER, offscreenDepth);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	glGenFramebuffers(1, (GLuint*)&offscreenFramebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, offscreenFramebuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, offscreenColor);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, offscreenDepth);
+
+	// Stays bound for the whole run, the hidden window's backbuffer is never used
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+	{
+		LOG("Offscreen framebuffer incomplete, rendering to the hidden window instead");
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		glDeleteFramebuffers(1, (GLuint*)&offscreenFramebuffer);
+		glDeleteRenderbuffers(1, (GLuint*)&offscreenColor);
+		glDeleteRenderbuffers(1, (GLuint*)&offscreenDepth);
+		offscreenFramebuffer = offscreenColor = offscreenDepth = 0u;
+		return false;
+	}
 
+	return true;
+}
+
+void ModuleRenderer3D::AssignFixedLights()
+{
+	std::vector<std::pair<float, ComponentLight*>> nearest;
+	nearest.reserve(light_list.size());
+
+	for (std::list<ComponentLight*>::iterator it = light_list.begin(); it != light_list.end(); ++it)
+	{
+		if ((*it)->gameObject->active && (*it)->intensity > 0.0f)
+			nearest.push_back(std::pair<float, ComponentLight*>((*it)->GetPosition().DistanceSq(current_cam->frustum.pos), *it));
+	}
+
+	uint slots = MAX_LIGHTS - 1;
+	uint count = nearest.size() < slots ? nearest.size() : slots;
+	std::partial_sort(nearest.begin(), nearest.begin() + count, nearest.end());
+
+	for (uint i = 0; i < slots; ++i)
+	{
+		Light& light = lights[i + 1];
+		if (i >= count)
+		{
+			light.Active(false);
+			continue;
+		}
+
+		ComponentLight* component = nearest[i].second;
+		float3 position = component->GetPosition();
+		float3 color = component->color * component->intensity;
+
+		light.SetPos(position.x, position.y, position.z);
+		light.ambient.Set(0.0f, 0.0f, 0.0f, 1.0f);
+		light.diffuse.Set(color.x, color.y, color.z, 1.0f);
+
+		// Down to about 4% at the range, the clustered falloff reaches zero there
+		light.quadraticAttenuation = 25.0f / (component->range * component->range);
+		light.Init();
+		light.Active(true);
+	}
+}
+
+void ModuleRenderer3D::OnResize(int width, int height)
+{
 	App->window->width = width;
 	App->window->height = height;
 
+	if (nullBackend)
+		return;
+
+	glViewport(0, 0, width, height);
+
 	glMatrixMode(GL_PROJECTION);
 	glLoadIdentity();
 	ProjectionMatrix = perspective(60.0f, (float)width / (float)height, 0.125f, 512.0f);
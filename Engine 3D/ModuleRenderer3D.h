@@ -7,9 +7,18 @@
 #include <vector>
 #include "ComponentMesh.h"
 #include "ComponentCamera.h"
+#include "GLStateCache.h"
+#include "IndirectRenderer.h"
+#include "RingBuffer.h"
+#include "LightClusters.h"
+#include "TextureArrays.h"
+#include "ComponentLight.h"
 
 #define MAX_LIGHTS 8
 
+// Bytes of dynamic data per frame in the ring buffer
+#define RING_FRAME_SIZE (4 * 1024 * 1024)
+
 class Mesh;
 
 class ModuleRenderer3D : public Module
@@ -26,6 +35,12 @@ public:
 
 	void OnResize(int width, int height);
 
+	// Nearest scene lights to the camera on the fixed function slots after light 0
+	void AssignFixedLights();
+
+	// Color and depth renderbuffers for headless runs
+	bool CreateOffscreenTarget(int width, int height);
+
 public:
 
 	Light lights[MAX_LIGHTS];
@@ -35,6 +50,26 @@ public:
 
 	std::list<ComponentMesh*> mesh_list;
 
+	std::list<ComponentLight*> light_list;
+
+	// Per-cluster light lists for the indirect path's shader
+	LightClusters clusters;
+	bool clusteredLighting = true;
+
+	// All engine state changes go through here
+	GLStateCache glState;
+
+	// Multi-draw indirect path, per-mesh draws are the fallback when it isn't supported
+	IndirectRenderer indirect;
+	bool useIndirect = true;
+
+	// Same sized textures share GL_TEXTURE_2D_ARRAY layers so the indirect path binds them once
+	TextureArrays textureArrays;
+	bool useTextureArrays = true;
+
+	// Per-frame dynamic data: debug lines, particles, indirect commands and draw data
+	RingBuffer ringBuffer;
+
 	bool vsync = true;
 
 	bool drawBoxes = false;
@@ -45,7 +80,23 @@ public:
 
 	bool paintTextures = true;
 
+	// Distance based level of detail, bias scales the projected size before picking a level
+	bool useLODs = true;
+	float lodBias = 1.0f;
+	float lodHysteresis = 0.1f;
+
+	// Geometry submitted by the last frame
+	uint drawCalls = 0u;
+	uint trianglesDrawn = 0u;
+
 	ComponentCamera* current_cam = nullptr;
 
 	ComponentCamera* play_cam = nullptr;
+
+	// Set from the command line before Init: no context and no GL calls, the simulation still runs
+	bool nullBackend = false;
+
+	uint offscreenFramebuffer = 0u;
+	uint offscreenColor = 0u;
+	uint offscreenDepth = 0u;
 };
\ No newline at end of file
@@ -1,4 +1,7 @@
 #include "ModuleResources.h"
+#include "ResourceMesh.h"
+#include "ResourceTexture.h"
+#include "Hash.h"
 #include <fstream>
 #include <iostream>
 using namespace std;
@@ -19,6 +22,34 @@ bool ModuleResources::Init()
 	CreateDirectory("Library/Models", NULL);
 	CreateDirectory("Library/Textures", NULL);
 
+	vfs.Init();
+	importDB.Load();
+	loader.Init();
+
+	return true;
+}
+
+update_status ModuleResources::Update()
+{
+	loader.Update();
+	residency.Update(slots);
+
+	if (importDB.IsDirty())
+		importDB.Save();
+
+	return UPDATE_CONTINUE;
+}
+
+bool ModuleResources::CleanUp()
+{
+	loader.CleanUp();
+
+	if (importDB.IsDirty())
+		importDB.Save();
+
+	// Import and the scene are gone by now, nothing reads Library anymore
+	vfs.CleanUp(packOnExit);
+
 	return true;
 }
 
@@ -32,32 +63,31 @@ void ModuleResources::SaveFile(uint size, char* output_file, ResourceType type,
 	{
 		file.write(output_file, size);
 		file.close();
+
+		// Scenes live in Assets, they never go in the archive
+		if (type == ResourceType::Mesh || type == ResourceType::Texture)
+			vfs.AddLooseFile(direction.c_str());
 	}
 }
 
-char* ModuleResources::LoadFile(const char* path, ResourceType type, uint uuid)
+char* ModuleResources::LoadFile(const char* path, ResourceType type, uint uuid, uint* size)
 {
 	string direction = GetDirection(type, uuid, path);
 
-	ifstream loadFile(direction.c_str(), ios::out | ios::binary);
-
-	char* ret = nullptr;
-
-	if (loadFile.is_open())
-	{
-		loadFile.seekg(0, loadFile.end);
-		uint size = loadFile.tellg();
-
-		ret = new char[size];
-
-		loadFile.seekg(0, loadFile.beg);
+	return vfs.Read(direction.c_str(), size);
+}
 
-		loadFile.read(ret, size);
+unsigned long long ModuleResources::GetLastWriteTime(const char* file)
+{
+	unsigned long long archived = vfs.GetArchivedTime(file);
+	if (archived != 0)
+		return archived;
 
-		loadFile.close();
-	}
+	WIN32_FILE_ATTRIBUTE_DATA attributes;
+	if (!GetFileAttributesEx(file, GetFileExInfoStandard, &attributes))
+		return 0ull;
 
-	return ret;
+	return ((unsigned long long)attributes.ftLastWriteTime.dwHighDateTime << 32) | attributes.ftLastWriteTime.dwLowDateTime;
 }
 
 string ModuleResources::GetDirection(ResourceType type, uint uuid, const char* path)
@@ -99,28 +129,111 @@ string ModuleResources::GetDirection(ResourceType type, uint uuid, const char* p
 	return filePath;
 }
 
+unsigned long long ModuleResources::GetPathKey(ResourceType type, const char* path) const
+{
+	return HashBytes(path, strlen(path), (unsigned long long)type);
+}
+
 Resource* ModuleResources::GetResource(ResourceType type, const char* path)
 {
-	for (std::list<Resource*>::iterator it = resources.begin(); it != resources.end(); ++it)
-	{
-		if ((*it)->type == type)
-		{
-			if (strcmp((*it)->name.c_str(), path) == 0)
-				return *it;
-		}
-	}
-	return nullptr;
+	lookups++;
+
+	std::unordered_map<unsigned long long, uint>::const_iterator it = pathIndex.find(GetPathKey(type, path));
+	if (it == pathIndex.end())
+		return nullptr;
+
+	// A 64 bit collision would be a different path, don't hand it out
+	Resource* resource = slots[it->second].resource;
+	return resource->type == type && resource->name == path ? resource : nullptr;
+}
+
+Resource* ModuleResources::GetResourceByUUID(uint uuid)
+{
+	lookups++;
+
+	std::unordered_map<uint, uint>::const_iterator it = uuidIndex.find(uuid);
+	return it != uuidIndex.end() ? slots[it->second].resource : nullptr;
+}
+
+Resource* ModuleResources::Get(ResourceHandle handle) const
+{
+	if (handle.index >= slots.size() || slots[handle.index].generation != handle.generation)
+		return nullptr;
+
+	return slots[handle.index].resource;
+}
+
+ResourceMesh* ModuleResources::GetMesh(ResourceHandle handle) const
+{
+	Resource* resource = Get(handle);
+	return resource != nullptr && resource->type == ResourceType::Mesh ? (ResourceMesh*)resource : nullptr;
+}
+
+ResourceTexture* ModuleResources::GetTexture(ResourceHandle handle) const
+{
+	Resource* resource = Get(handle);
+	return resource != nullptr && resource->type == ResourceType::Texture ? (ResourceTexture*)resource : nullptr;
 }
 
-void ModuleResources::AddResource(Resource* resource)
+ResourceHandle ModuleResources::AddResource(Resource* resource)
 {
-	for (std::list<Resource*>::iterator it = resources.begin(); it != resources.end(); ++it)
+	if (Get(resource->handle) == resource)
+		return resource->handle;
+
+	uint index = 0u;
+	if (!freeSlots.empty())
+	{
+		index = freeSlots.back();
+		freeSlots.pop_back();
+	}
+	else
 	{
-		if (&resource == &*it)
-			return;
+		index = slots.size();
+		slots.push_back(ResourceSlot());
 	}
-	resources.push_back(resource);
+
+	slots[index].resource = resource;
+	resource->handle.index = index;
+	resource->handle.generation = slots[index].generation;
+
+	// Counts as used now, a resource nobody drew yet isn't the first thing to evict
+	resource->lastVisibleFrame = residency.GetFrame();
+
+	pathIndex.insert(std::make_pair(GetPathKey(resource->type, resource->name.c_str()), index));
+	if (resource->uuid != 0)
+		uuidIndex.insert(std::make_pair(resource->uuid, index));
+
 	ResourceUsageIncreased(resource);
+
+	return resource->handle;
+}
+
+void ModuleResources::RemoveResource(Resource* resource)
+{
+	uint index = resource->handle.index;
+	if (Get(resource->handle) != resource)
+		return;
+
+	std::unordered_map<unsigned long long, uint>::iterator path = pathIndex.find(GetPathKey(resource->type, resource->name.c_str()));
+	if (path != pathIndex.end() && path->second == index)
+		pathIndex.erase(path);
+
+	std::unordered_map<uint, uint>::iterator uuid = uuidIndex.find(resource->uuid);
+	if (uuid != uuidIndex.end() && uuid->second == index)
+		uuidIndex.erase(uuid);
+
+	// Outstanding handles to the slot go stale
+	slots[index].resource = nullptr;
+	if (++slots[index].generation == 0u)
+		slots[index].generation = 1u;
+	freeSlots.push_back(index);
+
+	resource->handle = ResourceHandle();
+}
+
+uint ModuleResources::GetResourceCount() const
+{
+	return slots.size() - freeSlots.size();
 }
 
 void ModuleResources::ResourceUsageIncreased(Resource* resource)
@@ -130,11 +243,14 @@ void ModuleResources::ResourceUsageIncreased(Resource* resource)
 
 void ModuleResources::ResourceUsageDecreased(Resource* resource)
 {
+	if (resource == nullptr)
+		return;
+
 	resource->usage--;
 	if (resource->usage <= 0)
 	{
 		///resource->Unload();
-		resources.remove(resource);
+		RemoveResource(resource);
 		delete resource;
 	}
 }
\ No newline at end of file
@@ -3,7 +3,15 @@
 #include <string>
 #include "ComponentTexture.h"
 #include "Resource.h"
-#include <list>
+#include "ResourceLoader.h"
+#include "ImportDatabase.h"
+#include "ResidencyManager.h"
+#include "VirtualFileSystem.h"
+#include <vector>
+#include <unordered_map>
+
+class ResourceMesh;
+class ResourceTexture;
 
 class ModuleResources : public Module
 {
@@ -13,21 +21,68 @@ public:
 
 	bool Init();
 
+	update_status Update();
+
+	bool CleanUp();
+
 	void SaveFile(uint size, char* output_file, ResourceType type, uint uuid, const char* path = nullptr);
 
-	char* LoadFile(const char* path, ResourceType type, uint uuid);
+	char* LoadFile(const char* path, ResourceType type, uint uuid, uint* size = nullptr);
+
+	// 0 when the file doesn't exist, packed Library files answer with the time they were packed with
+	unsigned long long GetLastWriteTime(const char* file);
 
 	std::string GetDirection(ResourceType type, uint uuid, const char* path = nullptr);
 
+	// O(1) through the (type, path hash) index
 	Resource* GetResource(ResourceType type, const char* path);
 
-	void AddResource(Resource* resource);
+	Resource* GetResourceByUUID(uint uuid);
+
+	// nullptr once the resource was released, or when it isn't of that type
+	Resource* Get(ResourceHandle handle) const;
+	ResourceMesh* GetMesh(ResourceHandle handle) const;
+	ResourceTexture* GetTexture(ResourceHandle handle) const;
+
+	// Registers the resource and takes the first usage, adding a registered one again does nothing
+	ResourceHandle AddResource(Resource* resource);
 
 	void ResourceUsageIncreased(Resource* resource);
 
 	void ResourceUsageDecreased(Resource* resource);
 
+	uint GetResourceCount() const;
+
+private:
+
+	unsigned long long GetPathKey(ResourceType type, const char* path) const;
+
+	void RemoveResource(Resource* resource);
+
 public:
-	
-	std::list<Resource*> resources;
+
+	// Lookups since start, the index makes them cheap but import and scene load do thousands
+	uint lookups = 0u;
+
+	// Library reads resolve through the packed archive, loose files override it
+	VirtualFileSystem vfs;
+	bool packOnExit = true;
+
+	// Asynchronous reads for scene loads, completions arrive in Update
+	ResourceLoader loader;
+
+	// What each source asset was imported into, saved whenever it changes
+	ImportDatabase importDB;
+
+	// Keeps CPU and GPU memory under budget by evicting what wasn't drawn lately
+	ResidencyManager residency;
+
+private:
+
+	std::vector<ResourceSlot> slots;
+	std::vector<uint> freeSlots;
+
+	// The first resource registered under a path/uuid owns the entry, later ones are only reachable by handle
+	std::unordered_map<unsigned long long, uint> pathIndex;
+	std::unordered_map<uint, uint> uuidIndex;
 };
\ No newline at end of file
@@ -22,7 +22,7 @@ bool ModuleSceneIntro::Start()
 	bool ret = true;
 
 	ImGuizmo::Enable(true);
-	quadtree.QT_Create(AABB(float3(-60, -5, -60), float3(60, 10, 60)));
+	quadtree.QT_Create(quadtreeBounds);
 	return ret;
 }
 
@@ -54,7 +54,8 @@ update_status ModuleSceneIntro::Update()
 		guiz_operation = ImGuizmo::ROTATE;
 	}
 
-	if (current_object)
+	// The gizmo needs an ImGui frame
+	if (current_object && App->imgui->IsEnabled())
 	{
 		float4x4 transformGlobal = current_object->transform->GetMatrix();
 		transformGlobal.Transpose();
@@ -94,19 +95,13 @@ update_status ModuleSceneIntro::Update()
 		}
 	}
 
-
-
-	PrimitivePlane p(0, 1, 0, 0);
-	p.axis = true;
-	p.Render();
-	
 	return UPDATE_CONTINUE;
 }
 
 void ModuleSceneIntro::ReDoQuadtree()
 {
 
-	quadtree.QT_Create(AABB(float3(-60, -5, -60), float3(60, 10, 60)));
+	quadtree.QT_Create(quadtreeBounds);
 
 	for (std::list<GameObject*>::const_iterator iterator = App->game_object->gameObjects.begin(); iterator != App->game_object->gameObjects.end(); ++iterator)
 	{
@@ -5,6 +5,8 @@
 #include "QuadTree.h"
 #include "ImGuizmo/ImGuizmo.h"
 
+#define QUADTREE_DEFAULT_BOUNDS AABB(float3(-60, -5, -60), float3(60, 10, 60))
+
 struct PhysMotor3D;
 
 class ModuleSceneIntro : public Module
@@ -23,6 +25,9 @@ public:
 
 	Quad_Tree quadtree;
 
+	// Streamed worlds span it to their own bounds
+	AABB quadtreeBounds = QUADTREE_DEFAULT_BOUNDS;
+
 	ImGuizmo::OPERATION guiz_operation = ImGuizmo::BOUNDS;
 
 	ImGuizmo::MODE guiz_mode = ImGuizmo::WORLD;
@@ -21,7 +21,7 @@ bool Time::Start()
 
 update_status Time::PreUpdate()
 {
-	float realDT = (float)timer.Read() / 1000.f;
+	float realDT = fixedDT > 0.0f ? fixedDT : (float)timer.Read() / 1000.f;
 
 	timer.Start();
 
@@ -22,6 +22,9 @@ public:
 
 	static float dt;
 
+	// When set, every frame advances the simulation by this instead of the real frame time
+	float fixedDT = 0.0f;
+
 	Timer timer;
 
 	static GameState gameState;
@@ -21,9 +21,22 @@ bool ModuleWindow::Init()
 	LOG("Init SDL window & surface");
 	bool ret = true;
 
+	if (App->renderer3D->nullBackend)
+	{
+		// Timers and events still work without the video subsystem
+		LOG("Null renderer, no window created");
+		width = SCREEN_WIDTH * SCREEN_SIZE;
+		height = SCREEN_HEIGHT * SCREEN_SIZE;
+		return SDL_Init(SDL_INIT_TIMER | SDL_INIT_EVENTS) == 0;
+	}
+
 	if(SDL_Init(SDL_INIT_VIDEO) < 0)
 	{
 		LOG("SDL_VIDEO could not initialize! SDL_Error: %s\n", SDL_GetError());
+		if (App->headless)
+		{
+			LOG(HEADLESS_DISPLAY_ERROR);
+		}
 		ret = false;
 	}
 	else
@@ -31,7 +44,9 @@ bool ModuleWindow::Init()
 		//Create window
 		int width = SCREEN_WIDTH * SCREEN_SIZE;
 		int height = SCREEN_HEIGHT * SCREEN_SIZE;
-		Uint32 flags = SDL_WINDOW_OPENGL | SDL_WINDOW_SHOWN;
+		// Headless runs still need a window for the context, it's never shown and rendering goes to an FBO.
+		// There's no surfaceless context here, a machine without a display has to use the null renderer.
+		Uint32 flags = SDL_WINDOW_OPENGL | (App->headless ? SDL_WINDOW_HIDDEN : SDL_WINDOW_SHOWN);
 
 		//Use OpenGL 2.1
 		/*SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
@@ -69,6 +84,10 @@ bool ModuleWindow::Init()
 		if(window == NULL)
 		{
 			LOG("Window could not be created! SDL_Error: %s\n", SDL_GetError());
+			if (App->headless)
+			{
+				LOG(HEADLESS_DISPLAY_ERROR);
+			}
 			ret = false;
 		}
 		else
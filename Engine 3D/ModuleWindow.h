@@ -4,6 +4,8 @@
 #include "Module.h"
 #include "SDL/include/SDL.h"
 
+#define HEADLESS_DISPLAY_ERROR "Headless rendering needs a display for its hidden window and GL context, run with -nullrenderer where there is none"
+
 class Application;
 
 class ModuleWindow : public Module
@@ -0,0 +1,210 @@
+#include "PackArchive.h"
+#include "Compression.h"
+#include "Hash.h"
+#include <fstream>
+#include <algorithm>
+
+PackArchive::PackArchive()
+{
+}
+
+PackArchive::~PackArchive()
+{
+}
+
+bool PackArchive::Open(const char* path)
+{
+	Close();
+
+	if (!file.Open(path) || file.GetSize() < sizeof(PackHeader))
+	{
+		file.Close();
+		return false;
+	}
+
+	const char* data = file.GetData();
+	unsigned long long size = file.GetSize();
+	const PackHeader* candidate = (const PackHeader*)data;
+
+	bool valid = candidate->magic == PACK_MAGIC && candidate->version == PACK_VERSION
+		&& candidate->tocOffset <= size && (unsigned long long)candidate->entryCount * sizeof(PackEntry) <= size - candidate->tocOffset
+		&& candidate->namesOffset <= size && candidate->namesSize <= size - candidate->namesOffset;
+
+	// Every entry has to stay inside the file before any of them is handed out
+	const PackEntry* toc = (const PackEntry*)(data + candidate->tocOffset);
+	for (uint i = 0; valid && i < candidate->entryCount; ++i)
+	{
+		valid = toc[i].offset <= size && toc[i].size <= size - toc[i].offset
+			&& toc[i].nameOffset <= candidate->namesSize && toc[i].nameSize <= candidate->namesSize - toc[i].nameOffset
+			&& (i == 0 || toc[i - 1].pathHash <= toc[i].pathHash);
+	}
+
+	if (!valid)
+	{
+		file.Close();
+		return false;
+	}
+
+	header = candidate;
+	entries = toc;
+	names = data + header->namesOffset;
+	return true;
+}
+
+void PackArchive::Close()
+{
+	file.Close();
+	header = nullptr;
+	entries = nullptr;
+	names = nullptr;
+}
+
+bool PackArchive::IsOpen() const
+{
+	return header != nullptr;
+}
+
+const PackEntry* PackArchive::Find(const char* path) const
+{
+	if (header == nullptr)
+		return nullptr;
+
+	std::string normalized = NormalizePath(path);
+	unsigned long long hash = HashBytes(normalized.data(), normalized.size());
+
+	const PackEntry* end = entries + header->entryCount;
+	const PackEntry* it = std::lower_bound(entries, end, hash, [](const PackEntry& entry, unsigned long long value)
+	{
+		return entry.pathHash < value;
+	});
+
+	// The name settles hash collisions
+	for (; it != end && it->pathHash == hash; ++it)
+	{
+		if (it->nameSize == normalized.size() && memcmp(names + it->nameOffset, normalized.data(), it->nameSize) == 0)
+			return it;
+	}
+
+	return nullptr;
+}
+
+bool PackArchive::Open(const PackEntry* entry, MappedFile& view) const
+{
+	char* stored = file.GetData() + entry->offset;
+
+	if ((entry->flags & PACK_ENTRY_LZ4) == 0)
+		return view.OpenView(stored, entry->size);
+
+	char* data = new char[entry->originalSize];
+	if (!LZ4Decompress(stored, entry->size, data, entry->originalSize))
+	{
+		delete[] data;
+		return false;
+	}
+
+	return view.OpenBuffer(data, entry->originalSize);
+}
+
+uint PackArchive::GetEntryCount() const
+{
+	return header != nullptr ? header->entryCount : 0u;
+}
+
+const PackEntry* PackArchive::GetEntry(uint index) const
+{
+	return &entries[index];
+}
+
+std::string PackArchive::GetName(const PackEntry* entry) const
+{
+	return std::string(names + entry->nameOffset, entry->nameSize);
+}
+
+const char* PackArchive::GetStoredData(const PackEntry* entry) const
+{
+	return file.GetData() + entry->offset;
+}
+
+std::string PackArchive::NormalizePath(const char* path)
+{
+	std::string normalized(path);
+	std::replace(normalized.begin(), normalized.end(), '\\', '/');
+	return normalized;
+}
+
+static void WritePadding(std::ofstream& out, unsigned long long& offset)
+{
+	static const char zeros[PACK_ALIGNMENT] = {};
+	uint padding = (PACK_ALIGNMENT - offset % PACK_ALIGNMENT) % PACK_ALIGNMENT;
+	out.write(zeros, padding);
+	offset += padding;
+}
+
+bool PackArchive::Write(const char* path, const std::vector<PackSource>& sources)
+{
+	std::ofstream out(path, std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!out.is_open())
+		return false;
+
+	PackHeader header;
+	header.entryCount = sources.size();
+	out.write((const char*)&header, sizeof(header));
+	unsigned long long offset = sizeof(header);
+
+	std::vector<PackEntry> toc(sources.size());
+	std::string nameTable;
+	std::vector<char> compressed;
+
+	for (uint i = 0; i < sources.size(); ++i)
+	{
+		const PackSource& source = sources[i];
+		PackEntry& entry = toc[i];
+
+		std::string name = NormalizePath(source.path.c_str());
+		entry.pathHash = HashBytes(name.data(), name.size());
+		entry.nameOffset = nameTable.size();
+		entry.nameSize = name.size();
+		nameTable += name;
+
+		entry.time = source.time;
+		entry.flags = source.flags;
+		entry.size = source.size;
+		entry.originalSize = source.originalSize;
+		const char* payload = source.data;
+
+		if (source.compress && (source.flags & PACK_ENTRY_LZ4) == 0 && source.size > 0)
+		{
+			compressed.resize(LZ4CompressBound(source.size));
+			uint compressedSize = LZ4Compress(source.data, source.size, compressed.data(), compressed.size());
+			if (compressedSize > 0 && compressedSize < source.size - source.size / 8)
+			{
+				entry.flags |= PACK_ENTRY_LZ4;
+				entry.size = compressedSize;
+				payload = compressed.data();
+			}
+		}
+
+		WritePadding(out, offset);
+		entry.offset = offset;
+		out.write(payload, entry.size);
+		offset += entry.size;
+	}
+
+	std::sort(toc.begin(), toc.end(), [](const PackEntry& a, const PackEntry& b) { return a.pathHash < b.pathHash; });
+
+	WritePadding(out, offset);
+	header.tocOffset = offset;
+	out.write((const char*)toc.data(), sizeof(PackEntry) * toc.size());
+	offset += sizeof(PackEntry) * toc.size();
+
+	header.namesOffset = offset;
+	header.namesSize = nameTable.size();
+	out.write(nameTable.data(), nameTable.size());
+
+	out.seekp(0, out.beg);
+	out.write((const char*)&header, sizeof(header));
+
+	bool written = out.good();
+	out.close();
+	return written;
+}
@@ -0,0 +1,97 @@
+#pragma once
+#include "Globals.h"
+#include "MappedFile.h"
+#include <string>
+#include <vector>
+
+#define PACK_MAGIC 0x4c4b4150 // "PAKL"
+#define PACK_VERSION 1
+
+// Entries start on this boundary, mesh file sections stay aligned in the mapped archive
+#define PACK_ALIGNMENT 16
+
+#define PACK_ENTRY_LZ4 (1 << 0)
+
+// Layout: header | entries (aligned) | TOC sorted by path hash | path names
+struct PackHeader
+{
+	uint magic = PACK_MAGIC;
+	uint version = PACK_VERSION;
+	uint entryCount = 0u;
+	uint namesSize = 0u;
+	unsigned long long tocOffset = 0ull;
+	unsigned long long namesOffset = 0ull;
+};
+
+struct PackEntry
+{
+	// Of the normalized path, see PackArchive::NormalizePath
+	unsigned long long pathHash = 0ull;
+
+	// Write time of the loose file it was packed from, stands in for it afterwards
+	unsigned long long time = 0ull;
+
+	unsigned long long offset = 0ull;
+	uint size = 0u;
+	uint originalSize = 0u;
+	uint flags = 0u;
+
+	uint nameOffset = 0u;
+	uint nameSize = 0u;
+	uint padding = 0u;
+};
+
+// One file going into a new archive
+struct PackSource
+{
+	std::string path;
+	unsigned long long time = 0ull;
+
+	// Either a loose file read at write time, or an entry copied as it is from another archive
+	const char* data = nullptr;
+	uint size = 0u;
+	uint originalSize = 0u;
+	uint flags = 0u;
+
+	// Try LZ4 on it, kept raw anyway when it shrinks less than an eighth
+	bool compress = false;
+};
+
+// Read-only archive of Library files, mapped once. Lookups binary search the TOC in place, uncompressed entries
+// are handed out as views into the mapping and compressed ones are decompressed into a buffer.
+class PackArchive
+{
+public:
+	PackArchive();
+	~PackArchive();
+
+	bool Open(const char* path);
+	void Close();
+
+	bool IsOpen() const;
+
+	const PackEntry* Find(const char* path) const;
+
+	// file either views the mapping or owns the decompressed data
+	bool Open(const PackEntry* entry, MappedFile& file) const;
+
+	uint GetEntryCount() const;
+	const PackEntry* GetEntry(uint index) const;
+	std::string GetName(const PackEntry* entry) const;
+
+	// Payload as stored, still compressed when the entry is
+	const char* GetStoredData(const PackEntry* entry) const;
+
+	// Backslashes to slashes so every spelling of a Library path hashes the same
+	static std::string NormalizePath(const char* path);
+
+	// Sources already compressed are copied as they are
+	static bool Write(const char* path, const std::vector<PackSource>& sources);
+
+private:
+
+	MappedFile file;
+	const PackHeader* header = nullptr;
+	const PackEntry* entries = nullptr;
+	const char* names = nullptr;
+};
@@ -76,6 +76,11 @@ void Particle::Draw()
 {
 	if (plane)
 	{
-		plane->Draw(float4x4::FromTRS(position, ownRotation, float3(size)).Transposed(), *texture, color);
+		plane->Draw(GetTransform().Transposed(), *texture, color);
 	}
+}
+
+float4x4 Particle::GetTransform() const
+{
+	return float4x4::FromTRS(position, ownRotation, float3(size));
 }
\ No newline at end of file
@@ -20,6 +20,9 @@ public:
 
 	void Draw();
 
+	// Camera facing quad transform, the plane is the unit quad centered on the origin
+	float4x4 GetTransform() const;
+
 public:
 	bool active = false;
 
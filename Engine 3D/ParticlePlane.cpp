@@ -1,6 +1,7 @@
 #include "ParticlePlane.h"
 #include "Glew/include/glew.h"
 #include "ResourceTexture.h"
+#include "Application.h"
 
 ParticlePlane::ParticlePlane()
 {
@@ -13,9 +14,8 @@ ParticlePlane::ParticlePlane()
 	};
 
 	glGenBuffers(1, (GLuint*)&(indexID));
-	glBindBuffer(GL_ARRAY_BUFFER, indexID);
+	App->renderer3D->glState.BindBuffer(GL_ARRAY_BUFFER, indexID);
 	glBufferData(GL_ARRAY_BUFFER, sizeof(float) * 12, indicesQuad, GL_STATIC_DRAW);
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
 
 	unsigned int vertices[]
 	{
@@ -24,9 +24,8 @@ ParticlePlane::ParticlePlane()
 	};
 
 	glGenBuffers(1, (GLuint*)&(vertexID));
-	glBindBuffer(GL_ARRAY_BUFFER, vertexID);
+	App->renderer3D->glState.BindBuffer(GL_ARRAY_BUFFER, vertexID);
 	glBufferData(GL_ARRAY_BUFFER, sizeof(unsigned int) * 6, vertices, GL_STATIC_DRAW);
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
 
 	float text[]
 	{
@@ -37,17 +36,15 @@ ParticlePlane::ParticlePlane()
 	};
 
 	glGenBuffers(1, (GLuint*)&(uvID));
-	glBindBuffer(GL_ARRAY_BUFFER, uvID);
+	App->renderer3D->glState.BindBuffer(GL_ARRAY_BUFFER, uvID);
 	glBufferData(GL_ARRAY_BUFFER, sizeof(float) * 12, text, GL_STATIC_DRAW);
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
 }
 
 ParticlePlane::~ParticlePlane()
 {
-	glDeleteBuffers(1, (GLuint*)&(indexID));
-	glDeleteBuffers(1, (GLuint*)&(vertexID));
-
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	App->renderer3D->glState.DeleteBuffer(indexID);
+	App->renderer3D->glState.DeleteBuffer(vertexID);
+	App->renderer3D->glState.DeleteBuffer(uvID);
 }
 
 void ParticlePlane::Draw(float4x4 matrix, ResourceTexture* texture, float4 color)
@@ -55,36 +52,35 @@ void ParticlePlane::Draw(float4x4 matrix, ResourceTexture* texture, float4 color
 	glPushMatrix();
 	glMultMatrixf(matrix.ptr());
 
-	glEnableClientState(GL_VERTEX_ARRAY);
+	GLStateCache& state = App->renderer3D->glState;
+	bool textured = texture != nullptr;
+
+	state.EnableClientState(GL_VERTEX_ARRAY);
+	state.SetClientState(GL_TEXTURE_COORD_ARRAY, textured);
 
-	glBindBuffer(GL_ARRAY_BUFFER, indexID);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, vertexID);
+	state.BindBuffer(GL_ARRAY_BUFFER, indexID);
+	state.BindBuffer(GL_ELEMENT_ARRAY_BUFFER, vertexID);
 	glVertexPointer(3, GL_FLOAT, 0, NULL);
 
-	if (texture != nullptr)
+	state.SetEnabled(GL_TEXTURE_2D, textured);
+	if (textured)
 	{
-		glEnable(GL_TEXTURE_2D);
-		glEnable(GL_BLEND);
-		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+		// Blending and alpha test stay on afterwards, same as before the cache
+		state.Enable(GL_BLEND);
+		state.BlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
-		glEnableClientState(GL_TEXTURE_COORD_ARRAY);
-		glBindBuffer(GL_ARRAY_BUFFER, uvID);
+		state.BindBuffer(GL_ARRAY_BUFFER, uvID);
 		glTexCoordPointer(2, GL_FLOAT, 0, NULL);
 
-		glEnable(GL_ALPHA_TEST);
-		glAlphaFunc(GL_GREATER, 0);
+		state.Enable(GL_ALPHA_TEST);
+		state.AlphaFunc(GL_GREATER, 0);
 
-		glBindTexture(GL_TEXTURE_2D, texture->id);
+		state.BindTexture(texture->id);
 	}
 
 	glColor4f(color.x, color.y, color.z, color.w);
 	glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, NULL);
+	App->renderer3D->drawCalls++;
 
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
-
-	glBindTexture(GL_TEXTURE_2D, 0);
-	glDisableClientState(GL_TEXTURE_COORD_ARRAY);
-	glDisableClientState(GL_VERTEX_ARRAY);
 	glPopMatrix();
 }
\ No newline at end of file
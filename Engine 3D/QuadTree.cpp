@@ -136,6 +136,21 @@ void QuadTree_Node::DeleteGameObjet(GameObject* object)
 	}
 }
 
+// Inserted into every child its box touches, nothing gets redistributed on the way out
+void QuadTree_Node::RemoveGameObject(GameObject* object)
+{
+	if (!object->boundingBox.Intersects(bounding_box))
+		return;
+
+	objects_quad.remove(object);
+
+	if (HasChilds())
+	{
+		for (int i = 0; i < 4; i++)
+			childs[i]->RemoveGameObject(object);
+	}
+}
+
 void QuadTree_Node::GetBoxes(std::vector<math::AABB>& node)
 {
 
@@ -199,6 +214,12 @@ void Quad_Tree::QT_Insert(GameObject* object)
 	}
 }
 
+void Quad_Tree::QT_Remove(GameObject* object)
+{
+	if (object->boundingBox.IsFinite() && root != nullptr)
+		root->RemoveGameObject(object);
+}
+
 void Quad_Tree::UniqueObjects(std::vector<GameObject*>& objects) const
 {
 	if (!objects.empty())
@@ -20,6 +20,7 @@ public:
 	void InsertGameObject(GameObject* object);
 	void RedistributeChilds();
 	void DeleteGameObjet(GameObject* object);
+	void RemoveGameObject(GameObject* object);
 	void GetBoxes(std::vector<math::AABB>& node);
 	template<typename TYPE>
 	inline void Intersects(std::vector<GameObject*>& objects, const TYPE& primitive) const
@@ -66,6 +67,7 @@ public:
 	void QT_Clear();
 
 	void QT_Insert(GameObject* object);
+	void QT_Remove(GameObject* object);
 	template<typename TYPE>
 	inline void QT_Intersect(std::vector<GameObject*>& objects, const TYPE& primitive)
 	{
@@ -0,0 +1,101 @@
+#include "ResidencyManager.h"
+#include <algorithm>
+
+ResidencyManager::ResidencyManager()
+{
+}
+
+ResidencyManager::~ResidencyManager()
+{
+}
+
+void ResidencyManager::Update(const std::vector<ResourceSlot>& slots)
+{
+	frame++;
+
+	for (uint i = 0; i < RESOURCE_TYPE_COUNT; ++i)
+		stats[i] = ResidencyStats();
+	cpuMemory = gpuMemory = 0ull;
+
+	std::vector<Resource*> candidates;
+	for (uint i = 0; i < slots.size(); ++i)
+	{
+		Resource* resource = slots[i].resource;
+		if (resource == nullptr)
+			continue;
+
+		uint cpu = resource->GetCPUMemory();
+		uint gpu = resource->GetGPUMemory();
+
+		ResidencyStats& typeStats = stats[(uint)resource->type];
+		typeStats.count++;
+		if (!resource->unloaded)
+			typeStats.resident++;
+		typeStats.cpuMemory += cpu;
+		typeStats.gpuMemory += gpu;
+
+		cpuMemory += cpu;
+		gpuMemory += gpu;
+
+		if (frame - resource->lastVisibleFrame > minIdleFrames)
+			candidates.push_back(resource);
+	}
+
+	if (cpuMemory <= cpuBudget && gpuMemory <= gpuBudget)
+		return;
+
+	// Least recently drawn first
+	std::sort(candidates.begin(), candidates.end(), [](const Resource* a, const Resource* b)
+	{
+		return a->lastVisibleFrame < b->lastVisibleFrame;
+	});
+
+	// The totals shown are the ones from before the evictions, the next frame catches up
+	unsigned long long cpu = cpuMemory, gpu = gpuMemory;
+	for (uint i = 0; i < candidates.size() && (cpu > cpuBudget || gpu > gpuBudget); ++i)
+	{
+		Resource* resource = candidates[i];
+
+		if (gpu > gpuBudget && resource->CanUnload())
+		{
+			cpu -= resource->GetCPUMemory();
+			gpu -= resource->GetGPUMemory();
+			resource->Unload();
+			unloads++;
+		}
+		else if (cpu > cpuBudget && resource->CanReleaseCPU())
+		{
+			cpu -= resource->GetCPUMemory();
+			resource->ReleaseCPU();
+			cpuReleases++;
+		}
+	}
+}
+
+bool ResidencyManager::Touch(Resource* resource, bool needsCPU)
+{
+	if (resource == nullptr)
+		return false;
+
+	resource->lastVisibleFrame = frame;
+
+	if (resource->unloaded || (needsCPU && resource->cpuReleased))
+	{
+		// Visible right now, ahead of everything the scene loader queued by distance
+		if (resource->Reload(0.0f))
+			reloads++;
+		return false;
+	}
+
+	return true;
+}
+
+unsigned long long ResidencyManager::GetFrame() const
+{
+	return frame;
+}
+
+const ResidencyStats& ResidencyManager::GetStats(ResourceType type) const
+{
+	return stats[(uint)type];
+}
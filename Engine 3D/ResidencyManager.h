@@ -0,0 +1,56 @@
+#pragma once
+#include "Globals.h"
+#include "Resource.h"
+#include <vector>
+
+// Indexed by ResourceType
+#define RESOURCE_TYPE_COUNT 4
+
+struct ResidencyStats
+{
+	uint count = 0u;
+	uint resident = 0u;
+	unsigned long long cpuMemory = 0ull;
+	unsigned long long gpuMemory = 0ull;
+};
+
+// Keeps the registered resources under a CPU and a GPU memory budget. Once over, the resources that went longest
+// without being drawn are evicted first: GPU pressure unloads them completely, CPU pressure only drops the CPU copies
+// of meshes that are still on the GPU. Touching an evicted resource reloads it from Library in the background.
+class ResidencyManager
+{
+public:
+	ResidencyManager();
+	~ResidencyManager();
+
+	// Once per frame from ModuleResources
+	void Update(const std::vector<ResourceSlot>& slots);
+
+	// Marks the resource as used this frame and requests whatever eviction dropped.
+	// False while the data the caller needs isn't there, it'll be back in a few frames.
+	bool Touch(Resource* resource, bool needsCPU = false);
+
+	unsigned long long GetFrame() const;
+
+	const ResidencyStats& GetStats(ResourceType type) const;
+
+public:
+
+	unsigned long long cpuBudget = 512ull * 1024ull * 1024ull;
+	unsigned long long gpuBudget = 1024ull * 1024ull * 1024ull;
+
+	// Nothing drawn this recently gets evicted, whatever the budget says
+	uint minIdleFrames = 120u;
+
+	uint cpuReleases = 0u;
+	uint unloads = 0u;
+	uint reloads = 0u;
+
+	unsigned long long cpuMemory = 0ull;
+	unsigned long long gpuMemory = 0ull;
+
+private:
+
+	unsigned long long frame = 1ull;
+	ResidencyStats stats[RESOURCE_TYPE_COUNT];
+};
@@ -10,18 +10,62 @@ enum class ResourceType
 	Scene
 };
 
+// Registry slot plus the generation it had when the resource was added. Once the resource goes away the slot's
+// generation moves on, so stale handles resolve to nullptr instead of a dangling pointer.
+struct ResourceHandle
+{
+	uint index = 0u;
+	uint generation = 0u;
+
+	bool IsValid() const { return generation != 0u; }
+	bool operator==(const ResourceHandle& other) const { return index == other.index && generation == other.generation; }
+	bool operator!=(const ResourceHandle& other) const { return !(*this == other); }
+};
+
 class Resource
 {
 public:
 	Resource(ResourceType type, const char* path);
 	virtual ~Resource();
 
+	// Residency: eviction only drops what Reload brings back from Library
+	virtual uint GetCPUMemory() const { return 0u; }
+	virtual uint GetGPUMemory() const { return 0u; }
+
+	// Frees the CPU copies, drawing keeps working from the GPU
+	virtual bool CanReleaseCPU() const { return false; }
+	virtual void ReleaseCPU() {}
+
+	// Frees everything that can be reloaded
+	virtual bool CanUnload() const { return false; }
 	virtual void Unload() {};
 
+	// Asynchronous, clears cpuReleased/unloaded once the data is back. False when no new request was made.
+	virtual bool Reload(float priority) { return false; }
+
 	bool operator==(Resource other);
 
 public:
 	std::string name;
 	ResourceType type = ResourceType::None;
 	int usage = 0;
+
+	// Library uuid when the resource comes from one, 0 otherwise
+	uint uuid = 0u;
+
+	// Set by ModuleResources::AddResource
+	ResourceHandle handle;
+
+	// Residency frame of the last draw or query that needed the data
+	unsigned long long lastVisibleFrame = 0ull;
+	bool cpuReleased = false;
+	bool unloaded = false;
+};
+
+struct ResourceSlot
+{
+	Resource* resource = nullptr;
+
+	// Starts at 1 so a zeroed handle never matches
+	uint generation = 1u;
 };
\ No newline at end of file
@@ -0,0 +1,289 @@
+#include "ResourceLoader.h"
+#include "Application.h"
+
+static void DeleteRequest(LoadRequest* request)
+{
+	// The job system lets go of the counter only after the decode job returns
+	App->jobs.Wait(&request->counter);
+
+	if (request->map)
+		delete request->mapping;
+	else
+		delete[] request->data;
+
+	delete request;
+}
+
+ResourceLoader::ResourceLoader()
+{
+}
+
+ResourceLoader::~ResourceLoader()
+{
+}
+
+void ResourceLoader::Init()
+{
+	quit = false;
+	ioThread = std::thread(&ResourceLoader::IOLoop, this);
+}
+
+void ResourceLoader::CleanUp()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		quit = true;
+	}
+	condition.notify_all();
+
+	if (ioThread.joinable())
+		ioThread.join();
+
+	// Whatever is still decoding writes into live resources
+	for (std::map<LoadHandle, LoadRequest*>::iterator it = requests.begin(); it != requests.end(); ++it)
+		App->jobs.Wait(&it->second->counter);
+	requests.clear();
+
+	for (uint i = 0; i < queue.size(); ++i)
+		DeleteRequest(queue[i]);
+	queue.clear();
+
+	for (uint i = 0; i < finished.size(); ++i)
+		DeleteRequest(finished[i]);
+	finished.clear();
+}
+
+LoadHandle ResourceLoader::Request(const char* path, float priority, const std::function<void(LoadRequest&)>& decode, const std::function<void(LoadRequest&)>& complete, bool map)
+{
+	LoadRequest* request = new LoadRequest();
+	request->handle = nextHandle++;
+	request->path = path;
+	request->priority = priority;
+	request->decode = decode;
+	request->complete = complete;
+	request->map = map;
+	request->batch = currentBatch;
+
+	requests[request->handle] = request;
+	batchRequested++;
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		queue.push_back(request);
+	}
+	condition.notify_one();
+
+	return request->handle;
+}
+
+void ResourceLoader::Cancel(LoadHandle handle)
+{
+	std::map<LoadHandle, LoadRequest*>::iterator it = requests.find(handle);
+	if (it == requests.end())
+		return;
+
+	LoadRequest* request = it->second;
+	requests.erase(it);
+
+	if (request->batch == currentBatch)
+		batchRequested--;
+
+	bool decoding = false;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		request->cancelled = true;
+
+		if (request->state == LoadState::Queued)
+		{
+			for (uint i = 0; i < queue.size(); ++i)
+			{
+				if (queue[i] == request)
+				{
+					queue.erase(queue.begin() + i);
+					break;
+				}
+			}
+			delete request;
+			return;
+		}
+
+		// Reading ones get dropped by the I/O thread or skip their decode job, finished ones by Update
+		decoding = request->state == LoadState::Decoding;
+	}
+
+	if (decoding)
+		App->jobs.Wait(&request->counter);
+}
+
+void ResourceLoader::SetPriority(LoadHandle handle, float priority)
+{
+	std::map<LoadHandle, LoadRequest*>::iterator it = requests.find(handle);
+	if (it == requests.end())
+		return;
+
+	std::lock_guard<std::mutex> lock(mutex);
+	it->second->priority = priority;
+}
+
+bool ResourceLoader::IsPending(LoadHandle handle) const
+{
+	return requests.find(handle) != requests.end();
+}
+
+void ResourceLoader::Update()
+{
+	std::vector<LoadRequest*> done;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		done.swap(finished);
+	}
+
+	Uint64 start = SDL_GetPerformanceCounter();
+	float elapsedMs = 0.0f;
+
+	uint i = 0u;
+	for (; i < done.size(); ++i)
+	{
+		if (i > 0 && elapsedMs > completionBudgetMs)
+			break;
+
+		LoadRequest* request = done[i];
+
+		// Checked here, a callback earlier in the loop may have cancelled it
+		if (!request->cancelled)
+		{
+			requests.erase(request->handle);
+			if (request->batch == currentBatch)
+				batchCompleted++;
+
+			if (request->complete)
+				request->complete(*request);
+		}
+
+		DeleteRequest(request);
+
+		elapsedMs = (float)(SDL_GetPerformanceCounter() - start) * 1000.0f / SDL_GetPerformanceFrequency();
+	}
+
+	lastCompletionMs = elapsedMs;
+
+	// Over budget, the rest goes first next frame
+	if (i < done.size())
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		finished.insert(finished.begin(), done.begin() + i, done.end());
+	}
+}
+
+uint ResourceLoader::GetPending() const
+{
+	return requests.size();
+}
+
+void ResourceLoader::BeginBatch()
+{
+	currentBatch++;
+	batchRequested = batchCompleted = 0u;
+}
+
+float ResourceLoader::GetBatchProgress() const
+{
+	return batchRequested == 0 ? 1.0f : (float)batchCompleted / (float)batchRequested;
+}
+
+// ------------------------------------------------------------
+void ResourceLoader::IOLoop()
+{
+	while (true)
+	{
+		LoadRequest* request = nullptr;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			condition.wait(lock, [this]() { return quit || !queue.empty(); });
+			if (quit)
+				return;
+
+			uint best = 0u;
+			for (uint i = 1; i < queue.size(); ++i)
+			{
+				if (queue[i]->priority < queue[best]->priority)
+					best = i;
+			}
+
+			request = queue[best];
+			queue.erase(queue.begin() + best);
+			request->state = LoadState::Reading;
+		}
+
+		if (request->map)
+		{
+			// Faulted in here so the decode doesn't wait on the disk
+			request->mapping = new MappedFile();
+			if (App->resources->vfs.Open(request->path.c_str(), *request->mapping))
+			{
+				request->mapping->Prefault();
+				request->data = request->mapping->GetData();
+				request->size = request->mapping->GetSize();
+
+				filesRead++;
+				bytesRead += request->size;
+			}
+			else
+			{
+				delete request->mapping;
+				request->mapping = nullptr;
+			}
+		}
+		else
+		{
+			request->data = App->resources->vfs.Read(request->path.c_str(), &request->size);
+			if (request->data != nullptr)
+			{
+				filesRead++;
+				bytesRead += request->size;
+			}
+		}
+
+		bool decode = false;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			if (request->cancelled)
+			{
+				DeleteRequest(request);
+				continue;
+			}
+
+			decode = request->data != nullptr && request->decode;
+		}
+
+		// Decoding starts under the lock, a Cancel before that only has the job skip it and never waits
+		if (decode)
+		{
+			App->jobs.Submit([this, request]()
+			{
+				bool cancelled = false;
+				{
+					std::lock_guard<std::mutex> lock(mutex);
+					cancelled = request->cancelled;
+					if (!cancelled)
+						request->state = LoadState::Decoding;
+				}
+
+				if (!cancelled)
+					request->decode(*request);
+				Finish(request);
+			}, &request->counter);
+		}
+		else
+			Finish(request);
+	}
+}
+
+void ResourceLoader::Finish(LoadRequest* request)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	// Last touch from this thread, Update deletes it once the job system is done with the counter
+	request->state = LoadState::Finished;
+	finished.push_back(request);
+}
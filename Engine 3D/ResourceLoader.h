@@ -0,0 +1,114 @@
+#pragma once
+#include "Globals.h"
+#include "JobSystem.h"
+#include "MappedFile.h"
+#include <string>
+#include <vector>
+#include <map>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+
+// 0 is never a valid handle
+typedef uint LoadHandle;
+
+enum class LoadState
+{
+	Queued,
+	Reading,
+	Decoding,
+	Finished
+};
+
+struct LoadRequest
+{
+	LoadHandle handle = 0u;
+	std::string path;
+
+	// Lower loads first
+	float priority = 0.0f;
+
+	// Whole file, nullptr when it couldn't be read
+	char* data = nullptr;
+	uint size = 0u;
+
+	// Mapped instead of read, data points into the view. Callbacks may take the view and leave nullptr.
+	bool map = false;
+	MappedFile* mapping = nullptr;
+
+	// Runs on a worker after the read, only when the file was found
+	std::function<void(LoadRequest&)> decode;
+	bool decoded = false;
+
+	// Runs on the main thread from ModuleResources::Update
+	std::function<void(LoadRequest&)> complete;
+
+	LoadState state = LoadState::Queued;
+	bool cancelled = false;
+	uint batch = 0u;
+
+	// Held by the decode job, Cancel waits on it and nothing deletes the request before it drops
+	JobCounter counter;
+};
+
+// Reads files on a dedicated I/O thread in priority order, hands them to the job system for decoding and delivers
+// the results to the main thread under a per-frame time budget.
+class ResourceLoader
+{
+public:
+	ResourceLoader();
+	~ResourceLoader();
+
+	void Init();
+	void CleanUp();
+
+	LoadHandle Request(const char* path, float priority, const std::function<void(LoadRequest&)>& decode, const std::function<void(LoadRequest&)>& complete, bool map = false);
+
+	// Waits when the decode is already running so nothing it touches goes away under it
+	void Cancel(LoadHandle handle);
+
+	void SetPriority(LoadHandle handle, float priority);
+
+	bool IsPending(LoadHandle handle) const;
+
+	// Main thread: runs the completion callbacks
+	void Update();
+
+	uint GetPending() const;
+
+	// Progress over the requests made since the last BeginBatch, 1 when there's nothing left
+	void BeginBatch();
+	float GetBatchProgress() const;
+
+private:
+
+	void IOLoop();
+	void Finish(LoadRequest* request);
+
+public:
+
+	float completionBudgetMs = 4.0f;
+
+	std::atomic<uint> filesRead = { 0u };
+	std::atomic<unsigned long long> bytesRead = { 0ull };
+	float lastCompletionMs = 0.0f;
+
+	uint batchRequested = 0u;
+	uint batchCompleted = 0u;
+
+private:
+
+	LoadHandle nextHandle = 1u;
+	uint currentBatch = 0u;
+	std::map<LoadHandle, LoadRequest*> requests;
+
+	std::thread ioThread;
+	mutable std::mutex mutex;
+	std::condition_variable condition;
+	bool quit = false;
+
+	std::vector<LoadRequest*> queue;
+	std::vector<LoadRequest*> finished;
+};
@@ -1,24 +1,469 @@
 #include "ResourceMesh.h"
 #include "Glew/include/glew.h"
+#include "Application.h"
+#include <math.h>
+
+static unsigned short FloatToHalf(float value)
+{
+	uint bits = 0u;
+	memcpy(&bits, &value, sizeof(float));
+
+	uint sign = (bits >> 16) & 0x8000;
+	int exponent = (int)((bits >> 23) & 0xff) - 127 + 15;
+	uint mantissa = bits & 0x7fffff;
+
+	// Flush denormals to zero and clamp overflows to infinity
+	if (exponent <= 0)
+		return (unsigned short)sign;
+	if (exponent >= 31)
+		return (unsigned short)(sign | 0x7c00);
+
+	uint half = sign | (exponent << 10) | (mantissa >> 13);
+	if (mantissa & 0x1000)
+		half++;
+
+	return (unsigned short)half;
+}
+
+// Streams inside the mapped Library file go away with the mapping
+template <typename T>
+static void FreeStream(const MappedFile* mapping, T*& data)
+{
+	if (mapping == nullptr || !mapping->Contains(data))
+		delete[] data;
+	data = nullptr;
+}
+
+template <typename T>
+static void CopyStream(const MappedFile* mapping, T*& data, uint count)
+{
+	if (data == nullptr || !mapping->Contains(data))
+		return;
+
+	T* copy = new T[count];
+	memcpy(copy, data, sizeof(T) * count);
+	data = copy;
+}
 
 ResourceMesh::ResourceMesh(const char * path) : Resource(ResourceType::Mesh, path)
 {
+	bounds.SetNegativeInfinity();
 }
 
 ResourceMesh::~ResourceMesh()
 {
-	glDeleteBuffers(1, (GLuint*)&(index.id));
-	glDeleteBuffers(1, (GLuint*)&(vertex.id));
-	glDeleteBuffers(1, (GLuint*)&(normals.id));
-	glDeleteBuffers(1, (GLuint*)&(uvs.id));
+	// Waits for a running decode, staging is still in use until then
+	App->resources->loader.Cancel(loadHandle);
+	App->resources->loader.Cancel(reloadHandle);
+	delete staging;
+
+	App->renderer3D->indirect.RemoveMesh(this);
+
+	GLStateCache& state = App->renderer3D->glState;
+	state.DeleteBuffer(index.id);
+	state.DeleteBuffer(vertex.id);
+	state.DeleteBuffer(normals.id);
+	state.DeleteBuffer(uvs.id);
+	state.DeleteBuffer(packed.id);
+
+	ReleaseStreams();
+}
+
+void ResourceMesh::ReleaseStreams()
+{
+	FreeStream(mapping, index.data);
+	FreeStream(mapping, vertex.data);
+	FreeStream(mapping, normals.data);
+	FreeStream(mapping, uvs.data);
+	FreeStream(mapping, packed.data);
+	FreeStream(mapping, lodIndex.data);
 
-	delete index.data;
-	delete vertex.data;
-	delete normals.data;
-	delete uvs.data;
+	delete mapping;
+	mapping = nullptr;
+	mappedShortIndices = nullptr;
+}
+
+void ResourceMesh::DetachMapping()
+{
+	if (mapping == nullptr)
+		return;
+
+	CopyStream(mapping, index.data, index.size);
+	CopyStream(mapping, vertex.data, vertex.size);
+	CopyStream(mapping, normals.data, normals.size);
+	CopyStream(mapping, uvs.data, uvs.size);
+	CopyStream(mapping, packed.data, packed.size);
+	CopyStream(mapping, lodIndex.data, lodIndex.size);
+
+	delete mapping;
+	mapping = nullptr;
+	mappedShortIndices = nullptr;
+}
+
+uint ResourceMesh::GetCPUMemory() const
+{
+	// Mapped streams count too, they're private copy-on-write pages
+	uint bytes = 0u;
+	if (index.data) bytes += sizeof(uint) * index.size;
+	if (vertex.data) bytes += sizeof(float) * vertex.size;
+	if (normals.data) bytes += sizeof(float) * normals.size;
+	if (uvs.data) bytes += sizeof(float) * uvs.size;
+	if (packed.data) bytes += packed.size;
+	if (lodIndex.data) bytes += sizeof(uint) * lodIndex.size;
+	return bytes;
+}
+
+bool ResourceMesh::CanReleaseCPU() const
+{
+	// Par shapes have no Library file, and the null backend draws nothing from the GPU
+	return uuid != 0 && !cpuReleased && reloadHandle == 0 && index.id != 0 && vertex.data != nullptr;
+}
+
+void ResourceMesh::ReleaseCPU()
+{
+	// The sizes stay, the buffers and the inspector still need them
+	ReleaseStreams();
+	cpuReleased = true;
+}
+
+bool ResourceMesh::CanUnload() const
+{
+	// The buffers only exist once the first load finished, until then a worker may still be filling the streams
+	return uuid != 0 && !unloaded && reloadHandle == 0 && index.id != 0;
 }
 
 void ResourceMesh::Unload()
 {
-	/// TODO
-}
\ No newline at end of file
+	App->renderer3D->indirect.RemoveMesh(this);
+
+	GLStateCache& state = App->renderer3D->glState;
+	state.DeleteBuffer(index.id);
+	state.DeleteBuffer(vertex.id);
+	state.DeleteBuffer(normals.id);
+	state.DeleteBuffer(uvs.id);
+	state.DeleteBuffer(packed.id);
+
+	ReleaseStreams();
+	cpuReleased = true;
+	unloaded = true;
+}
+
+void ResourceMesh::Load(float priority)
+{
+	// Mapped and parsed on a worker, the buffers are created on the main thread straight from the mapping
+	ResourceMesh* target = this;
+	std::string file = App->resources->GetDirection(ResourceType::Mesh, uuid);
+	loadHandle = App->resources->loader.Request(file.c_str(), priority,
+		[target](LoadRequest& request)
+		{
+			request.decoded = App->import->ReadMeshImporter(target, request.data, request.size, &request.mapping);
+			if (request.decoded)
+				App->import->PrepareMesh(target);
+		},
+		[this](LoadRequest& request) { OnLoaded(request); }, true);
+}
+
+void ResourceMesh::OnLoaded(LoadRequest& request)
+{
+	loadHandle = 0u;
+
+	if (!request.decoded)
+	{
+		LOG("Couldn't load mesh %u from %s", uuid, request.path.c_str());
+		loadFailed = true;
+		return;
+	}
+
+	GenerateBuffers();
+}
+
+bool ResourceMesh::Reload(float priority)
+{
+	if (reloadHandle != 0 || reloadFailed || uuid == 0 || (!cpuReleased && !unloaded))
+		return false;
+
+	// Rebuilding the buffers needs the packed stream too, the CPU copies alone don't
+	bool gpu = unloaded;
+	staging = new ResourceMesh(name.c_str());
+
+	ResourceMesh* target = staging;
+	std::string file = App->resources->GetDirection(ResourceType::Mesh, uuid);
+	reloadHandle = App->resources->loader.Request(file.c_str(), priority,
+		[target, gpu](LoadRequest& request)
+		{
+			request.decoded = App->import->ReadMeshImporter(target, request.data, request.size, &request.mapping);
+			if (request.decoded && gpu)
+				App->import->PrepareMesh(target);
+		},
+		[this, gpu](LoadRequest& request) { OnReloaded(request, gpu); }, true);
+
+	return true;
+}
+
+void ResourceMesh::OnReloaded(LoadRequest& request, bool gpu)
+{
+	reloadHandle = 0u;
+
+	if (request.decoded)
+		TakeStreams(staging, gpu);
+	delete staging;
+	staging = nullptr;
+
+	if (!request.decoded)
+	{
+		// Stays evicted, retrying every frame would only read the same file again
+		LOG("Couldn't reload mesh %s from %s", name.c_str(), request.path.c_str());
+		reloadFailed = true;
+		return;
+	}
+
+	if (gpu)
+		GenerateBuffers();
+	else
+		FreeStream(mapping, packed.data);
+
+	cpuReleased = false;
+	unloaded = false;
+}
+
+void ResourceMesh::TakeStreams(ResourceMesh* source, bool layout)
+{
+	ReleaseStreams();
+
+	index.data = source->index.data;
+	index.size = source->index.size;
+	vertex.data = source->vertex.data;
+	vertex.size = source->vertex.size;
+	normals.data = source->normals.data;
+	normals.size = source->normals.size;
+	uvs.data = source->uvs.data;
+	uvs.size = source->uvs.size;
+	packed.data = source->packed.data;
+	packed.size = source->packed.size;
+	lodIndex.data = source->lodIndex.data;
+	lodIndex.size = source->lodIndex.size;
+	mapping = source->mapping;
+	mappedShortIndices = source->mappedShortIndices;
+	encoded = source->encoded;
+
+	if (layout)
+	{
+		hasNormals = source->hasNormals;
+		packedFormat = source->packedFormat;
+		halfPositions = source->halfPositions;
+		stride = source->stride;
+		texCoordOffset = source->texCoordOffset;
+		memcpy(uvMin, source->uvMin, sizeof(uvMin));
+		memcpy(uvRange, source->uvRange, sizeof(uvRange));
+		lods = source->lods;
+	}
+
+	// Nothing left for its destructor to free
+	source->index.data = nullptr;
+	source->vertex.data = nullptr;
+	source->normals.data = nullptr;
+	source->uvs.data = nullptr;
+	source->packed.data = nullptr;
+	source->lodIndex.data = nullptr;
+	source->mapping = nullptr;
+	source->mappedShortIndices = nullptr;
+}
+
+void ResourceMesh::PackVertices(bool halfPositions)
+{
+	uint vertexCount = GetVertexCount();
+	if (vertexCount == 0)
+		return;
+
+	// No normals, the fixed function draw can't decode octahedral ones and the indirect path reads the float stream
+	this->halfPositions = halfPositions;
+	texCoordOffset = halfPositions ? 4 * sizeof(unsigned short) : 3 * sizeof(float);
+	stride = texCoordOffset + 2 * sizeof(short);
+
+	uvMin[0] = uvMin[1] = 0.0f;
+	uvRange[0] = uvRange[1] = 1.0f;
+
+	if (uvs.data)
+	{
+		float uvMax[2] = { uvs.data[0], uvs.data[1] };
+		uvMin[0] = uvs.data[0];
+		uvMin[1] = uvs.data[1];
+		for (uint i = 1; i < vertexCount; ++i)
+		{
+			for (uint c = 0; c < 2; ++c)
+			{
+				float value = uvs.data[i * 2 + c];
+				if (value < uvMin[c]) uvMin[c] = value;
+				if (value > uvMax[c]) uvMax[c] = value;
+			}
+		}
+		for (uint c = 0; c < 2; ++c)
+			uvRange[c] = uvMax[c] - uvMin[c] > 0.0f ? uvMax[c] - uvMin[c] : 1.0f;
+	}
+
+	FreeStream(mapping, packed.data);
+	packed.size = vertexCount * stride;
+	packed.data = new char[packed.size];
+	memset(packed.data, 0, packed.size);
+
+	for (uint i = 0; i < vertexCount; ++i)
+	{
+		char* cursor = packed.data + i * stride;
+
+		if (halfPositions)
+		{
+			unsigned short* position = (unsigned short*)cursor;
+			position[0] = FloatToHalf(vertex.data[i * 3]);
+			position[1] = FloatToHalf(vertex.data[i * 3 + 1]);
+			position[2] = FloatToHalf(vertex.data[i * 3 + 2]);
+		}
+		else
+			memcpy(cursor, &vertex.data[i * 3], 3 * sizeof(float));
+
+		if (uvs.data)
+		{
+			// Shift to the signed range, GL_SHORT is the only 16 bit type glTexCoordPointer takes
+			short* uv = (short*)(cursor + texCoordOffset);
+			for (uint c = 0; c < 2; ++c)
+			{
+				float t = (uvs.data[i * 2 + c] - uvMin[c]) / uvRange[c];
+				uv[c] = (short)((int)floorf(t * 65535.0f + 0.5f) - 32768);
+			}
+		}
+	}
+
+	packedFormat = true;
+}
+
+void ResourceMesh::GenerateBuffers()
+{
+	if (lods.empty())
+		lods.push_back(MeshLOD());
+	lods[0].indexOffset = 0u;
+	lods[0].indexCount = index.size;
+
+	shortIndices = GetVertexCount() < 65536;
+
+	// The null renderer keeps the CPU streams only
+	if (App->renderer3D->nullBackend)
+		return;
+
+	GLStateCache& state = App->renderer3D->glState;
+
+	if (packedFormat)
+	{
+		glGenBuffers(1, (GLuint*)&(packed.id));
+		state.BindBuffer(GL_ARRAY_BUFFER, packed.id);
+		glBufferData(GL_ARRAY_BUFFER, packed.size, packed.data, GL_STATIC_DRAW);
+
+		// The float streams stay on the CPU for picking and debug draw, the packed copy is GPU only
+		FreeStream(mapping, packed.data);
+	}
+	else
+	{
+		glGenBuffers(1, (GLuint*)&(vertex.id));
+		state.BindBuffer(GL_ARRAY_BUFFER, vertex.id);
+		glBufferData(GL_ARRAY_BUFFER, sizeof(float) * vertex.size, vertex.data, GL_STATIC_DRAW);
+
+		if (normals.data)
+		{
+			glGenBuffers(1, (GLuint*)&(normals.id));
+			state.BindBuffer(GL_ARRAY_BUFFER, normals.id);
+			glBufferData(GL_ARRAY_BUFFER, sizeof(float) * normals.size, normals.data, GL_STATIC_DRAW);
+		}
+
+		if (uvs.data)
+		{
+			glGenBuffers(1, (GLuint*)&(uvs.id));
+			state.BindBuffer(GL_ARRAY_BUFFER, uvs.id);
+			glBufferData(GL_ARRAY_BUFFER, sizeof(float) * uvs.size, uvs.data, GL_STATIC_DRAW);
+		}
+	}
+
+	// One element buffer for every level: the original indices followed by the simplified ones
+	uint totalIndices = index.size + lodIndex.size;
+
+	glGenBuffers(1, (GLuint*)&(index.id));
+	state.BindBuffer(GL_ELEMENT_ARRAY_BUFFER, index.id);
+	if (shortIndices && mappedShortIndices != nullptr)
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(unsigned short) * totalIndices, mappedShortIndices, GL_STATIC_DRAW);
+	else if (shortIndices)
+	{
+		unsigned short* shortIndex = new unsigned short[totalIndices];
+		for (uint i = 0; i < index.size; ++i)
+			shortIndex[i] = (unsigned short)index.data[i];
+		for (uint i = 0; i < lodIndex.size; ++i)
+			shortIndex[index.size + i] = (unsigned short)lodIndex.data[i];
+
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(unsigned short) * totalIndices, shortIndex, GL_STATIC_DRAW);
+		delete[] shortIndex;
+	}
+	else
+	{
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(uint) * totalIndices, nullptr, GL_STATIC_DRAW);
+		glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, sizeof(uint) * index.size, index.data);
+		if (lodIndex.size > 0)
+			glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, sizeof(uint) * index.size, sizeof(uint) * lodIndex.size, lodIndex.data);
+	}
+}
+
+uint ResourceMesh::GetIndexType() const
+{
+	return shortIndices ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+}
+
+uint ResourceMesh::GetVertexCount() const
+{
+	return vertex.size / 3;
+}
+
+uint ResourceMesh::GetGPUMemory() const
+{
+	if (index.id == 0)
+		return 0u;
+
+	uint bytes = (index.size + lodIndex.size) * (shortIndices ? sizeof(unsigned short) : sizeof(uint));
+
+	if (packedFormat)
+		bytes += packed.size;
+	else
+		bytes += sizeof(float) * (vertex.size + (normals.id != 0 ? normals.size : 0) + uvs.size);
+
+	return bytes;
+}
+
+uint ResourceMesh::GetUploadSize() const
+{
+	// shortIndices is only set by GenerateBuffers, this runs before it
+	uint bytes = (index.size + lodIndex.size) * (GetVertexCount() < 65536 ? sizeof(unsigned short) : sizeof(uint));
+
+	if (packedFormat)
+		bytes += packed.size;
+	else
+		bytes += sizeof(float) * (vertex.size + (normals.data != nullptr ? normals.size : 0) + (uvs.data != nullptr ? uvs.size : 0));
+
+	return bytes;
+}
+
+void ResourceMesh::ComputeBounds()
+{
+	bounds.SetNegativeInfinity();
+	if (vertex.data != nullptr)
+		bounds.Enclose((const float3*)vertex.data, GetVertexCount());
+}
+
+uint ResourceMesh::SelectLOD(float screenSize, uint currentLOD, float hysteresis) const
+{
+	if (lods.size() < 2)
+		return 0u;
+
+	uint level = currentLOD < lods.size() ? currentLOD : lods.size() - 1;
+
+	while (level + 1 < lods.size() && screenSize < lods[level + 1].screenSize * (1.0f - hysteresis))
+		level++;
+
+	while (level > 0 && screenSize > lods[level].screenSize * (1.0f + hysteresis))
+		level--;
+
+	return level;
+}
@@ -1,7 +1,13 @@
 #pragma once
 #include "Resource.h"
+#include "MappedFile.h"
+#include "MathGeoLib/MathGeoLib.h"
+#include <vector>
+
+#define MAX_MESH_LODS 4
 
 class GameObject;
+struct LoadRequest;
 
 template <typename T>
 struct buffer
@@ -11,13 +17,60 @@ struct buffer
 	T* data = nullptr;
 };
 
+struct MeshLOD
+{
+	// Range in the shared index buffer, level 0 is the original mesh
+	uint indexOffset = 0u;
+	uint indexCount = 0u;
+
+	// Simplification error relative to the mesh size
+	float error = 0.0f;
+
+	// Projected size (fraction of the half screen height) below which the level gets used
+	float screenSize = 0.0f;
+};
+
 class ResourceMesh : public Resource
 {
 public:
 	ResourceMesh(const char* path);
 	~ResourceMesh();
 
-	void Unload(); 
+	// Residency, everything but the bounds and the LOD table comes back from the Library file
+	uint GetCPUMemory() const;
+	bool CanReleaseCPU() const;
+	void ReleaseCPU();
+	bool CanUnload() const;
+	void Unload();
+	bool Reload(float priority);
+
+	// First read of the Library file, the buffers get built when it completes. Components wait on loadHandle.
+	void Load(float priority);
+
+	// Builds the interleaved vertex stream from vertex/normals/uvs
+	void PackVertices(bool halfPositions);
+
+	// Uploads the CPU data to the GPU (packed stream or one VBO per attribute)
+	void GenerateBuffers();
+
+	uint GetIndexType() const;
+
+	uint GetVertexCount() const;
+
+	// 0 while the buffers aren't there
+	uint GetGPUMemory() const;
+
+	// What GenerateBuffers will upload, from the CPU streams
+	uint GetUploadSize() const;
+
+	// Recomputes bounds from the vertex stream
+	void ComputeBounds();
+
+	// Copies the streams that point into the mapped Library file, the file can be rewritten afterwards
+	void DetachMapping();
+
+	// Picks the level for a projected size, moving between levels only past the hysteresis band
+	uint SelectLOD(float screenSize, uint currentLOD, float hysteresis) const;
 
 public:
 
@@ -28,5 +81,60 @@ public:
 	buffer<float> uvs;
 
 	bool hasNormals = false;
+
+	// Packed layout: position (float3 or half3 + pad) | uv (2 x snorm16)
+	buffer<char> packed;
+	bool packedFormat = false;
+	bool halfPositions = false;
+	uint stride = 0u;
+	uint texCoordOffset = 0u;
+
+	// Packed uvs are quantized to the mesh uv bounds, the texture matrix expands them back
+	float uvMin[2] = { 0.0f, 0.0f };
+	float uvRange[2] = { 1.0f, 1.0f };
+
+	// 16 bit indices when the mesh has less than 65536 vertices
+	bool shortIndices = false;
+
+	// Post-transform cache misses per triangle, before is only known for meshes optimized this session
+	float acmr = 0.0f;
+	float acmrBeforeOptimization = 0.0f;
+
+	// Simplified levels share the vertex buffer, their indices follow index.data in the same element buffer
+	std::vector<MeshLOD> lods;
+	buffer<unsigned int> lodIndex;
+
+	AABB bounds;
+
+	// Library file the streams point into when it was mapped, nullptr when they own their memory
+	MappedFile* mapping = nullptr;
+
+	// 16 bit copy of every level's indices in the mapping, uploaded as it is
+	const unsigned short* mappedShortIndices = nullptr;
+
+	// Library file is in the compressed encoding, those are decoded and never mapped
+	bool encoded = false;
+
+	// Pending first load, and whether it failed
+	uint loadHandle = 0u;
+	bool loadFailed = false;
+
+private:
+
+	// Frees every CPU stream and the mapping they may point into
+	void ReleaseStreams();
+
+	// Moves the streams (and the layout when the buffers get rebuilt) out of a freshly read copy
+	void TakeStreams(ResourceMesh* source, bool layout);
+
+	void OnLoaded(LoadRequest& request);
+	void OnReloaded(LoadRequest& request, bool gpu);
+
+private:
+
+	// Read into on a worker while the reload is pending, the mesh itself is only touched on the main thread
+	ResourceMesh* staging = nullptr;
+	uint reloadHandle = 0u;
+	bool reloadFailed = false;
 };
 
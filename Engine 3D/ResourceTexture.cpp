@@ -1,5 +1,6 @@
 #include "ResourceTexture.h"
 #include "Glew/include/glew.h"
+#include "Application.h"
 
 
 ResourceTexture::ResourceTexture(const char * path) : Resource(ResourceType::Texture, path)
@@ -8,10 +9,41 @@ ResourceTexture::ResourceTexture(const char * path) : Resource(ResourceType::Tex
 
 ResourceTexture::~ResourceTexture()
 {
-	glDeleteTextures(1, (GLuint*)&(id));
+	App->resources->loader.Cancel(loadHandle);
+	App->import->streamer.Remove(this);
+	App->renderer3D->textureArrays.Remove(this);
+	App->renderer3D->glState.DeleteTexture(id);
+}
+
+uint ResourceTexture::GetGPUMemory() const
+{
+	// The array layer is a second copy on the GPU
+	return id != 0 ? gpuMemory + arrayMemory : 0u;
+}
+
+bool ResourceTexture::CanUnload() const
+{
+	return id != 0 && !unloaded && loadHandle == 0;
 }
 
 void ResourceTexture::Unload()
 {
-	/// TODO
+	App->import->streamer.Remove(this);
+	App->renderer3D->textureArrays.Remove(this);
+	App->renderer3D->glState.DeleteTexture(id);
+
+	gpuMemory = 0u;
+	residentLevel = 0u;
+	unloaded = true;
+}
+
+bool ResourceTexture::Reload(float priority)
+{
+	if (!unloaded || loadHandle != 0)
+		return false;
+
+	// Checker until it's back, a failed reload leaves it that way
+	unloaded = false;
+	App->import->RealLoadTexture(name.c_str(), this, priority);
+	return true;
 }
\ No newline at end of file
@@ -7,8 +7,31 @@ public:
 	ResourceTexture(const char * path);
 	~ResourceTexture();
 
+	// Residency: the whole texture goes, RealLoadTexture brings it back from Library
+	uint GetGPUMemory() const;
+	bool CanUnload() const;
 	void Unload();
+	bool Reload(float priority);
 
 public:
 	uint id = 0u;
+
+	uint width = 0u;
+	uint height = 0u;
+	uint mipLevels = 0u;
+	uint gpuMemory = 0u;
+	bool compressed = false;
+	uint format = 0u;
+
+	// Highest resolution level on the GPU, the streamer lowers it over the following frames
+	uint residentLevel = 0u;
+	uint lastUsedFrame = 0u;
+
+	// Copy in a shared texture array, 0 when the texture isn't packed
+	uint arrayTexture = 0u;
+	uint arrayLayer = 0u;
+	uint arrayMemory = 0u;
+
+	// Pending read on the resource loader
+	uint loadHandle = 0u;
 };
\ No newline at end of file
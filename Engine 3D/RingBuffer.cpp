@@ -0,0 +1,172 @@
+#include "RingBuffer.h"
+#include "Application.h"
+#include "Glew/include/glew.h"
+
+#define FENCE_TIMEOUT_NS 1000000000
+
+RingBuffer::RingBuffer()
+{
+	for (uint i = 0; i < RING_BUFFER_FRAMES; ++i)
+		fences[i] = nullptr;
+}
+
+RingBuffer::~RingBuffer()
+{
+}
+
+bool RingBuffer::Init(uint frameSize)
+{
+	if (!GLEW_ARB_sync)
+	{
+		LOG("Ring buffer needs fences (ARB_sync), dynamic data keeps its own buffers");
+		return false;
+	}
+
+	this->frameSize = frameSize;
+	uint totalSize = frameSize * RING_BUFFER_FRAMES;
+
+	GLint alignment = 0;
+	glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &alignment);
+	if (alignment > 0)
+		storageAlignment = alignment;
+
+	glGenBuffers(1, (GLuint*)&buffer);
+	App->renderer3D->glState.BindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+
+	if (GLEW_ARB_buffer_storage)
+	{
+		GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glBufferStorage(GL_COPY_WRITE_BUFFER, totalSize, nullptr, flags);
+		mapped = (char*)glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, totalSize, flags);
+		persistent = mapped != nullptr;
+	}
+
+	if (!persistent)
+	{
+		glBufferData(GL_COPY_WRITE_BUFFER, totalSize, nullptr, GL_STREAM_DRAW);
+		staging.resize(frameSize);
+	}
+
+	section = RING_BUFFER_FRAMES - 1;
+	head = section * frameSize;
+	ready = true;
+
+	LOG("Ring buffer: %u KB x %u frames, %s", frameSize / 1024, RING_BUFFER_FRAMES, persistent ? "persistent mapping" : "staged uploads");
+
+	return true;
+}
+
+void RingBuffer::CleanUp()
+{
+	for (uint i = 0; i < RING_BUFFER_FRAMES; ++i)
+	{
+		if (fences[i])
+			glDeleteSync(fences[i]);
+		fences[i] = nullptr;
+	}
+
+	if (buffer != 0 && persistent)
+	{
+		App->renderer3D->glState.BindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+		glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+	}
+
+	App->renderer3D->glState.DeleteBuffer(buffer);
+	mapped = nullptr;
+	ready = persistent = false;
+}
+
+void RingBuffer::BeginFrame()
+{
+	if (!ready)
+		return;
+
+	lastBytesAllocated = bytesAllocated;
+	lastAllocations = allocations;
+	if (bytesAllocated > peakBytesAllocated)
+		peakBytesAllocated = bytesAllocated;
+	bytesAllocated = 0u;
+	allocations = 0u;
+
+	section = (section + 1) % RING_BUFFER_FRAMES;
+	head = section * frameSize;
+
+	if (fences[section])
+	{
+		// Only stalls when the GPU is more than two frames behind
+		GLenum result = glClientWaitSync(fences[section], 0, 0);
+		if (result == GL_TIMEOUT_EXPIRED)
+		{
+			stalls++;
+			Uint64 start = SDL_GetPerformanceCounter();
+			glClientWaitSync(fences[section], GL_SYNC_FLUSH_COMMANDS_BIT, FENCE_TIMEOUT_NS);
+			stallMs += (float)((double)(SDL_GetPerformanceCounter() - start) * 1000.0 / (double)SDL_GetPerformanceFrequency());
+		}
+
+		glDeleteSync(fences[section]);
+		fences[section] = nullptr;
+	}
+}
+
+void RingBuffer::EndFrame()
+{
+	if (!ready)
+		return;
+
+	fences[section] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+RingAllocation RingBuffer::Allocate(uint size, uint alignment)
+{
+	RingAllocation allocation;
+	if (!ready || size == 0)
+		return allocation;
+
+	uint offset = (head + alignment - 1) / alignment * alignment;
+	if (offset + size > (section + 1) * frameSize)
+	{
+		failedAllocations++;
+		return allocation;
+	}
+
+	allocation.offset = offset;
+	allocation.size = size;
+	allocation.data = persistent ? mapped + offset : &staging[offset - section * frameSize];
+
+	head = offset + size;
+	bytesAllocated += size;
+	allocations++;
+
+	return allocation;
+}
+
+void RingBuffer::Commit(const RingAllocation& allocation)
+{
+	// Coherent mappings are visible to the GPU already
+	if (persistent || allocation.data == nullptr)
+		return;
+
+	// The fence guarantees the GPU is done with this range, the upload doesn't have to wait
+	App->renderer3D->glState.BindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+	glBufferSubData(GL_COPY_WRITE_BUFFER, allocation.offset, allocation.size, allocation.data);
+}
+
+bool RingBuffer::IsReady() const
+{
+	return ready;
+}
+
+bool RingBuffer::IsPersistent() const
+{
+	return persistent;
+}
+
+uint RingBuffer::GetBuffer() const
+{
+	return buffer;
+}
+
+uint RingBuffer::GetStorageAlignment() const
+{
+	return storageAlignment;
+}
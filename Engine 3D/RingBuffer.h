@@ -0,0 +1,73 @@
+#pragma once
+#include "Globals.h"
+#include <vector>
+
+#define RING_BUFFER_FRAMES 3
+
+struct __GLsync;
+
+// A slice of the ring for this frame, write data then Commit before drawing from it
+struct RingAllocation
+{
+	char* data = nullptr;
+	uint offset = 0u;
+	uint size = 0u;
+};
+
+// Triple buffered stream for per-frame dynamic data. With ARB_buffer_storage the buffer is mapped persistently and
+// coherently, otherwise writes go to a CPU staging copy and Commit uploads them. A fence per frame section keeps the
+// CPU from overwriting data the GPU still reads.
+class RingBuffer
+{
+public:
+	RingBuffer();
+	~RingBuffer();
+
+	bool Init(uint frameSize);
+	void CleanUp();
+
+	// Moves to the next section, waiting for the GPU if it still uses it
+	void BeginFrame();
+	void EndFrame();
+
+	// Returns an empty allocation when the frame's section is full, callers keep their own path as fallback
+	RingAllocation Allocate(uint size, uint alignment = 16);
+	void Commit(const RingAllocation& allocation);
+
+	bool IsReady() const;
+	bool IsPersistent() const;
+
+	uint GetBuffer() const;
+
+	// Minimum offset alignment for binding a range as a shader storage buffer
+	uint GetStorageAlignment() const;
+
+public:
+
+	uint frameSize = 0u;
+
+	// Stats: this frame and last, peak use, total stalls waiting on fences
+	uint bytesAllocated = 0u;
+	uint lastBytesAllocated = 0u;
+	uint peakBytesAllocated = 0u;
+	uint allocations = 0u;
+	uint lastAllocations = 0u;
+	uint failedAllocations = 0u;
+	uint stalls = 0u;
+	float stallMs = 0.0f;
+
+private:
+
+	uint buffer = 0u;
+	char* mapped = nullptr;
+	std::vector<char> staging;
+	bool persistent = false;
+	bool ready = false;
+
+	uint storageAlignment = 16u;
+
+	uint section = 0u;
+	uint head = 0u;
+
+	__GLsync* fences[RING_BUFFER_FRAMES];
+};
@@ -0,0 +1,208 @@
+#include "TextureArrays.h"
+#include "Application.h"
+#include "ResourceTexture.h"
+#include "DDS.h"
+#include "Glew/include/glew.h"
+
+// Only the streamed DDS formats are packed, DevIL textures have no known internal format
+static BlockFormat GetBlockFormat(uint format)
+{
+	switch (format)
+	{
+	case GL_COMPRESSED_RGBA_S3TC_DXT1_EXT: return BlockFormat::DXT1;
+	case GL_COMPRESSED_RGBA_S3TC_DXT3_EXT: return BlockFormat::DXT3;
+	case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT: return BlockFormat::DXT5;
+	default: return BlockFormat::None;
+	}
+}
+
+bool TextureArrayKey::operator<(const TextureArrayKey& other) const
+{
+	if (width != other.width)
+		return width < other.width;
+	if (height != other.height)
+		return height < other.height;
+	if (format != other.format)
+		return format < other.format;
+	return levels < other.levels;
+}
+
+TextureArrays::TextureArrays()
+{
+}
+
+TextureArrays::~TextureArrays()
+{
+}
+
+bool TextureArrays::Init()
+{
+	if (!GLEW_ARB_copy_image || !GLEW_EXT_texture_array)
+	{
+		LOG("Texture arrays need ARB_copy_image, textures keep their own binds");
+		return false;
+	}
+
+	GLint layers = 0;
+	glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &layers);
+	maxLayers = layers;
+
+	supported = maxLayers > 1;
+
+	return supported;
+}
+
+void TextureArrays::CleanUp()
+{
+	for (std::map<TextureArrayKey, TextureArray>::iterator it = arrays.begin(); it != arrays.end(); ++it)
+		App->renderer3D->glState.DeleteTexture(it->second.id);
+
+	arrays.clear();
+	layersUsed = gpuMemory = 0u;
+	supported = false;
+}
+
+bool TextureArrays::IsSupported() const
+{
+	return supported;
+}
+
+bool TextureArrays::Add(ResourceTexture* texture)
+{
+	if (texture->arrayTexture != 0)
+		return true;
+
+	if (!supported || texture->id == 0 || GetBlockFormat(texture->format) == BlockFormat::None || texture->residentLevel != 0)
+		return false;
+
+	TextureArrayKey key;
+	key.width = texture->width;
+	key.height = texture->height;
+	key.format = texture->format;
+	key.levels = texture->mipLevels;
+
+	TextureArray& textureArray = arrays[key];
+
+	uint layer = 0u;
+	while (layer < textureArray.layers.size() && textureArray.layers[layer] != nullptr)
+		layer++;
+
+	if (layer == textureArray.layers.size())
+	{
+		if (layer == textureArray.capacity && !Grow(textureArray, key))
+			return false;
+		textureArray.layers.push_back(nullptr);
+	}
+
+	// Same format on both sides, the blocks are copied as they are
+	uint bytes = 0u;
+	for (uint level = 0; level < key.levels; ++level)
+	{
+		uint width = key.width >> level, height = key.height >> level;
+		width = width > 0 ? width : 1;
+		height = height > 0 ? height : 1;
+		glCopyImageSubData(texture->id, GL_TEXTURE_2D, level, 0, 0, 0, textureArray.id, GL_TEXTURE_2D_ARRAY, level, 0, 0, layer, width, height, 1);
+		bytes += GetCompressedSize(GetBlockFormat(key.format), width, height);
+	}
+
+	textureArray.layers[layer] = texture;
+	texture->arrayTexture = textureArray.id;
+	texture->arrayLayer = layer;
+	layersUsed++;
+
+	// The layer is a second copy of the texture, both budgets see it until the streamer or residency drops it
+	texture->arrayMemory = bytes;
+	App->import->streamer.residentBytes += bytes;
+
+	return true;
+}
+
+void TextureArrays::Remove(ResourceTexture* texture)
+{
+	if (texture->arrayTexture == 0)
+		return;
+
+	for (std::map<TextureArrayKey, TextureArray>::iterator it = arrays.begin(); it != arrays.end(); ++it)
+	{
+		TextureArray& textureArray = it->second;
+		if (textureArray.id == texture->arrayTexture && texture->arrayLayer < textureArray.layers.size())
+		{
+			textureArray.layers[texture->arrayLayer] = nullptr;
+			layersUsed--;
+			break;
+		}
+	}
+
+	TextureStreamer& streamer = App->import->streamer;
+	streamer.residentBytes -= streamer.residentBytes >= texture->arrayMemory ? texture->arrayMemory : streamer.residentBytes;
+
+	texture->arrayTexture = 0u;
+	texture->arrayLayer = 0u;
+	texture->arrayMemory = 0u;
+}
+
+uint TextureArrays::GetArrayCount() const
+{
+	return arrays.size();
+}
+
+bool TextureArrays::Grow(TextureArray& textureArray, const TextureArrayKey& key)
+{
+	uint capacity = textureArray.capacity == 0 ? TEXTURE_ARRAY_INITIAL_LAYERS : textureArray.capacity * 2;
+	if (capacity > maxLayers)
+		capacity = maxLayers;
+	if (capacity <= textureArray.capacity)
+		return false;
+
+	GLStateCache& state = App->renderer3D->glState;
+	state.BindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+	uint id = 0u;
+	glGenTextures(1, (GLuint*)&id);
+	state.BindTexture(GL_TEXTURE_2D_ARRAY, id);
+
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, key.levels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, key.levels - 1);
+
+	uint bytes = 0u;
+	for (uint level = 0; level < key.levels; ++level)
+	{
+		uint width = key.width >> level, height = key.height >> level;
+		width = width > 0 ? width : 1;
+		height = height > 0 ? height : 1;
+
+		uint size = GetCompressedSize(GetBlockFormat(key.format), width, height) * capacity;
+		glCompressedTexImage3D(GL_TEXTURE_2D_ARRAY, level, key.format, width, height, capacity, 0, size, nullptr);
+		bytes += size;
+	}
+
+	// Layers already in use move over once the bigger array is complete
+	for (uint level = 0; textureArray.id != 0 && level < key.levels; ++level)
+	{
+		uint width = key.width >> level, height = key.height >> level;
+		width = width > 0 ? width : 1;
+		height = height > 0 ? height : 1;
+		glCopyImageSubData(textureArray.id, GL_TEXTURE_2D_ARRAY, level, 0, 0, 0, id, GL_TEXTURE_2D_ARRAY, level, 0, 0, 0, width, height, textureArray.capacity);
+	}
+
+	if (textureArray.id != 0)
+	{
+		gpuMemory -= bytes / capacity * textureArray.capacity;
+		state.DeleteTexture(textureArray.id);
+	}
+
+	for (uint i = 0; i < textureArray.layers.size(); ++i)
+	{
+		if (textureArray.layers[i] != nullptr)
+			textureArray.layers[i]->arrayTexture = id;
+	}
+
+	textureArray.id = id;
+	textureArray.capacity = capacity;
+	gpuMemory += bytes;
+
+	return true;
+}
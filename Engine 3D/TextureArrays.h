@@ -0,0 +1,63 @@
+#pragma once
+#include "Globals.h"
+#include <vector>
+#include <map>
+
+class ResourceTexture;
+
+#define TEXTURE_ARRAY_INITIAL_LAYERS 8
+
+// Textures that can share an array: same size, format and mip count
+struct TextureArrayKey
+{
+	uint width = 0u;
+	uint height = 0u;
+	uint format = 0u;
+	uint levels = 0u;
+
+	bool operator<(const TextureArrayKey& other) const;
+};
+
+struct TextureArray
+{
+	uint id = 0u;
+	uint capacity = 0u;
+	std::vector<ResourceTexture*> layers; // nullptr for free layers
+};
+
+// Copies fully resident compressed textures into GL_TEXTURE_2D_ARRAY layers on the GPU (glCopyImageSubData), so the indirect
+// path can draw differently textured meshes in one bucket. Arrays double their layers when full.
+// A layer counts against the texture in the streamer and residency budgets, evicting or unloading the texture frees it.
+class TextureArrays
+{
+public:
+	TextureArrays();
+	~TextureArrays();
+
+	bool Init();
+	void CleanUp();
+
+	bool IsSupported() const;
+
+	// Sets arrayTexture and arrayLayer on the texture, false until it's fully resident
+	bool Add(ResourceTexture* texture);
+	void Remove(ResourceTexture* texture);
+
+	uint GetArrayCount() const;
+
+private:
+
+	bool Grow(TextureArray& textureArray, const TextureArrayKey& key);
+
+public:
+
+	uint layersUsed = 0u;
+	uint gpuMemory = 0u;
+
+private:
+
+	bool supported = false;
+	uint maxLayers = 0u;
+
+	std::map<TextureArrayKey, TextureArray> arrays;
+};
@@ -0,0 +1,228 @@
+#include "TextureCooker.h"
+#include "Application.h"
+#include "ModuleImport.h"
+#include "ModuleResources.h"
+#include "Hash.h"
+#include "MappedFile.h"
+#include "ResourceTexture.h"
+#include "BlockCompression.h"
+#include "DDS.h"
+#include "DevIL/include/il.h"
+
+// Block rows per job when compressing a level
+#define BLOCK_ROWS_PER_JOB 8
+
+TextureCooker::TextureCooker()
+{
+}
+
+TextureCooker::~TextureCooker()
+{
+}
+
+void TextureCooker::Cook(const char* path, ResourceTexture* texture)
+{
+	CookRequest* request = new CookRequest();
+	request->path = path;
+	request->texture = texture->handle;
+	pending.push_back(request);
+
+	App->jobs.Submit([this, request]() { CookJob(request); }, &counter);
+}
+
+void TextureCooker::Update()
+{
+	std::vector<CookRequest*> done;
+	{
+		std::lock_guard<std::mutex> lock(finishedMutex);
+		done.swap(finished);
+	}
+
+	for (uint i = 0; i < done.size(); ++i)
+	{
+		CookRequest* request = done[i];
+		pending.remove(request);
+
+		if (request->dds.empty())
+		{
+			LOG("Couldn't cook texture: %s", request->path.c_str());
+		}
+		else
+		{
+			if (request->cached)
+			{
+				texturesReused++;
+				LOG("Texture unchanged since its last cook: %s", request->path.c_str());
+			}
+			else
+			{
+				texturesCooked++;
+				lastCookMs = request->cookMs;
+				LOG("Texture cooked in %.1f ms: %s", request->cookMs, request->path.c_str());
+
+				ImportRecord record;
+				record.source = request->path;
+				record.type = ResourceType::Texture;
+				record.contentHash = request->contentHash;
+				record.settingsHash = TEXTURE_COOK_VERSION;
+				App->resources->importDB.Store(record);
+			}
+
+			ResourceTexture* texture = App->resources->GetTexture(request->texture);
+			if (texture != nullptr && !App->renderer3D->nullBackend)
+				App->import->UploadTexture(request->dds.data(), request->dds.size(), texture);
+		}
+
+		delete request;
+	}
+}
+
+void TextureCooker::CleanUp()
+{
+	// The Library files still get written, there's no context left to upload to
+	App->jobs.Wait(&counter);
+
+	for (std::list<CookRequest*>::iterator it = pending.begin(); it != pending.end(); ++it)
+		delete *it;
+	pending.clear();
+	finished.clear();
+}
+
+uint TextureCooker::GetPending() const
+{
+	return pending.size();
+}
+
+// ------------------------------------------------------------
+static void DownsampleBox(const std::vector<unsigned char>& source, uint width, uint height, std::vector<unsigned char>& destination, uint newWidth, uint newHeight)
+{
+	destination.resize(newWidth * newHeight * 4);
+	for (uint y = 0; y < newHeight; ++y)
+	{
+		uint y0 = y * 2, y1 = y * 2 + 1 < height ? y * 2 + 1 : height - 1;
+		for (uint x = 0; x < newWidth; ++x)
+		{
+			uint x0 = x * 2, x1 = x * 2 + 1 < width ? x * 2 + 1 : width - 1;
+			for (uint c = 0; c < 4; ++c)
+			{
+				uint sum = source[(y0 * width + x0) * 4 + c] + source[(y0 * width + x1) * 4 + c] + source[(y1 * width + x0) * 4 + c] + source[(y1 * width + x1) * 4 + c];
+				destination[(y * newWidth + x) * 4 + c] = (unsigned char)((sum + 2) / 4);
+			}
+		}
+	}
+}
+
+void TextureCooker::CookJob(CookRequest* request)
+{
+	Uint64 start = SDL_GetPerformanceCounter();
+
+	ImportRecord record;
+	if (App->resources->importDB.Find(request->path.c_str(), TEXTURE_COOK_VERSION, record, &request->contentHash))
+	{
+		MappedFile file;
+		std::string libraryPath = App->resources->GetDirection(ResourceType::Texture, 0u, request->path.c_str());
+		if (App->resources->vfs.Open(libraryPath.c_str(), file))
+		{
+			request->dds.assign(file.GetData(), file.GetData() + file.GetSize());
+			request->cached = true;
+
+			std::lock_guard<std::mutex> lock(finishedMutex);
+			finished.push_back(request);
+			return;
+		}
+	}
+
+	if (request->contentHash == 0)
+		request->contentHash = HashFile(request->path.c_str());
+
+	std::vector<unsigned char> pixels;
+	uint width = 0u, height = 0u;
+	{
+		std::lock_guard<std::mutex> lock(devilMutex);
+
+		uint id = 0;
+		ilGenImages(1, &id);
+		ilBindImage(id);
+		if (ilLoadImage(request->path.c_str()) && ilConvertImage(IL_RGBA, IL_UNSIGNED_BYTE))
+		{
+			width = ilGetInteger(IL_IMAGE_WIDTH);
+			height = ilGetInteger(IL_IMAGE_HEIGHT);
+			const unsigned char* data = ilGetData();
+			pixels.resize(width * height * 4);
+
+			// DDS rows go top to bottom whatever the source origin
+			bool flip = ilGetInteger(IL_IMAGE_ORIGIN) == IL_ORIGIN_LOWER_LEFT;
+			uint rowBytes = width * 4;
+			for (uint y = 0; y < height; ++y)
+				memcpy(&pixels[y * rowBytes], data + (flip ? height - 1 - y : y) * rowBytes, rowBytes);
+		}
+		ilDeleteImages(1, &id);
+	}
+
+	if (!pixels.empty())
+	{
+		bool opaque = true;
+		for (uint i = 3; i < pixels.size() && opaque; i += 4)
+			opaque = pixels[i] == 255;
+		BlockFormat format = opaque ? BlockFormat::DXT1 : BlockFormat::DXT5;
+
+		uint mipCount = 1u;
+		for (uint size = width > height ? width : height; size > 1; size /= 2)
+			mipCount++;
+
+		uint fileSize = DDS_HEADER_SIZE;
+		for (uint i = 0, w = width, h = height; i < mipCount; ++i, w = w > 1 ? w / 2 : 1, h = h > 1 ? h / 2 : 1)
+			fileSize += GetCompressedSize(format, w, h);
+
+		request->dds.resize(fileSize);
+		WriteDDSHeader(request->dds.data(), format, width, height, mipCount);
+
+		uint blockSize = GetBlockSize(format);
+		uint offset = DDS_HEADER_SIZE;
+		std::vector<unsigned char> level = pixels, next;
+		uint levelWidth = width, levelHeight = height;
+
+		for (uint mip = 0; mip < mipCount; ++mip)
+		{
+			uint blocksX = (levelWidth + 3) / 4;
+			uint blocksY = (levelHeight + 3) / 4;
+			unsigned char* out = (unsigned char*)request->dds.data() + offset;
+
+			App->jobs.ParallelFor(blocksY, BLOCK_ROWS_PER_JOB, [&](uint begin, uint end)
+			{
+				unsigned char block[64];
+				for (uint by = begin; by < end; ++by)
+				{
+					for (uint bx = 0; bx < blocksX; ++bx)
+					{
+						ExtractBlock(level.data(), levelWidth, levelHeight, bx, by, block);
+						unsigned char* destination = out + (by * blocksX + bx) * blockSize;
+						if (format == BlockFormat::DXT1)
+							EncodeBC1Block(block, destination);
+						else
+							EncodeBC3Block(block, destination);
+					}
+				}
+			});
+
+			offset += blocksX * blocksY * blockSize;
+
+			if (mip + 1 < mipCount)
+			{
+				uint nextWidth = levelWidth > 1 ? levelWidth / 2 : 1;
+				uint nextHeight = levelHeight > 1 ? levelHeight / 2 : 1;
+				DownsampleBox(level, levelWidth, levelHeight, next, nextWidth, nextHeight);
+				level.swap(next);
+				levelWidth = nextWidth;
+				levelHeight = nextHeight;
+			}
+		}
+
+		App->resources->SaveFile(request->dds.size(), request->dds.data(), ResourceType::Texture, 0u, request->path.c_str());
+	}
+
+	request->cookMs = (float)((double)(SDL_GetPerformanceCounter() - start) * 1000.0 / (double)SDL_GetPerformanceFrequency());
+
+	std::lock_guard<std::mutex> lock(finishedMutex);
+	finished.push_back(request);
+}
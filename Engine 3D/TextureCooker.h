@@ -0,0 +1,71 @@
+#pragma once
+#include "Globals.h"
+#include "JobSystem.h"
+#include "Resource.h"
+#include <string>
+#include <vector>
+#include <list>
+#include <mutex>
+
+// Goes into the import database as the settings hash, bump it when the cooked output changes
+#define TEXTURE_COOK_VERSION 1
+
+class ResourceTexture;
+
+// One texture going through the pipeline. Workers only touch the data, the texture is resolved on the main thread
+// when the cook is done and is simply skipped if it was released meanwhile.
+struct CookRequest
+{
+	std::string path;
+	ResourceHandle texture;
+
+	// Whole DDS file once done, empty when it failed
+	std::vector<char> dds;
+	float cookMs = 0.0f;
+
+	// Same content as the last cook, dds is the Library file as it was
+	bool cached = false;
+	unsigned long long contentHash = 0ull;
+};
+
+// Decodes source images on the job system, builds the mip chain with a box filter, block compresses every level
+// in parallel over rows of blocks (BC1 when fully opaque, BC3 otherwise) and writes the DDS to Library.
+// The main thread picks finished textures up in Update and uploads them. Sources the import database says
+// haven't changed since their last cook reuse the Library file instead.
+class TextureCooker
+{
+public:
+	TextureCooker();
+	~TextureCooker();
+
+	void Cook(const char* path, ResourceTexture* texture);
+
+	// Main thread: hands finished requests to the uploader
+	void Update();
+
+	// Waits for everything in flight
+	void CleanUp();
+
+	uint GetPending() const;
+
+private:
+
+	void CookJob(CookRequest* request);
+
+public:
+
+	// DevIL keeps global state, every DevIL call in the engine has to hold it
+	std::mutex devilMutex;
+
+	uint texturesCooked = 0u;
+	uint texturesReused = 0u;
+	float lastCookMs = 0.0f;
+
+private:
+
+	JobCounter counter;
+	std::list<CookRequest*> pending;
+
+	std::mutex finishedMutex;
+	std::vector<CookRequest*> finished;
+};
@@ -0,0 +1,289 @@
+#include "TextureStreamer.h"
+#include "Application.h"
+#include "ResourceTexture.h"
+#include "Glew/include/glew.h"
+#include <algorithm>
+
+static uint GetGLFormat(BlockFormat format)
+{
+	switch (format)
+	{
+	case BlockFormat::DXT1: return GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
+	case BlockFormat::DXT3: return GL_COMPRESSED_RGBA_S3TC_DXT3_EXT;
+	default: return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+	}
+}
+
+TextureStreamer::TextureStreamer()
+{
+}
+
+TextureStreamer::~TextureStreamer()
+{
+}
+
+bool TextureStreamer::Stream(ResourceTexture* texture, const char* data, uint size)
+{
+	if (!GLEW_EXT_texture_compression_s3tc)
+		return false;
+
+	StreamedTexture streamed;
+	streamed.texture = texture;
+	streamed.file.assign(data, data + size);
+	if (!ParseDDS(streamed.file.data(), size, streamed.image))
+		return false;
+
+	for (uint i = 0; i < streamed.image.levels.size(); ++i)
+		FlipCompressedLevel(streamed.image.levels[i], streamed.image.format);
+
+	uint levelCount = streamed.image.levels.size();
+	streamed.tailLevel = levelCount - 1;
+	while (streamed.tailLevel > 0)
+	{
+		const DDSLevel& level = streamed.image.levels[streamed.tailLevel - 1];
+		if (level.width > STREAMING_TAIL_SIZE || level.height > STREAMING_TAIL_SIZE)
+			break;
+		streamed.tailLevel--;
+	}
+
+	Remove(texture);
+	App->renderer3D->textureArrays.Remove(texture);
+	App->renderer3D->glState.DeleteTexture(texture->id);
+	App->renderer3D->glState.BindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+	glGenTextures(1, (GLuint*)&texture->id);
+	App->renderer3D->glState.BindTexture(texture->id);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, levelCount > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levelCount - 1);
+
+	texture->width = streamed.image.width;
+	texture->height = streamed.image.height;
+	texture->mipLevels = levelCount;
+	texture->compressed = true;
+	texture->format = GetGLFormat(streamed.image.format);
+	texture->gpuMemory = 0u;
+	texture->residentLevel = levelCount;
+	texture->lastUsedFrame = frame;
+
+	// The tail is small, straight from memory
+	for (uint level = levelCount; level-- > streamed.tailLevel;)
+	{
+		const DDSLevel& tail = streamed.image.levels[level];
+		glCompressedTexImage2D(GL_TEXTURE_2D, level, GetGLFormat(streamed.image.format), tail.width, tail.height, 0, tail.size, tail.data);
+		texture->gpuMemory += tail.size;
+	}
+	texture->residentLevel = streamed.tailLevel;
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, texture->residentLevel);
+
+	residentBytes += texture->gpuMemory;
+
+	// The levels point into the file buffer, the map entry keeps the buffer and parses it again where it lives
+	if (streamed.tailLevel > 0)
+	{
+		StreamedTexture& stored = textures[texture];
+		stored.texture = texture;
+		stored.tailLevel = streamed.tailLevel;
+		stored.file.swap(streamed.file);
+		ParseDDS(stored.file.data(), stored.file.size(), stored.image);
+	}
+
+	return true;
+}
+
+void TextureStreamer::Remove(const ResourceTexture* texture)
+{
+	// Every compressed texture is counted, streaming or already complete
+	if (texture->compressed && residentBytes >= texture->gpuMemory)
+		residentBytes -= texture->gpuMemory;
+
+	textures.erase(texture);
+}
+
+void TextureStreamer::Touch(ResourceTexture* texture)
+{
+	texture->lastUsedFrame = frame;
+}
+
+void TextureStreamer::Update()
+{
+	frame++;
+	lastUploadedBytes = 0u;
+
+	if (App->renderer3D->nullBackend || textures.empty())
+		return;
+
+	// Most recently drawn first, then the ones furthest from full resolution
+	std::vector<StreamedTexture*> order;
+	order.reserve(textures.size());
+	for (std::map<const ResourceTexture*, StreamedTexture>::iterator it = textures.begin(); it != textures.end(); ++it)
+		order.push_back(&it->second);
+
+	std::sort(order.begin(), order.end(), [](const StreamedTexture* a, const StreamedTexture* b)
+	{
+		if (a->texture->lastUsedFrame != b->texture->lastUsedFrame)
+			return a->texture->lastUsedFrame > b->texture->lastUsedFrame;
+		return a->texture->residentLevel > b->texture->residentLevel;
+	});
+
+	// Budgets: one level per texture per frame, a level bigger than the whole budget goes alone
+	for (uint i = 0; i < order.size(); ++i)
+	{
+		StreamedTexture& streamed = *order[i];
+		ResourceTexture* texture = streamed.texture;
+
+		if (texture->residentLevel == 0 || frame - texture->lastUsedFrame > recentFrames)
+			continue;
+
+		uint next = texture->residentLevel - 1;
+		uint bytes = streamed.image.levels.size() > next ? streamed.image.levels[next].size : 0u;
+		if (lastUploadedBytes > 0 && lastUploadedBytes + bytes > uploadBudget)
+			break;
+
+		if (streamed.file.empty())
+		{
+			// Evicted earlier, read the Library file again
+			uint size = 0u;
+			char* data = App->resources->LoadFile(texture->name.c_str(), ResourceType::Texture, 0u, &size);
+			if (data == nullptr)
+				continue;
+
+			streamed.file.assign(data, data + size);
+			delete[] data;
+
+			if (!ParseDDS(streamed.file.data(), size, streamed.image))
+				continue;
+			for (uint level = 0; level < streamed.image.levels.size(); ++level)
+				FlipCompressedLevel(streamed.image.levels[level], streamed.image.format);
+		}
+
+		UploadLevel(streamed, next);
+
+		if (lastUploadedBytes >= uploadBudget)
+			break;
+	}
+
+	// Back under the VRAM budget, least recently drawn first
+	App->renderer3D->glState.BindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	for (uint i = order.size(); GLEW_ARB_copy_image && i-- > 0 && residentBytes > vramBudget;)
+	{
+		StreamedTexture& streamed = *order[i];
+		if (frame - streamed.texture->lastUsedFrame > recentFrames && streamed.texture->residentLevel < streamed.tailLevel)
+			Evict(streamed);
+	}
+
+	// Fully resident textures that are recent don't need their file any more
+	for (uint i = 0; i < order.size(); ++i)
+	{
+		if (order[i]->texture->residentLevel == 0 && !order[i]->file.empty())
+		{
+			order[i]->file.clear();
+			order[i]->file.shrink_to_fit();
+			order[i]->image.levels.clear();
+		}
+	}
+}
+
+void TextureStreamer::CleanUp()
+{
+	textures.clear();
+	residentBytes = 0u;
+}
+
+uint TextureStreamer::GetStreamingCount() const
+{
+	return textures.size();
+}
+
+// ------------------------------------------------------------
+void TextureStreamer::UploadLevel(StreamedTexture& streamed, uint level)
+{
+	GLStateCache& state = App->renderer3D->glState;
+	const DDSLevel& data = streamed.image.levels[level];
+	uint format = GetGLFormat(streamed.image.format);
+
+	state.BindTexture(streamed.texture->id);
+
+	// Copied into the fenced ring, the driver reads it from there without stalling this frame
+	RingBuffer& ring = App->renderer3D->ringBuffer;
+	RingAllocation range = ring.Allocate(data.size, 16);
+	if (range.data != nullptr)
+	{
+		memcpy(range.data, data.data, data.size);
+		ring.Commit(range);
+
+		state.BindBuffer(GL_PIXEL_UNPACK_BUFFER, ring.GetBuffer());
+		glCompressedTexImage2D(GL_TEXTURE_2D, level, format, data.width, data.height, 0, data.size, (void*)range.offset);
+		pboUploads++;
+	}
+	else
+	{
+		state.BindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		glCompressedTexImage2D(GL_TEXTURE_2D, level, format, data.width, data.height, 0, data.size, data.data);
+	}
+
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level);
+
+	streamed.texture->residentLevel = level;
+	streamed.texture->gpuMemory += data.size;
+	residentBytes += data.size;
+	lastUploadedBytes += data.size;
+}
+
+void TextureStreamer::Evict(StreamedTexture& streamed)
+{
+	ResourceTexture* texture = streamed.texture;
+	uint levelCount = texture->mipLevels;
+
+	// Its array layer is a full resolution copy, it goes with the high levels
+	App->renderer3D->textureArrays.Remove(texture);
+
+	// Levels can't be freed one by one, copy the tail to a new texture and drop the old one
+	uint tailTexture = 0u;
+	glGenTextures(1, (GLuint*)&tailTexture);
+
+	uint tailBytes = 0u;
+	for (uint level = streamed.tailLevel; level < levelCount; ++level)
+	{
+		uint width = texture->width >> level, height = texture->height >> level;
+		width = width > 0 ? width : 1;
+		height = height > 0 ? height : 1;
+		tailBytes += GetCompressedSize(streamed.image.format, width, height);
+	}
+
+	App->renderer3D->glState.BindTexture(tailTexture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, streamed.tailLevel);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levelCount - 1);
+
+	// The copy needs a complete destination: every tail level allocated first
+	for (uint level = streamed.tailLevel; level < levelCount; ++level)
+	{
+		uint width = texture->width >> level, height = texture->height >> level;
+		width = width > 0 ? width : 1;
+		height = height > 0 ? height : 1;
+		glCompressedTexImage2D(GL_TEXTURE_2D, level, GetGLFormat(streamed.image.format), width, height, 0, GetCompressedSize(streamed.image.format, width, height), nullptr);
+	}
+
+	// Same sizes and format in both, the GPU copies the compressed blocks
+	for (uint level = streamed.tailLevel; level < levelCount; ++level)
+	{
+		uint width = texture->width >> level, height = texture->height >> level;
+		width = width > 0 ? width : 1;
+		height = height > 0 ? height : 1;
+		glCopyImageSubData(texture->id, GL_TEXTURE_2D, level, 0, 0, 0, tailTexture, GL_TEXTURE_2D, level, 0, 0, 0, width, height, 1);
+	}
+
+	App->renderer3D->glState.DeleteTexture(texture->id);
+	texture->id = tailTexture;
+
+	residentBytes -= texture->gpuMemory - tailBytes;
+	texture->gpuMemory = tailBytes;
+	texture->residentLevel = streamed.tailLevel;
+	evictions++;
+}
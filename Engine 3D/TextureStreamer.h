@@ -0,0 +1,72 @@
+#pragma once
+#include "Globals.h"
+#include "DDS.h"
+#include <vector>
+#include <map>
+
+class ResourceTexture;
+
+// Mips with both sides at most this size are uploaded with the texture, the rest stream in
+#define STREAMING_TAIL_SIZE 64
+
+struct StreamedTexture
+{
+	ResourceTexture* texture = nullptr;
+
+	// Library file with the levels already flipped for GL, dropped once every level is resident
+	std::vector<char> file;
+	DDSImage image;
+
+	// First level of the resident tail, never evicted
+	uint tailLevel = 0u;
+};
+
+// Textures start with their mip tail and get one higher level at a time, newest use first, through the ring buffer
+// bound as a pixel unpack buffer. Uploads stop for the frame when the byte budget is spent. When the resident total
+// passes the VRAM budget the least recently drawn textures go back to their tail (needs ARB_copy_image).
+class TextureStreamer
+{
+public:
+	TextureStreamer();
+	~TextureStreamer();
+
+	// Creates the GL texture with the mip tail from a block compressed DDS, false when it isn't one
+	bool Stream(ResourceTexture* texture, const char* data, uint size);
+
+	void Remove(const ResourceTexture* texture);
+
+	// Marks the texture as drawn this frame
+	void Touch(ResourceTexture* texture);
+
+	void Update();
+
+	void CleanUp();
+
+	uint GetStreamingCount() const;
+
+private:
+
+	void UploadLevel(StreamedTexture& streamed, uint level);
+
+	void Evict(StreamedTexture& streamed);
+
+public:
+
+	uint frame = 0u;
+
+	// Bytes per frame and resident bytes, set from Configuration
+	uint uploadBudget = 2 * 1024 * 1024;
+	uint vramBudget = 256 * 1024 * 1024;
+
+	// Textures drawn within this many frames keep streaming in and are never evicted
+	uint recentFrames = 120u;
+
+	uint residentBytes = 0u;
+	uint lastUploadedBytes = 0u;
+	uint pboUploads = 0u;
+	uint evictions = 0u;
+
+private:
+
+	std::map<const ResourceTexture*, StreamedTexture> textures;
+};
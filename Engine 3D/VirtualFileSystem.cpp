@@ -0,0 +1,218 @@
+#include "VirtualFileSystem.h"
+#include <string.h>
+
+static unsigned long long GetWriteTime(const char* path)
+{
+	WIN32_FILE_ATTRIBUTE_DATA attributes;
+	if (!GetFileAttributesEx(path, GetFileExInfoStandard, &attributes))
+		return 0ull;
+
+	return ((unsigned long long)attributes.ftLastWriteTime.dwHighDateTime << 32) | attributes.ftLastWriteTime.dwLowDateTime;
+}
+
+VirtualFileSystem::VirtualFileSystem()
+{
+}
+
+VirtualFileSystem::~VirtualFileSystem()
+{
+}
+
+void VirtualFileSystem::Init()
+{
+	archive.Open(LIBRARY_ARCHIVE);
+
+	// Two directory listings instead of a stat per lookup
+	ScanLooseFiles("Library/Models");
+	ScanLooseFiles("Library/Textures");
+}
+
+void VirtualFileSystem::CleanUp(bool pack)
+{
+	if (pack && (!looseFiles.empty() || !removedFiles.empty()))
+		Pack();
+
+	archive.Close();
+}
+
+void VirtualFileSystem::ScanLooseFiles(const char* directory)
+{
+	WIN32_FIND_DATA data;
+	std::string pattern = std::string(directory) + "/*";
+	HANDLE find = FindFirstFile(pattern.c_str(), &data);
+	if (find == INVALID_HANDLE_VALUE)
+		return;
+
+	do
+	{
+		if ((data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) == 0)
+			looseFiles[std::string(directory) + "/" + data.cFileName] = ((unsigned long long)data.ftLastWriteTime.dwHighDateTime << 32) | data.ftLastWriteTime.dwLowDateTime;
+	} while (FindNextFile(find, &data));
+
+	FindClose(find);
+}
+
+const PackEntry* VirtualFileSystem::FindPacked(const char* path)
+{
+	if (!archive.IsOpen())
+		return nullptr;
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		std::string name = PackArchive::NormalizePath(path);
+		if (looseFiles.find(name) != looseFiles.end() || removedFiles.find(name) != removedFiles.end())
+			return nullptr;
+	}
+
+	return archive.Find(path);
+}
+
+bool VirtualFileSystem::Open(const char* path, MappedFile& file)
+{
+	const PackEntry* entry = FindPacked(path);
+	if (entry != nullptr)
+	{
+		if (!archive.Open(entry, file))
+			return false;
+
+		archiveReads++;
+		if (entry->flags & PACK_ENTRY_LZ4)
+			bytesDecompressed += entry->originalSize;
+		return true;
+	}
+
+	if (!file.Open(path))
+		return false;
+
+	looseReads++;
+	return true;
+}
+
+char* VirtualFileSystem::Read(const char* path, uint* size)
+{
+	MappedFile file;
+	if (!Open(path, file))
+		return nullptr;
+
+	char* data = new char[file.GetSize()];
+	memcpy(data, file.GetData(), file.GetSize());
+	if (size)
+		*size = file.GetSize();
+
+	return data;
+}
+
+unsigned long long VirtualFileSystem::GetArchivedTime(const char* path)
+{
+	const PackEntry* entry = FindPacked(path);
+	return entry != nullptr ? entry->time : 0ull;
+}
+
+static bool IsLibraryPath(const std::string& name)
+{
+	return name.compare(0, strlen("Library/"), "Library/") == 0;
+}
+
+void VirtualFileSystem::AddLooseFile(const char* path)
+{
+	// Pack deletes what it archives, only the Library is ours to delete
+	std::string name = PackArchive::NormalizePath(path);
+	if (!IsLibraryPath(name))
+		return;
+
+	std::lock_guard<std::mutex> lock(mutex);
+	looseFiles[name] = GetWriteTime(path);
+	removedFiles.erase(name);
+}
+
+void VirtualFileSystem::RemoveFile(const char* path)
+{
+	DeleteFile(path);
+
+	std::lock_guard<std::mutex> lock(mutex);
+	std::string name = PackArchive::NormalizePath(path);
+	looseFiles.erase(name);
+	removedFiles.insert(name);
+}
+
+uint VirtualFileSystem::GetArchiveEntryCount() const
+{
+	return archive.GetEntryCount();
+}
+
+uint VirtualFileSystem::GetLooseFileCount() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return looseFiles.size();
+}
+
+bool VirtualFileSystem::Pack()
+{
+	std::vector<PackSource> sources;
+
+	// Entries nobody overrode go in as they're stored, no need to recompress them
+	for (uint i = 0; i < archive.GetEntryCount(); ++i)
+	{
+		const PackEntry* entry = archive.GetEntry(i);
+		std::string name = archive.GetName(entry);
+		if (looseFiles.find(name) != looseFiles.end() || removedFiles.find(name) != removedFiles.end())
+			continue;
+
+		PackSource source;
+		source.path = name;
+		source.time = entry->time;
+		source.data = archive.GetStoredData(entry);
+		source.size = entry->size;
+		source.originalSize = entry->originalSize;
+		source.flags = entry->flags;
+		sources.push_back(source);
+	}
+
+	std::vector<MappedFile*> loose;
+	std::vector<std::string> packed;
+	for (std::map<std::string, unsigned long long>::const_iterator it = looseFiles.begin(); it != looseFiles.end(); ++it)
+	{
+		if (!IsLibraryPath(it->first))
+			continue;
+
+		MappedFile* file = new MappedFile();
+		if (!file->Open(it->first.c_str()))
+		{
+			delete file;
+			continue;
+		}
+		loose.push_back(file);
+		packed.push_back(it->first);
+
+		PackSource source;
+		source.path = it->first;
+		source.time = it->second;
+		source.data = file->GetData();
+		source.size = source.originalSize = file->GetSize();
+		source.compress = compressTextures && it->first.compare(0, strlen("Library/Textures/"), "Library/Textures/") == 0;
+		sources.push_back(source);
+	}
+
+	std::string temporary = std::string(LIBRARY_ARCHIVE) + ".tmp";
+	bool written = PackArchive::Write(temporary.c_str(), sources);
+
+	for (uint i = 0; i < loose.size(); ++i)
+		delete loose[i];
+
+	// Mapped files can't be replaced
+	archive.Close();
+
+	if (!written || !MoveFileEx(temporary.c_str(), LIBRARY_ARCHIVE, MOVEFILE_REPLACE_EXISTING))
+	{
+		DeleteFile(temporary.c_str());
+		return false;
+	}
+
+	// Whatever is still mapped somewhere stays loose and simply overrides its entry next time
+	for (uint i = 0; i < packed.size(); ++i)
+		DeleteFile(packed[i].c_str());
+	looseFiles.clear();
+	removedFiles.clear();
+
+	return true;
+}
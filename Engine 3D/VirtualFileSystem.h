@@ -0,0 +1,73 @@
+#pragma once
+#include "Globals.h"
+#include "PackArchive.h"
+#include <string>
+#include <map>
+#include <set>
+#include <mutex>
+#include <atomic>
+
+#define LIBRARY_ARCHIVE "Library/library.pak"
+
+// Read-only view of Library: the packed archive first, loose files written since the last pack override their
+// entries. Every read goes through here, from the main thread, the loader's I/O thread and the import workers.
+class VirtualFileSystem
+{
+public:
+	VirtualFileSystem();
+	~VirtualFileSystem();
+
+	// Maps the archive and lists the loose files that override it
+	void Init();
+
+	// Packs the loose files into a new archive first when asked to
+	void CleanUp(bool pack);
+
+	// A view of the archive entry, or the loose file mapped
+	bool Open(const char* path, MappedFile& file);
+
+	// Whole file in a new[] buffer, nullptr when it doesn't exist
+	char* Read(const char* path, uint* size = nullptr);
+
+	// Packed files answer with the time their loose file had, 0 when the path isn't in the archive
+	unsigned long long GetArchivedTime(const char* path);
+
+	// A Library file was just written, it takes precedence over the archive from now on. Paths outside Library are ignored
+	void AddLooseFile(const char* path);
+
+	// Deletes the loose file, an archived copy stops being found and is left out of the next pack
+	void RemoveFile(const char* path);
+
+	uint GetArchiveEntryCount() const;
+	uint GetLooseFileCount() const;
+
+private:
+
+	// Archive entry unless a loose file overrides it
+	const PackEntry* FindPacked(const char* path);
+
+	void ScanLooseFiles(const char* directory);
+
+	bool Pack();
+
+public:
+
+	// Texture Library files go in LZ4 compressed, meshes stay raw since they're mapped in place
+	bool compressTextures = true;
+
+	std::atomic<uint> archiveReads = { 0u };
+	std::atomic<uint> looseReads = { 0u };
+	std::atomic<unsigned long long> bytesDecompressed = { 0ull };
+
+private:
+
+	PackArchive archive;
+
+	mutable std::mutex mutex;
+
+	// Normalized path -> write time
+	std::map<std::string, unsigned long long> looseFiles;
+
+	// Normalized paths removed since the last pack
+	std::set<std::string> removedFiles;
+};
@@ -0,0 +1,493 @@
+#include "WorldStreamer.h"
+#include "Application.h"
+#include <algorithm>
+#include <map>
+
+static void SetFloat3(JSON_Object* parent, const char* name, const float3& value)
+{
+	JSON_Value* arrayValue = json_value_init_array();
+	JSON_Array* array = json_value_get_array(arrayValue);
+	for (uint i = 0; i < 3; ++i)
+		json_array_append_number(array, value[i]);
+
+	json_object_set_value(parent, name, arrayValue);
+}
+
+static float3 GetFloat3(JSON_Object* parent, const char* name)
+{
+	JSON_Array* array = json_object_get_array(parent, name);
+
+	float3 value = float3::zero;
+	for (uint i = 0; i < 3 && i < json_array_get_count(array); ++i)
+		value[i] = (float)json_array_get_number(array, i);
+
+	return value;
+}
+
+static void EncloseSubtree(const GameObject* go, AABB& bounds)
+{
+	if (go->boundingBox.IsFinite())
+		bounds.Enclose(go->boundingBox);
+
+	for (std::list<GameObject*>::const_iterator it = go->childs.begin(); it != go->childs.end(); ++it)
+		EncloseSubtree(*it, bounds);
+}
+
+static bool CloserCell(const WorldCell* a, const WorldCell* b)
+{
+	return a->distance < b->distance;
+}
+
+WorldStreamer::WorldStreamer()
+{
+}
+
+WorldStreamer::~WorldStreamer()
+{
+	// The loader is gone by now, nothing decodes into the cells anymore
+	for (uint i = 0; i < cells.size(); ++i)
+		json_value_free(cells[i].parsed);
+}
+
+bool WorldStreamer::Save(const char* name, uint depth)
+{
+	if (open)
+	{
+		LOG("%s is already a streamed world, partition the scene it was made from", name);
+		return false;
+	}
+
+	GameObject* root = App->game_object->root;
+
+	std::vector<GameObject*> units;
+	std::vector<AABB> unitBounds;
+	std::vector<GameObject*> persistent;
+
+	AABB world;
+	world.SetNegativeInfinity();
+
+	for (std::list<GameObject*>::const_iterator it = root->childs.begin(); it != root->childs.end(); ++it)
+	{
+		AABB bounds;
+		bounds.SetNegativeInfinity();
+		EncloseSubtree(*it, bounds);
+
+		if (bounds.IsFinite())
+		{
+			units.push_back(*it);
+			unitBounds.push_back(bounds);
+			world.Enclose(bounds);
+		}
+		else
+			persistent.push_back(*it);
+	}
+
+	if (units.empty())
+	{
+		LOG("Nothing in %s has bounds to stream", name);
+		return false;
+	}
+
+	// Square leaves at the given depth of a quadtree over the world bounds
+	uint side = 1u << depth;
+	float3 size = world.Size();
+	float cellX = size.x > 0.0f ? size.x / side : 1.0f;
+	float cellZ = size.z > 0.0f ? size.z / side : 1.0f;
+
+	// A unit goes to the leaf holding its center, the cell bounds grow to whatever it overhangs
+	std::map<uint, std::vector<uint>> cellUnits;
+	for (uint i = 0; i < units.size(); ++i)
+	{
+		float3 center = unitBounds[i].CenterPoint();
+		int x = (int)((center.x - world.minPoint.x) / cellX);
+		int z = (int)((center.z - world.minPoint.z) / cellZ);
+		x = x < 0 ? 0 : (x >= (int)side ? side - 1 : x);
+		z = z < 0 ? 0 : (z >= (int)side ? side - 1 : z);
+
+		cellUnits[z * side + x].push_back(i);
+	}
+
+	JSON_Value* worldValue = json_value_init_object();
+	JSON_Object* worldObj = json_value_get_object(worldValue);
+
+	JSON_Value* infoValue = json_value_init_object();
+	JSON_Object* info = json_value_get_object(infoValue);
+	json_object_set_value(worldObj, "World", infoValue);
+
+	json_object_set_number(info, "Depth", depth);
+	json_object_set_number(info, "Cell X", cellX);
+	json_object_set_number(info, "Cell Z", cellZ);
+	SetFloat3(info, "Min", world.minPoint);
+	SetFloat3(info, "Max", world.maxPoint);
+
+	// The root goes alone, its streamed children come with their cells
+	JSON_Value* objectsValue = json_value_init_array();
+	JSON_Array* objects = json_value_get_array(objectsValue);
+	json_object_set_value(info, "Objects", objectsValue);
+
+	JSON_Value* rootValue = json_value_init_object();
+	root->Save(json_value_get_object(rootValue));
+	json_array_append_value(objects, rootValue);
+
+	for (uint i = 0; i < persistent.size(); ++i)
+		App->game_object->SaveGameObjects(objects, persistent[i]);
+
+	JSON_Value* cellsValue = json_value_init_array();
+	JSON_Array* cellArray = json_value_get_array(cellsValue);
+	json_object_set_value(info, "Cells", cellsValue);
+
+	for (std::map<uint, std::vector<uint>>::const_iterator it = cellUnits.begin(); it != cellUnits.end(); ++it)
+	{
+		int x = it->first % side;
+		int z = it->first / side;
+
+		AABB bounds(float3(world.minPoint.x + x * cellX, world.minPoint.y, world.minPoint.z + z * cellZ),
+			float3(world.minPoint.x + (x + 1) * cellX, world.maxPoint.y, world.minPoint.z + (z + 1) * cellZ));
+
+		JSON_Value* sceneValue = json_value_init_array();
+		JSON_Array* scene = json_value_get_array(sceneValue);
+		for (uint i = 0; i < it->second.size(); ++i)
+		{
+			bounds.Enclose(unitBounds[it->second[i]]);
+			App->game_object->SaveGameObjects(scene, units[it->second[i]]);
+		}
+
+		// Compact, these are parsed at runtime
+		uint fileSize = json_serialization_size(sceneValue);
+		char* buffer = new char[fileSize];
+		json_serialize_to_buffer(sceneValue, buffer, fileSize);
+
+		std::string cellName = std::string(name) + "_" + std::to_string(x) + "_" + std::to_string(z);
+		App->resources->SaveFile(fileSize - 1, buffer, ResourceType::Scene, 0, cellName.c_str());
+
+		JSON_Value* cellValue = json_value_init_object();
+		JSON_Object* cell = json_value_get_object(cellValue);
+		json_object_set_number(cell, "X", x);
+		json_object_set_number(cell, "Z", z);
+		json_object_set_string(cell, "File", App->resources->GetDirection(ResourceType::Scene, 0, cellName.c_str()).c_str());
+		SetFloat3(cell, "Min", bounds.minPoint);
+		SetFloat3(cell, "Max", bounds.maxPoint);
+		json_object_set_number(cell, "Objects", json_array_get_count(scene));
+		json_object_set_number(cell, "Size", fileSize - 1);
+		json_array_append_value(cellArray, cellValue);
+
+		delete[] buffer;
+		json_value_free(sceneValue);
+	}
+
+	uint fileSize = json_serialization_size_pretty(worldValue);
+	char* buffer = new char[fileSize];
+	json_serialize_to_buffer_pretty(worldValue, buffer, fileSize);
+	App->resources->SaveFile(fileSize - 1, buffer, ResourceType::Scene, 0, name);
+
+	LOG("World %s: %u cells at depth %u, %u objects streamed, %u persistent", name, cellUnits.size(), depth, units.size(), persistent.size());
+
+	delete[] buffer;
+	json_value_free(worldValue);
+
+	return true;
+}
+
+void WorldStreamer::Open(JSON_Object* world)
+{
+	cells.clear();
+
+	JSON_Array* cellArray = json_object_get_array(world, "Cells");
+	for (uint i = 0; i < json_array_get_count(cellArray); ++i)
+	{
+		JSON_Object* info = json_array_get_object(cellArray, i);
+		const char* file = json_object_get_string(info, "File");
+		if (file == nullptr)
+			continue;
+
+		WorldCell cell;
+		cell.x = (int)json_object_get_number(info, "X");
+		cell.z = (int)json_object_get_number(info, "Z");
+		cell.file = file;
+		cell.bounds = AABB(GetFloat3(info, "Min"), GetFloat3(info, "Max"));
+		cell.objectCount = (uint)json_object_get_number(info, "Objects");
+		cell.size = (uint)json_object_get_number(info, "Size");
+		cells.push_back(cell);
+	}
+
+	// The quadtree root spans the world so its nodes at the saved depth are the cells
+	App->sceneIntro->quadtreeBounds = AABB(GetFloat3(world, "Min"), GetFloat3(world, "Max"));
+
+	objectsStreamedIn = objectsStreamedOut = 0u;
+	open = true;
+}
+
+void WorldStreamer::Close()
+{
+	if (!open)
+		return;
+
+	std::vector<WorldCell*> order;
+	for (uint i = 0; i < cells.size(); ++i)
+	{
+		WorldCell& cell = cells[i];
+		if (cell.handle != 0)
+		{
+			App->resources->loader.Cancel(cell.handle);
+			cell.handle = 0u;
+		}
+		UnloadCell(cell);
+		order.push_back(&cell);
+	}
+
+	// No deadline, the next scene replaces them
+	DestroyObjects(order, ~0ull);
+
+	cells.clear();
+	open = false;
+
+	App->sceneIntro->quadtreeBounds = QUADTREE_DEFAULT_BOUNDS;
+}
+
+bool WorldStreamer::IsOpen() const
+{
+	return open;
+}
+
+void WorldStreamer::Update(const float3& camera)
+{
+	if (!open)
+		return;
+
+	Uint64 start = SDL_GetPerformanceCounter();
+	Uint64 deadline = start + (Uint64)(budgetMs * SDL_GetPerformanceFrequency() / 1000.0f);
+
+	std::vector<WorldCell*> order;
+	order.reserve(cells.size());
+	for (uint i = 0; i < cells.size(); ++i)
+	{
+		cells[i].distance = cells[i].bounds.Distance(camera);
+		order.push_back(&cells[i]);
+	}
+	std::sort(order.begin(), order.end(), CloserCell);
+
+	float unloadDistance = loadRadius + hysteresis;
+
+	// Marking them is cheap, destroying their objects is what the budget is for
+	for (int i = (int)order.size() - 1; i >= 0 && order[i]->distance > unloadDistance; --i)
+	{
+		WorldCell& cell = *order[i];
+		if (cell.state == WorldCellState::Loading)
+		{
+			App->resources->loader.Cancel(cell.handle);
+			cell.handle = 0u;
+		}
+		if (cell.state != WorldCellState::Unloaded && cell.state != WorldCellState::Unloading)
+			UnloadCell(cell);
+	}
+
+	// Farthest first, their memory goes before anything new comes in
+	DestroyObjects(order, deadline);
+
+	uint inFlight = GetCellCount(WorldCellState::Loading);
+	uint loadedBytes = GetLoadedCellBytes();
+	uint requestedBytes = 0u;
+	bool instantiated = false;
+
+	for (uint i = 0; i < order.size() && order[i]->distance <= unloadDistance; ++i)
+	{
+		WorldCell& cell = *order[i];
+		if (cell.state == WorldCellState::Instantiating)
+		{
+			if (!instantiated || SDL_GetPerformanceCounter() < deadline)
+			{
+				InstantiateCell(cell, deadline);
+				instantiated = true;
+			}
+		}
+		else if (cell.state == WorldCellState::Unloaded && !cell.failed && cell.distance <= loadRadius && inFlight < maxInFlight)
+		{
+			// The closest cell always fits, one bigger than the caps would otherwise never load
+			bool nothingLoaded = loadedBytes == 0;
+			if ((requestedBytes > 0 && requestedBytes + cell.size > maxCellBytesPerFrame) || (!nothingLoaded && loadedBytes + cell.size > maxLoadedCellBytes))
+				continue;
+
+			RequestCell(cell);
+			inFlight++;
+			requestedBytes += cell.size;
+			loadedBytes += cell.size;
+		}
+	}
+
+	lastUpdateMs = (float)(SDL_GetPerformanceCounter() - start) * 1000.0f / SDL_GetPerformanceFrequency();
+}
+
+void WorldStreamer::Forget(GameObject* go)
+{
+	if (!open)
+		return;
+
+	for (uint i = 0; i < cells.size(); ++i)
+	{
+		WorldCell& cell = cells[i];
+		std::vector<GameObject*>::iterator it = std::find(cell.objects.begin(), cell.objects.end(), go);
+		if (it == cell.objects.end())
+			continue;
+
+		cell.objects.erase(it);
+		cell.created.erase(go->uuid);
+		return;
+	}
+}
+
+uint WorldStreamer::GetCellCount() const
+{
+	return cells.size();
+}
+
+uint WorldStreamer::GetCellCount(WorldCellState state) const
+{
+	uint count = 0u;
+	for (uint i = 0; i < cells.size(); ++i)
+	{
+		if (cells[i].state == state)
+			count++;
+	}
+	return count;
+}
+
+uint WorldStreamer::GetLoadedCellBytes() const
+{
+	uint bytes = 0u;
+	for (uint i = 0; i < cells.size(); ++i)
+	{
+		if (cells[i].state != WorldCellState::Unloaded)
+			bytes += cells[i].size;
+	}
+	return bytes;
+}
+
+void WorldStreamer::RequestCell(WorldCell& cell)
+{
+	// Cells only move in Open and Close, and Close cancels first
+	uint index = &cell - &cells[0];
+
+	cell.state = WorldCellState::Loading;
+	cell.handle = App->resources->loader.Request(cell.file.c_str(), cell.distance,
+		[this, index](LoadRequest& request)
+		{
+			// Parson wants a terminated string
+			std::string text(request.data, request.size);
+			cells[index].parsed = json_parse_string(text.c_str());
+			request.decoded = true;
+		},
+		[this, index](LoadRequest& request)
+		{
+			WorldCell& cell = cells[index];
+			cell.handle = 0u;
+
+			if (json_value_get_type(cell.parsed) != JSONArray)
+			{
+				json_value_free(cell.parsed);
+				cell.parsed = nullptr;
+				cell.failed = true;
+				cell.state = WorldCellState::Unloaded;
+				LOG("Couldn't load world cell %s", cell.file.c_str());
+				return;
+			}
+
+			cell.nextObject = 0u;
+			cell.state = WorldCellState::Instantiating;
+		});
+}
+
+bool WorldStreamer::InstantiateCell(WorldCell& cell, unsigned long long deadline)
+{
+	GameObject* root = App->game_object->root;
+	JSON_Array* objects = json_value_get_array(cell.parsed);
+	uint count = json_array_get_count(objects);
+
+	// Saved parents first, each object is created under its parent and its resources get the right priority
+	while (cell.nextObject < count)
+	{
+		JSON_Object* info = json_array_get_object(objects, cell.nextObject++);
+
+		std::unordered_map<uint, GameObject*>::const_iterator parent = cell.created.find((uint)json_object_get_number(info, "Parent UUID"));
+		GameObject* go = new GameObject(parent != cell.created.end() ? parent->second : root, json_object_get_string(info, "Name"));
+		go->Load(info);
+
+		cell.created[go->uuid] = go;
+		cell.objects.push_back(go);
+		objectsStreamedIn++;
+
+		if (SDL_GetPerformanceCounter() >= deadline)
+			break;
+	}
+
+	if (cell.nextObject < count)
+		return false;
+
+	json_value_free(cell.parsed);
+	cell.parsed = nullptr;
+	cell.created.clear();
+	cell.state = WorldCellState::Loaded;
+
+	return true;
+}
+
+void WorldStreamer::UnloadCell(WorldCell& cell)
+{
+	cell.created.clear();
+
+	json_value_free(cell.parsed);
+	cell.parsed = nullptr;
+	cell.nextObject = 0u;
+	cell.state = cell.objects.empty() ? WorldCellState::Unloaded : WorldCellState::Unloading;
+}
+
+void WorldStreamer::DestroyObjects(const std::vector<WorldCell*>& order, unsigned long long deadline)
+{
+	std::unordered_set<GameObject*> destroyed;
+
+	for (int i = (int)order.size() - 1; i >= 0; --i)
+	{
+		WorldCell& cell = *order[i];
+		if (cell.state != WorldCellState::Unloading)
+			continue;
+
+		// Parents were created first, from the back a child never outlives its parent
+		while (!cell.objects.empty() && (destroyed.empty() || SDL_GetPerformanceCounter() < deadline))
+		{
+			GameObject* go = cell.objects.back();
+			cell.objects.pop_back();
+
+			DestroyObject(go);
+			destroyed.insert(go);
+		}
+
+		if (!cell.objects.empty())
+			break;
+
+		cell.state = WorldCellState::Unloaded;
+	}
+
+	if (destroyed.empty())
+		return;
+
+	// One pass for the whole batch, the addresses are only compared
+	App->game_object->gameObjects.remove_if([&destroyed](GameObject* go) { return destroyed.find(go) != destroyed.end(); });
+	objectsStreamedOut += destroyed.size();
+}
+
+void WorldStreamer::DestroyObject(GameObject* go)
+{
+	ModuleGameObject* scene = App->game_object;
+
+	if (go->parent != nullptr)
+		go->parent->childs.remove(go);
+	App->sceneIntro->quadtree.QT_Remove(go);
+
+	scene->gameObjectsToDelete.remove(go);
+	scene->componentsToDelete.remove_if([go](Component* component) { return component->gameObject == go; });
+
+	if (App->sceneIntro->current_object == go)
+		App->sceneIntro->current_object = nullptr;
+
+	go->RealDelete();
+	delete go;
+}
@@ -0,0 +1,121 @@
+#pragma once
+#include "Globals.h"
+#include "ResourceLoader.h"
+#include "MathGeoLib/MathGeoLib.h"
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+
+class GameObject;
+
+enum class WorldCellState
+{
+	Unloaded,
+	Loading,
+	Instantiating,
+	Loaded,
+	// Out of range, its objects are destroyed a few at a time and it isn't requested again until they're gone
+	Unloading
+};
+
+// One quadtree leaf of the world, its objects are a scene file of their own
+struct WorldCell
+{
+	int x = 0;
+	int z = 0;
+	std::string file;
+
+	// The leaf square enclosed with whatever overhangs it
+	AABB bounds;
+	uint objectCount = 0u;
+	uint size = 0u;
+
+	WorldCellState state = WorldCellState::Unloaded;
+	LoadHandle handle = 0u;
+	bool failed = false;
+
+	// Parsed on a worker, instantiated on the main thread a few objects at a time
+	JSON_Value* parsed = nullptr;
+	uint nextObject = 0u;
+	std::unordered_map<uint, GameObject*> created;
+
+	std::vector<GameObject*> objects;
+
+	// From the camera, this frame
+	float distance = 0.0f;
+};
+
+// Streams the cells of a world around the camera. Cells inside the radius are read and parsed on the resource loader
+// and instantiated under a per-frame time budget, cells past the radius plus the hysteresis band have their objects
+// destroyed under the same budget. The root and the objects without bounds (cameras, lights) stay in the world file, always loaded.
+class WorldStreamer
+{
+public:
+	WorldStreamer();
+	~WorldStreamer();
+
+	// Splits the current scene into the quadtree leaves at the given depth: the world file plus one scene per cell.
+	// The root's children are the units that get placed, each with its whole subtree.
+	bool Save(const char* name, uint depth);
+
+	// The persistent objects are already in the scene, every cell starts unloaded
+	void Open(JSON_Object* world);
+
+	// Destroys the streamed objects, the quadtree gets its default bounds back
+	void Close();
+
+	bool IsOpen() const;
+
+	void Update(const float3& camera);
+
+	// Objects deleted from the editor aren't the cell's to destroy anymore
+	void Forget(GameObject* go);
+
+	uint GetCellCount() const;
+	uint GetCellCount(WorldCellState state) const;
+
+	// File size of every cell that isn't unloaded, not the memory of its meshes and textures
+	uint GetLoadedCellBytes() const;
+
+private:
+
+	void RequestCell(WorldCell& cell);
+
+	// True once every object is in the scene
+	bool InstantiateCell(WorldCell& cell, unsigned long long deadline);
+
+	void UnloadCell(WorldCell& cell);
+
+	// Farthest unloading cells first, at least one object goes when any is waiting
+	void DestroyObjects(const std::vector<WorldCell*>& order, unsigned long long deadline);
+
+	void DestroyObject(GameObject* go);
+
+public:
+
+	float loadRadius = 100.0f;
+
+	// Cells unload past loadRadius + hysteresis, a camera moving along a border doesn't thrash them
+	float hysteresis = 25.0f;
+
+	// Main thread time for creating and destroying objects, at least one step always runs
+	float budgetMs = 2.0f;
+
+	// Cell file bytes requested per frame and cells on the loader at once
+	uint maxCellBytesPerFrame = 4 * 1024 * 1024;
+	uint maxInFlight = 4u;
+
+	// Cell file bytes kept loaded, cells past it aren't requested and the closest ones get it.
+	// The meshes and textures they reference are budgeted by the resource loader and the texture streamer.
+	uint maxLoadedCellBytes = 64 * 1024 * 1024;
+
+	uint objectsStreamedIn = 0u;
+	uint objectsStreamedOut = 0u;
+	float lastUpdateMs = 0.0f;
+
+private:
+
+	bool open = false;
+	std::vector<WorldCell> cells;
+};